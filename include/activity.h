@@ -0,0 +1,98 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/activity.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _ACTIVITY_H_
+#define _ACTIVITY_H_
+
+#include <stdint.h> /* uint32_t, uint64_t */
+
+#define ACTIVITY_MINUTES 60 /* minute buckets, the last hour */
+#define ACTIVITY_HOURS 25 /* hour buckets, the last day and the hour its oldest minute falls in */
+#define ACTIVITY_DAYS 8 /* day buckets, the last week and the day its oldest minute falls in */
+#define ACTIVITY_BUCKETS (ACTIVITY_MINUTES + ACTIVITY_HOURS + ACTIVITY_DAYS) /* buckets of every tier */
+#define ACTIVITY_MAX_WINDOW ((ACTIVITY_DAYS - 1) * 1440U) /* longest window a sum can cover, in minutes */
+
+/**
+ * @brief counters of a file split in time buckets
+ *  
+ * three rings of buckets, one per minute, per hour and per day, each event is counted
+ * in the bucket of every ring, so each ring is a downsampled copy of the one before
+ * covering a longer time; a window is summed from the finest ring it fits in
+ *  
+ * the rings only move when an event newer than stamp is added, or when they are read,
+ * the buckets that went out of a ring are cleared then, so the size never grows
+ *  
+ * a zeroed struct holds no events
+ */
+struct activity {
+    uint32_t stamp; /** > minute since the epoch of the newest event, 0 if none was added */
+    uint32_t opened[ACTIVITY_BUCKETS]; /** > openings of each bucket, minutes first, then hours and days */
+    uint32_t modified[ACTIVITY_BUCKETS]; /** > modifications of each bucket, same layout as opened */
+};
+
+/**
+ * @brief counts events in the buckets of a minute
+ *  
+ * events newer than the stamp move the rings forward first,
+ * older ones are only counted in the rings that still cover their minute
+ * 
+ * @param activity activity struct
+ * @param minute minute since the epoch the events happened at
+ * @param opened count of the opening event
+ * @param modified count of the modifying event
+ */
+void activity_add(struct activity *activity, uint32_t minute, uint32_t opened, uint32_t modified);
+
+/**
+ * @brief adds the buckets of an activity to another one
+ * 
+ * @param dst activity struct the buckets are added to
+ * @param src activity struct added
+ */
+void activity_merge(struct activity *dst, const struct activity *src);
+
+/**
+ * @brief returns if every bucket of an activity went out of its ring
+ * 
+ * @param activity activity struct
+ * @param now current minute since the epoch
+ * @return 1 if expired, 0 if it still holds events
+ */
+int activity_expired(const struct activity *activity, uint32_t now);
+
+/**
+ * @brief sums the events of the last minutes
+ *  
+ * the window is summed from the finest ring holding every bucket it touches, from the one
+ * holding its oldest minute to the current one, so it is rounded up to whole buckets
+ * at its oldest end; windows longer than ACTIVITY_MAX_WINDOW are cut to it
+ * 
+ * @param activity activity struct, NULL for a file without events in the rings
+ * @param now current minute since the epoch
+ * @param window length of the window in minutes
+ * @param opened set to the openings of the window
+ * @param modified set to the modifications of the window
+ */
+void activity_window(const struct activity *activity, uint32_t now, uint32_t window, uint64_t *opened, uint64_t *modified);
+
+#endif /* _ACTIVITY_H_ */
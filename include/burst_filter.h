@@ -0,0 +1,88 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/burst_filter.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _BURST_FILTER_H_
+#define _BURST_FILTER_H_
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+#include "stat_counter.h" /* stat_counter */
+
+#define BURST_SLOTS 1024 /* slots of a filter, power of two */
+#define BURST_KEY_SEED 14695981039346656037ULL /* FNV-1a 64 bit offset basis, starts a new key */
+
+/**
+ * @brief last event seen for a key
+ */
+struct burst_slot {
+    uint64_t key; /** > identity of the event, file + pid + mask */
+    uint64_t since; /** > time the window of the key was opened, in nanoseconds */
+};
+
+/**
+ * @brief collapses identical events repeated within a time window
+ *  
+ * direct mapped, a key evicted by another one just opens a new window,
+ * so a collision can only let an event through, never drop a different one
+ */
+struct burst_filter {
+    struct burst_slot slots[BURST_SLOTS]; /** > slots indexed by key */
+    uint64_t window_ns; /** > length of the window in nanoseconds, 0 disables the filter */
+    stat_counter raw; /** > events checked */
+    stat_counter coalesced; /** > events collapsed into the first event of their window */
+};
+
+/**
+ * @brief initializes an empty filter
+ * 
+ * @param filter filter struct that is going to be initialized
+ * @param window_ns length of the window in nanoseconds, 0 disables the filter
+ */
+void burst_filter_init(struct burst_filter *filter, uint64_t window_ns);
+
+/**
+ * @brief checks if an event repeats one seen within the window
+ *  
+ * the first event of a key opens a window, the next ones with the same key
+ * are collapsed until the window ends, then the next one opens a new window
+ * 
+ * @param filter filter struct
+ * @param key identity of the event
+ * @param now current time in nanoseconds, monotonic
+ * @return 1 if the event must be collapsed, 0 if it must be recorded
+ */
+int burst_filter_check(struct burst_filter *filter, uint64_t key, uint64_t now);
+
+/**
+ * @brief hashes bytes into a 64 bit key
+ *  
+ * FNV-1a, can be chained to hash several fields into the same key
+ * 
+ * @param hash current hash, BURST_KEY_SEED to start a new key
+ * @param data bytes that are going to be hashed
+ * @param len count of bytes
+ * @return updated hash
+ */
+uint64_t burst_key(uint64_t hash, const void *data, size_t len);
+
+#endif /* _BURST_FILTER_H_ */
@@ -0,0 +1,131 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/event_ring.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _EVENT_RING_H_
+#define _EVENT_RING_H_
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t, int32_t */
+#include <stdatomic.h> /* _Atomic */
+
+#define EVENT_RING_PAD 0x80000000U /* flag on the size of a record that only pads the end of the ring */
+
+/**
+ * @brief compact copy of a fanotify event
+ *  
+ * records are variable sized, in FID mode the info record
+ * holding the parent directory handle and the file name is stored after the header
+ */
+struct event_record {
+    _Atomic uint32_t size; /** > size of the record inside the ring, header included, 0 until committed */
+    uint32_t mask; /** > fanotify event mask */
+    int32_t fd; /** > file descriptor of the event, -1 in FID mode */
+    int32_t pid; /** > pid of the process that caused the event */
+    uint32_t hash; /** > hash of the file identity, used for dispatching */
+    uint32_t group; /** > id of the fanotify group the event was read from */
+    uint32_t info_len; /** > length of the info record */
+    uint32_t reserved; /** > keeps the info record 8 byte aligned */
+    unsigned char info[]; /** > FAN_EVENT_INFO_TYPE_DFID_NAME info record */
+};
+
+/**
+ * @brief lock-free multiple producer, single consumer ring of event records
+ *  
+ * the producer and consumer indexes are monotonic byte counters,
+ * producers reserve space by moving head forward and publish
+ * each record by storing its size, the consumer zeroes what it releases
+ */
+struct event_ring {
+    _Alignas(64) _Atomic size_t head; /** > bytes reserved by the producers */
+    _Alignas(64) _Atomic size_t tail; /** > bytes released by the consumer */
+    _Alignas(64) unsigned char *data; /** > storage of the records */
+    size_t size; /** > size of the storage, power of two */
+    _Atomic uint64_t full; /** > times a reserve failed because the ring was full */
+    _Atomic uint64_t high_water; /** > max bytes in use seen by the producers */
+};
+
+/**
+ * @brief initializes an empty ring
+ * 
+ * @param ring ring struct that is going to be initialized
+ * @param size size of the storage in bytes, rounded up to a power of two
+ * @return 1 if successful, 0 if failed
+ */
+int event_ring_init(struct event_ring *ring, size_t size);
+
+/**
+ * @brief frees the storage of a ring
+ * 
+ * @param ring ring struct that is going to be freed
+ */
+void event_ring_free(struct event_ring *ring);
+
+/**
+ * @brief reserves space for a record, producer side
+ *  
+ * the record is not visible to the consumer until event_ring_commit is called,
+ * records reserved after it are not visible either until then
+ * 
+ * @param ring ring struct
+ * @param info_len length of the info stored after the header
+ * @return record to be filled, NULL if the ring is full
+ */
+struct event_record *event_ring_reserve(struct event_ring *ring, size_t info_len);
+
+/**
+ * @brief publishes a reserved record to the consumer
+ * 
+ * @param ring ring struct
+ * @param record record returned by event_ring_reserve
+ */
+void event_ring_commit(struct event_ring *ring, struct event_record *record);
+
+/**
+ * @brief returns the oldest record of the ring, consumer side
+ *  
+ * the record stays valid until event_ring_pop is called
+ * 
+ * @param ring ring struct
+ * @return oldest record, NULL if the ring is empty
+ */
+struct event_record *event_ring_peek(struct event_ring *ring);
+
+/**
+ * @brief releases the record returned by event_ring_peek
+ * 
+ * @param ring ring struct
+ * @param record record that is going to be released
+ */
+void event_ring_pop(struct event_ring *ring, struct event_record *record);
+
+/**
+ * @brief returns whether a ring holds no records
+ *  
+ * safe to call from the consumer side only
+ * 
+ * @param ring ring struct
+ * @return 1 if empty, 0 if not
+ */
+int event_ring_empty(struct event_ring *ring);
+
+#endif /* _EVENT_RING_H_ */
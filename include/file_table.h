@@ -24,8 +24,23 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _FILE_TABLE_H_
 #define _FILE_TABLE_H_
 
-#include <stdint.h> /* uint32_t */
-#include "uthash.h" /* UT_hash_handle, HASH_FIND_STR, HASH_ADD_STR, HASH_ITER */
+#include <stdint.h> /* uint16_t, uint32_t */
+#include <stddef.h> /* size_t */
+#include "activity.h" /* activity */
+
+#define MAX_KEY_LENGTH 4095 /* longer file names are truncated */
+#define TABLE_CHUNK_SHIFT 16 /* log2 of the size of the arena chunks */
+#define TABLE_CHUNK_SIZE (1U << TABLE_CHUNK_SHIFT) /* size of the arena chunks, in bytes */
+#define TABLE_CHUNK_MASK (TABLE_CHUNK_SIZE - 1) /* offset of a node or name inside its chunk */
+#define MAX_TABLE_CHUNKS (1U << (32 - TABLE_CHUNK_SHIFT)) /* node ids and name offsets are 32 bits wide */
+#define NO_NODE UINT32_MAX /* id of a missing parent, child or sibling */
+#define FILE_TRACKED 1 /* flag of the nodes holding counters of a file */
+#define MAX_SPARE_CHUNKS 64 /* max freed arena chunks each thread keeps for reuse */
+#define MAX_SPARE_BLOCKS 16 /* max freed slot and chunk arrays each thread keeps for reuse */
+#define MIN_TABLE_SLOTS 64 /* initial capacity of the index of a table, a power of two */
+#define MAX_LOAD_NUM 7 /* the index grows once it is MAX_LOAD_NUM / MAX_LOAD_DEN full */
+#define MAX_LOAD_DEN 8
+#define RESIZE_STEP 8 /* slots moved to the grown index on each insert while a resize is running */
 
 /**
  * @brief struct that stores general information about a file
@@ -33,37 +48,213 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * stores the name of the file and a counter of how many times
  * an event (open, modify) has occured
  *  
- * it also uses UT_hash_handle struct for handling the hash table behavior
+ * each node is a single component of a path, interned once per parent:
+ * the directories shared by many files are stored a single time,
+ * and a file is the node of its last component, flagged with FILE_TRACKED
+ *  
+ * nodes are identified by their offset in the arena of the table,
+ * the name is stored right after the node, preceded by the id of the parent
+ *  
+ * nodes are found through the index of the table,
+ * keyed by the id of the parent and the name
+ *  
+ * the time bucketed counters of a file are only allocated once asked for with addactivity(),
+ * the tables filled by the listener between two saves never hold any
  */
 struct _file {
-    char key[4096]; /** > file name */
+    uint32_t id; /** > offset of the node in the arena, its name record (length, parent id, name) follows it */
+    uint32_t child; /** > id of the first child, NO_NODE if none */
+    uint32_t sibling; /** > id of the next child of the same parent, NO_NODE if none */
+    uint32_t flags; /** > FILE_TRACKED if the node is a file of the table */
     uint32_t opening; /** > count of the opening event */
     uint32_t modifying; /** > count of the modifying event */
-    UT_hash_handle hh; /** hashable */
+    uint32_t activity; /** > offset of the activity of the file in the arena, NO_NODE if none */
+};
+
+/**
+ * @brief slot of the index of a table
+ *  
+ * the hash is cached so probes only compare names when hashes are equal
+ */
+struct table_slot {
+    uint32_t hash; /** > hash of the parent id and name of the node, 0 if the slot is empty */
+    uint32_t id; /** > id of the node */
+};
+
+/**
+ * @brief table of files, stored as a tree of path components
+ *  
+ * nodes and names are bump-allocated from fixed size chunks, so they never move
+ * and are only released all at once by clear_table()
+ *  
+ * the index is an open-addressing table using robin hood probing,
+ * when it grows the old slots are moved a few at a time by the next inserts,
+ * lookups check both indexes until the move is done, so no insert pays for a full rehash
+ *  
+ * a zeroed struct is an empty table
+ */
+struct file_table {
+    struct table_slot *slots; /** > index of every node, directories included */
+    uint32_t mask; /** > capacity of slots minus one, 0 while slots is NULL */
+    size_t filled; /** > slots in use */
+    struct table_slot *old_slots; /** > index being moved into slots, NULL if no resize is running */
+    uint32_t old_mask; /** > capacity of old_slots minus one */
+    size_t moved; /** > old slots already moved */
+    char **chunks; /** > arena chunks, each one TABLE_CHUNK_SIZE bytes */
+    uint32_t chunk_count; /** > chunks in use */
+    uint32_t chunk_cap; /** > capacity of chunks */
+    uint32_t used; /** > bytes used in the last chunk */
+    uint32_t first; /** > id of the first node without parent, only valid while nodes is not 0 */
+    size_t nodes; /** > nodes stored */
+    size_t count; /** > nodes flagged with FILE_TRACKED */
+    uint32_t records; /** > id of the first record, only valid while record_count is not 0 */
+    uint32_t last_record; /** > id of the last record, new records are linked after it */
+    size_t record_count; /** > deletes and renames recorded with addrecord() */
+    uint32_t last_dir; /** > id of the directory of the last file added */
+    size_t last_len; /** > length of last_path, 0 if last_dir is not cached */
+    char last_path[MAX_KEY_LENGTH + 1]; /** > path of last_dir with its trailing slash, consecutive events often share it */
 };
 
 /**
- *  @brief given a key and a value, adds it to a table
+ * @brief handles a file found by walktable()
  *  
- * adds a value to a given table struct, if key is already on the table
- * updates it to value
+ * @param table table being walked
+ * @param item node of the file, delitem() can be called on it
+ * @param path full path of the file
+ * @param len length of path
+ * @param arg argument given to walktable()
+ */
+typedef void (*table_handler)(struct file_table *table, struct _file *item, const char *path, size_t len, void *arg);
+
+/**
+ * @brief handles a record found by walkrecords()
+ *  
+ * @param seq sequence number given to addrecord()
+ * @param from path that was deleted or renamed
+ * @param to new path of a rename, NULL for a delete
+ * @param arg argument given to walkrecords()
+ */
+typedef void (*record_handler)(uint64_t seq, const char *from, const char *to, void *arg);
+
+/**
+ * @brief given a path and its counters, adds it to a table
+ *  
+ * adds the counters to the file of a given table struct, if the file is already
+ * on the table its counters are summed
  *  
  * if its not in the table already, adds it normally
  *  
+ * arena chunks freed before by the same thread are reused, so a table refilled after
+ * being cleared does not allocate
+ *  
  * @param table table struct where the item is going to be added
- * @param key key of the item being added (_file->key)
- * @param value value of the item being added (_file->value)
- * @param event type of the event (modified, openened)
+ * @param filename full path of the file
+ * @param op_count count of the opening event added
+ * @param mod_count count of the modifying event added
  * @return 1 if added, 0 if updated, -1 if failed
  */
-int additem(struct _file **table, const char *filename, const uint32_t op_count, const uint32_t mod_count);
+int additem(struct file_table *table, const char *filename, const uint32_t op_count, const uint32_t mod_count);
+
+/**
+ * @brief returns the time bucketed counters of a file, allocating them if needed
+ *  
+ * the counters are allocated zeroed in the arena of the table the first time,
+ * the caller adds the events with activity_add() or activity_merge()
+ *  
+ * @param table table struct holding the file
+ * @param filename full path of the file, it must be tracked
+ * @return counters of the file, NULL if it is not tracked or failed
+ */
+struct activity *addactivity(struct file_table *table, const char *filename);
+
+/**
+ * @brief returns the time bucketed counters of a file
+ *  
+ * @param table table struct holding the file
+ * @param item node of the file
+ * @return counters of the file, NULL if none were added
+ */
+const struct activity *getactivity(const struct file_table *table, const struct _file *item);
+
+/**
+ * @brief removes an item from a table
+ *  
+ * the file stops being tracked, its node is kept until clear_table()
+ * since other paths may go through it, its activity is dropped
+ *  
+ * @param table table struct holding the item
+ * @param item item that is going to be removed
+ */
+void delitem(struct file_table *table, struct _file *item);
+
+/**
+ * @brief calls a handler on every file under a directory
+ *  
+ * the subtree of the directory is traversed, the rest of the table is never visited
+ *  
+ * @param table table struct that is going to be walked
+ * @param dir directory whose files are visited, the file itself if it is tracked, NULL for the whole table
+ * @param handler function called on each file
+ * @param arg argument given to handler
+ * @return amount of files visited
+ */
+size_t walktable(struct file_table *table, const char *dir, table_handler handler, void *arg);
+
+/**
+ * @brief removes a path and every file under it from a table
+ *  
+ * @param table table struct holding the files
+ * @param path path of the file or directory that was deleted
+ * @return amount of files removed
+ */
+size_t delpath(struct file_table *table, const char *path);
+
+/**
+ * @brief moves a path and every file under it to a new path
+ *  
+ * the counters and activity of a file already tracked under the new path are summed
+ *  
+ * @param table table struct holding the files
+ * @param from path of the file or directory that was renamed
+ * @param to new path
+ * @return amount of files moved, 0 if failed
+ */
+size_t movepath(struct file_table *table, const char *from, const char *to);
+
+/**
+ * @brief records a delete or a rename in a table
+ *  
+ * records are kept in the order they are added, apart from the files,
+ * so the entries persisted before can be pruned or moved when the table is saved
+ *  
+ * @param table table struct holding the records
+ * @param seq sequence number, orders records of different tables
+ * @param from path that was deleted or renamed
+ * @param to new path of a rename, NULL for a delete
+ * @return 1 if successful, 0 if failed
+ */
+int addrecord(struct file_table *table, uint64_t seq, const char *from, const char *to);
+
+/**
+ * @brief calls a handler on every record of a table, in the order they were added
+ *  
+ * @param table table struct holding the records
+ * @param handler function called on each record
+ * @param arg argument given to handler
+ * @return amount of records visited
+ */
+size_t walkrecords(struct file_table *table, record_handler handler, void *arg);
 
 /** 
  * @brief frees all the values stored in a table
  *  
  * given a table, frees all the memory alloc'ed inside of it
+ * and leaves it empty
+ *  
+ * up to MAX_SPARE_CHUNKS arena chunks are kept by the calling thread for the next tables it fills
+ *  
  * @param table table struct thats going to be freed
  */
-void clear_table(struct _file **table);
+void clear_table(struct file_table *table);
 
 #endif /* _FILE_TABLE_H_ */
@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/io_ring.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _IO_RING_H_
+#define _IO_RING_H_
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+#include <linux/io_uring.h> /* io_uring_sqe, io_uring_cqe */
+
+/**
+ * @brief io_uring instance, driven through the raw system calls
+ *  
+ * requests are prepared in the submission queue and handed to the kernel
+ * in one io_uring_enter, their results are reaped from the completion queue
+ *  
+ * a ring is owned by a single thread, every thread doing I/O through io_uring has its own
+ */
+struct io_ring {
+    int fd; /** > io_uring descriptor, -1 when io_uring is unavailable */
+    unsigned entries; /** > size of the submission queue */
+    unsigned *sq_head; /** > first request not consumed by the kernel */
+    unsigned *sq_tail; /** > first free slot of the submission queue */
+    unsigned *sq_mask; /** > mask of the submission queue indexes */
+    unsigned *sq_array; /** > indexes of the prepared requests into sqes */
+    struct io_uring_sqe *sqes; /** > submission queue entries */
+    unsigned *cq_head; /** > first completion not reaped */
+    unsigned *cq_tail; /** > first free slot of the completion queue */
+    unsigned *cq_mask; /** > mask of the completion queue indexes */
+    struct io_uring_cqe *cqes; /** > completion queue entries */
+    void *sq_map; /** > mapped submission ring */
+    size_t sq_map_size; /** > bytes of sq_map */
+    void *cq_map; /** > mapped completion ring, the same as sq_map on kernels with a single mapping */
+    size_t cq_map_size; /** > bytes of cq_map */
+    size_t sqes_size; /** > bytes of sqes */
+    unsigned queued; /** > requests prepared and not submitted yet */
+    unsigned inflight; /** > requests submitted and not reaped yet */
+};
+
+/**
+ * @brief sets up a ring
+ *  
+ * fails when the kernel has no io_uring or it is disabled,
+ * the ring is left with fd -1 so the caller can fall back to blocking calls
+ * 
+ * @param ring ring struct that is going to be initialized
+ * @param entries size of the submission queue, rounded up to a power of two by the kernel
+ * @return 1 if successful, 0 if io_uring is unavailable
+ */
+int io_ring_init(struct io_ring *ring, unsigned entries);
+
+/**
+ * @brief tears a ring down
+ *  
+ * requests still in flight are cancelled by the kernel
+ * 
+ * @param ring ring struct
+ */
+void io_ring_free(struct io_ring *ring);
+
+/**
+ * @brief returns if a ring was set up
+ * 
+ * @param ring ring struct, NULL is treated as unavailable
+ * @return 1 if usable, 0 if not
+ */
+int io_ring_ready(const struct io_ring *ring);
+
+/**
+ * @brief reserves a request in the submission queue
+ *  
+ * the request is zeroed and tagged with user_data,
+ * it is handed to the kernel by the next io_ring_submit
+ * 
+ * @param ring ring struct
+ * @param opcode IORING_OP value of the request
+ * @param fd file descriptor the request works on
+ * @param user_data value returned with its completion
+ * @return request to be filled, NULL if the submission queue is full
+ */
+struct io_uring_sqe *io_ring_prepare(struct io_ring *ring, uint8_t opcode, int fd, uint64_t user_data);
+
+/**
+ * @brief hands the prepared requests to the kernel
+ * 
+ * @param ring ring struct
+ * @param wait completions to wait for, 0 returns right away
+ * @return count of requests submitted, -1 if failed
+ */
+int io_ring_submit(struct io_ring *ring, unsigned wait);
+
+/**
+ * @brief reaps a completion
+ * 
+ * @param ring ring struct
+ * @param cqe filled with the completion
+ * @param wait flag indicating if the call blocks until a completion arrives
+ * @return 1 if a completion was reaped, 0 if none is ready, -1 if waiting failed
+ */
+int io_ring_reap(struct io_ring *ring, struct io_uring_cqe *cqe, int wait);
+
+#endif /* _IO_RING_H_ */
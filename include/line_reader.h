@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/line_reader.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _LINE_READER_H_
+#define _LINE_READER_H_
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+/**
+ * @brief line or field of a mapped file, not NUL terminated
+ */
+struct line_view {
+    const char *data; /** > first byte, points into the mapped file */
+    size_t len; /** > count of bytes, without the newline */
+};
+
+/**
+ * @brief reads a file and processes its lines without copying them
+ *  
+ * the file is mapped and scanned for newlines with memchr, each line is passed
+ * as a view into the mapping, so no memory is allocated per line whatever the size of the file;
+ * empty lines are skipped, the views are only valid during the call of the handler
+ * 
+ * @param path path of the file
+ * @param line_handler handler in charge of processing lines
+ * @param arg extra argument for the handler
+ * @return 1 if successful, 0 if failed
+ */
+int line_reader_scan(const char *path, void (*line_handler)(struct line_view line, void *arg), void *arg);
+
+/**
+ * @brief cuts the last field off a line
+ *  
+ * fields are split from the end, so the first field can hold the delimiter
+ * 
+ * @param line view that is shortened to the bytes before the last delimiter
+ * @param delim delimiter of the fields
+ * @param field view set to the bytes after the last delimiter
+ * @return 1 if successful, 0 if the line holds no delimiter
+ */
+int line_view_cut(struct line_view *line, char delim, struct line_view *field);
+
+/**
+ * @brief parses a field holding an unsigned decimal number
+ * 
+ * @param field field that is going to be parsed
+ * @param out parsed value, saturated to UINT64_MAX
+ * @return 1 if successful, 0 if the field is empty or holds something else than digits
+ */
+int line_view_u64(struct line_view field, uint64_t *out);
+
+#endif /* _LINE_READER_H_ */
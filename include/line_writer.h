@@ -0,0 +1,84 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/line_writer.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _LINE_WRITER_H_
+#define _LINE_WRITER_H_
+
+#include <stddef.h> /* size_t */
+
+#define LINE_WRITER_SIZE (256U * 1024U) /* default bytes buffered before they are written */
+
+/**
+ * @brief buffered writer of a text file
+ *  
+ * lines are formatted straight into a single buffer, written out each time it fills up,
+ * so the memory used while saving is bounded by the buffer whatever the size of the content
+ */
+struct line_writer {
+    int fd; /** > file being written */
+    char *buffer; /** > malloc'ed buffer the lines are formatted into */
+    size_t size; /** > size of buffer */
+    size_t used; /** > bytes of buffer not written yet */
+    int failed; /** > set once a write failed, every write after it is skipped */
+};
+
+/**
+ * @brief opens a file for writing
+ * 
+ * @param writer writer struct that is going to be initialized
+ * @param path path of the file
+ * @param trunc flag indicating if the file is truncated, the lines are appended otherwise
+ * @param size size of the buffer
+ * @return 1 if successful, 0 if failed
+ */
+int line_writer_open(struct line_writer *writer, const char *path, int trunc, size_t size);
+
+/**
+ * @brief returns room in the buffer for the next line
+ *  
+ * writes the buffer out first when less than len bytes are left,
+ * the line is only added once line_writer_commit is called
+ * 
+ * @param writer writer struct
+ * @param len max bytes the line can take
+ * @return start of the room, NULL if a write failed or len is larger than the buffer
+ */
+char *line_writer_reserve(struct line_writer *writer, size_t len);
+
+/**
+ * @brief adds the line formatted in the room returned by line_writer_reserve
+ * 
+ * @param writer writer struct
+ * @param len bytes used by the line, at most the ones reserved
+ */
+void line_writer_commit(struct line_writer *writer, size_t len);
+
+/**
+ * @brief writes what is left in the buffer and closes the file
+ * 
+ * @param writer writer struct, its buffer is freed
+ * @return 1 if every line was written, 0 if a write failed
+ */
+int line_writer_close(struct line_writer *writer);
+
+#endif /* _LINE_WRITER_H_ */
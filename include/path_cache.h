@@ -0,0 +1,144 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/path_cache.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _PATH_CACHE_H_
+#define _PATH_CACHE_H_
+
+#include <stddef.h> /* size_t */
+#include "uthash.h" /* UT_hash_handle */
+#include "stat_counter.h" /* stat_counter */
+
+#define PATH_CACHE_CLASSES 6 /* size classes of the entries, powers of two from PATH_CACHE_MIN_ENTRY */
+#define PATH_CACHE_MIN_ENTRY 256 /* bytes of the smallest size class */
+#define PATH_CACHE_MAX_SPARE 64 /* max dropped entries kept for reuse in each size class */
+
+/**
+ * @brief struct that stores a resolved path
+ *  
+ * maps an opaque key (e.g. fsid + file handle) to the path it resolved to
+ *  
+ * it is hashed twice, by key for lookups and by path for invalidations
+ */
+struct path_cache_entry {
+    const unsigned char *key; /** > identifier of the file, stored after the struct */
+    size_t key_len; /** > length of the key in bytes */
+    char *path; /** > resolved path, stored after the key */
+    int size_class; /** > size class the entry was allocated in, -1 if larger than every class */
+    struct path_cache_entry *next_spare; /** > next dropped entry of the same size class */
+    struct path_cache_entry *lru_prev; /** > entry used right before this one, NULL for the least recently used */
+    struct path_cache_entry *lru_next; /** > entry used right after this one, NULL for the most recently used */
+    UT_hash_handle hh; /** hashable by key */
+    UT_hash_handle hh_path; /** hashable by path */
+};
+
+/**
+ * @brief bounded lru cache of resolved paths
+ *  
+ * when the cache is full, the least recently used entry is evicted
+ *  
+ * the lru order is kept in a list of its own, so a hit only relinks the entry
+ * instead of removing it from the hash and adding it back
+ *  
+ * dropped entries are kept by size class and reused by the next entries added,
+ * so a full cache replaces its entries without allocating
+ */
+struct path_cache {
+    struct path_cache_entry *by_key; /** > entries hashed by key */
+    struct path_cache_entry *by_path; /** > entries hashed by path */
+    struct path_cache_entry *lru_first; /** > least recently used entry */
+    struct path_cache_entry *lru_last; /** > most recently used entry */
+    size_t max_entries; /** > max entries the cache can hold */
+    struct path_cache_entry *spare[PATH_CACHE_CLASSES]; /** > dropped entries of every size class */
+    size_t spare_count[PATH_CACHE_CLASSES]; /** > count of dropped entries of every size class */
+    stat_counter hits; /** > lookups that found their key */
+    stat_counter misses; /** > lookups that did not find their key */
+    stat_counter evictions; /** > entries dropped to make room for new ones */
+    stat_counter invalidations; /** > entries dropped because their path changed */
+};
+
+/**
+ * @brief initializes an empty cache
+ * 
+ * @param cache cache struct that is going to be initialized
+ * @param max_entries max entries the cache can hold, 0 disables the cache
+ */
+void path_cache_init(struct path_cache *cache, size_t max_entries);
+
+/**
+ * @brief looks up the path of a key
+ *  
+ * on a hit, the entry is marked as the most recently used
+ * 
+ * @param cache cache struct
+ * @param key identifier of the file
+ * @param key_len length of the key in bytes
+ * @return cached path, NULL if not found
+ */
+const char *path_cache_find(struct path_cache *cache, const void *key, size_t key_len);
+
+/**
+ * @brief adds a resolved path to the cache
+ *  
+ * if the cache is full, evicts the least recently used entry
+ * 
+ * @param cache cache struct
+ * @param key identifier of the file
+ * @param key_len length of the key in bytes
+ * @param path path the key resolved to
+ * @return 1 if added, 0 if already cached or disabled, -1 if failed
+ */
+int path_cache_add(struct path_cache *cache, const void *key, size_t key_len, const char *path);
+
+/**
+ * @brief drops the entry of a path
+ *  
+ * used when a directory is deleted, its children are always deleted before it
+ * 
+ * @param cache cache struct
+ * @param path path that is no longer valid
+ * @return 1 if dropped, 0 if not cached
+ */
+int path_cache_remove(struct path_cache *cache, const char *path);
+
+/**
+ * @brief drops the entry of a path and every entry below it
+ *  
+ * used when a directory is renamed,
+ * since every path cached under it is no longer valid
+ * 
+ * @param cache cache struct
+ * @param path path that is no longer valid
+ * @return count of entries dropped
+ */
+size_t path_cache_invalidate(struct path_cache *cache, const char *path);
+
+/**
+ * @brief frees all the entries stored in a cache
+ *  
+ * the dropped entries kept for reuse are freed too
+ * 
+ * @param cache cache struct that is going to be cleared
+ */
+void path_cache_clear(struct path_cache *cache);
+
+#endif /* _PATH_CACHE_H_ */
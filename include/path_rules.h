@@ -0,0 +1,152 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/path_rules.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _PATH_RULES_H_
+#define _PATH_RULES_H_
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t, uint16_t, uint8_t */
+
+#define PATH_RULE_PREFIX 0 /* literal path, matches the path and everything below it */
+#define PATH_RULE_GLOB 1 /* glob pattern matching the whole path */
+#define PATH_RULE_REGEX 2 /* extended regular expression searched in the path */
+
+#define PATH_RULE_GLOB_TAG "glob:" /* blacklist lines starting with it hold a glob pattern */
+#define PATH_RULE_REGEX_TAG "regex:" /* blacklist lines starting with it hold a regular expression */
+
+#define PATH_DFA_MAX_STATES 8192 /* max states of one automaton, rules that need more are split into several */
+
+#define PATH_DFA_ACCEPT (1U << 31) /* transition flag, a path ending in the target state matches */
+#define PATH_DFA_STICKY (1U << 30) /* transition flag, every path reaching the target state matches, whatever follows */
+#define PATH_DFA_ROW_MASK (PATH_DFA_STICKY - 1) /* bits of a transition holding the row of the target state */
+
+/**
+ * @brief rule read from the blacklist
+ */
+struct path_rule {
+    int kind; /** > PATH_RULE_GLOB or PATH_RULE_REGEX */
+    char *pattern; /** > malloc'ed pattern, without its tag */
+};
+
+/**
+ * @brief deterministic automaton matching a set of rules
+ *  
+ * bytes that no rule tells apart share a class, so a state only holds one transition per class
+ *  
+ * a transition holds the offset of the row of its target, flagged with PATH_DFA_ACCEPT and PATH_DFA_STICKY,
+ * so a byte costs one load
+ */
+struct path_dfa {
+    uint32_t *next; /** > transitions, next[row + class], row 0 is the dead state */
+    uint32_t states; /** > count of states */
+    uint32_t start; /** > transition to the initial state */
+    uint16_t classes; /** > count of byte classes */
+    uint8_t byte_class[256]; /** > class of every byte */
+};
+
+/**
+ * @brief glob and regex rules of the blacklist
+ *  
+ * every rule is compiled into the same automaton, so a path is matched in one pass,
+ * unless the automaton would be too large and has to be split
+ */
+struct path_rules {
+    struct path_rule *rules; /** > rules added since the last clear */
+    size_t count; /** > count of rules */
+    size_t cap; /** > allocated rules */
+    struct path_dfa *dfas; /** > automatons built by path_rules_compile */
+    size_t dfa_count; /** > count of automatons */
+    size_t states; /** > states of every automaton */
+};
+
+/**
+ * @brief returns the kind of a blacklist line
+ * 
+ * @param line line of the blacklist
+ * @param pattern set to the pattern of the line, after its tag
+ * @return PATH_RULE_PREFIX, PATH_RULE_GLOB or PATH_RULE_REGEX
+ */
+int path_rule_kind(const char *line, const char **pattern);
+
+/**
+ * @brief checks if a pattern is valid
+ *  
+ * globs support '*', '?', '[...]' and '\' escapes, '*' also matches '/'
+ *  
+ * regular expressions support '.', '[...]', '*', '+', '?', '|', groups, and
+ * '^' / '$' anchors at the ends of the pattern, an unanchored one matches anywhere in the path
+ * 
+ * @param kind PATH_RULE_GLOB or PATH_RULE_REGEX
+ * @param pattern pattern that is going to be checked
+ * @param error set to a static description of the error, may be NULL
+ * @return 1 if valid, 0 if not valid
+ */
+int path_rule_check(int kind, const char *pattern, const char **error);
+
+/**
+ * @brief initializes an empty set of rules
+ * 
+ * @param rules rules struct that is going to be initialized
+ */
+void path_rules_init(struct path_rules *rules);
+
+/**
+ * @brief adds a rule, it does not match until path_rules_compile is called
+ * 
+ * @param rules rules struct
+ * @param kind PATH_RULE_GLOB or PATH_RULE_REGEX
+ * @param pattern pattern of the rule
+ * @param error set to a static description of the error, may be NULL
+ * @return 1 if added, 0 if the pattern is not valid or on allocation failure
+ */
+int path_rules_add(struct path_rules *rules, int kind, const char *pattern, const char **error);
+
+/**
+ * @brief compiles every rule added into automatons, replacing the previous ones
+ *  
+ * rules are compiled together, the set is halved until every half fits in PATH_DFA_MAX_STATES
+ * 
+ * @param rules rules struct
+ * @return count of rules dropped because they alone need more than PATH_DFA_MAX_STATES
+ */
+size_t path_rules_compile(struct path_rules *rules);
+
+/**
+ * @brief checks if a path matches any compiled rule
+ *  
+ * no memory is allocated, stops as soon as a match is certain
+ * 
+ * @param rules rules struct
+ * @param path path that is going to be checked
+ * @return 1 if matched, 0 otherwise
+ */
+int path_rules_match(const struct path_rules *rules, const char *path);
+
+/**
+ * @brief frees every rule and automaton, leaving the set empty
+ * 
+ * @param rules rules struct
+ */
+void path_rules_clear(struct path_rules *rules);
+
+#endif
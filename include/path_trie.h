@@ -0,0 +1,98 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/path_trie.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _PATH_TRIE_H_
+#define _PATH_TRIE_H_
+
+#include <stddef.h> /* size_t */
+#include "uthash.h" /* UT_hash_handle */
+
+#define PATH_TRIE_EXACT 1 /* matches only the path itself */
+#define PATH_TRIE_PREFIX 2 /* matches the path and everything below it */
+
+/**
+ * @brief struct that stores one component of a path
+ *  
+ * the children are hashed by their name, so a lookup costs one hash probe per component
+ */
+struct path_trie_node {
+    struct path_trie_node *children; /** > components below this one */
+    int match; /** > PATH_TRIE_EXACT or PATH_TRIE_PREFIX if a path ends here, 0 otherwise */
+    size_t name_len; /** > length of the name */
+    UT_hash_handle hh; /** hashable by name */
+    char name[]; /** > name of the component, not null terminated */
+};
+
+/**
+ * @brief set of paths matched by whole components
+ *  
+ * '/home/a' matches '/home/a' and '/home/a/b', never '/home/ab'
+ */
+struct path_trie {
+    struct path_trie_node *children; /** > components below the root */
+    int match; /** > PATH_TRIE_PREFIX if '/' itself was inserted */
+    size_t count; /** > count of inserted paths */
+    size_t nodes; /** > count of allocated nodes */
+};
+
+/**
+ * @brief initializes an empty trie
+ * 
+ * @param trie trie struct that is going to be initialized
+ */
+void path_trie_init(struct path_trie *trie);
+
+/**
+ * @brief inserts a path into the trie
+ *  
+ * repeated and trailing slashes are ignored, relative paths are rejected
+ *  
+ * inserting a path twice keeps the widest match
+ * 
+ * @param trie trie struct
+ * @param path absolute path
+ * @param match PATH_TRIE_EXACT or PATH_TRIE_PREFIX
+ * @return 1 on success, 0 on failure
+ */
+int path_trie_insert(struct path_trie *trie, const char *path, int match);
+
+/**
+ * @brief checks if a path matches any path of the trie
+ *  
+ * walks the components of the path, stopping at the first prefix match,
+ * no memory is allocated
+ * 
+ * @param trie trie struct
+ * @param path absolute path
+ * @return 1 if matched, 0 otherwise
+ */
+int path_trie_match(const struct path_trie *trie, const char *path);
+
+/**
+ * @brief frees every node of the trie, leaving it empty
+ * 
+ * @param trie trie struct
+ */
+void path_trie_clear(struct path_trie *trie);
+
+#endif
@@ -0,0 +1,188 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/run_set.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _RUN_SET_H_
+#define _RUN_SET_H_
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+#include "file_table.h" /* file_table */
+#include "stat_counter.h" /* stat_counter */
+
+#define MANIFEST_NAME "MANIFEST" /* file of a run directory listing its live runs */
+#define RUN_FORMAT "%s/%016llx.run" /* path of a run, directory and id */
+#define RUN_PATH_LENGTH 320 /* max length of the path of a run */
+#define MAX_RUNS 256 /* max live runs of a directory */
+#define COMPACT_FANIN 4 /* runs of the same size class merged together */
+#define RUN_CLASS_SIZE (1ULL << 20) /* bytes of the largest run of size class 0 */
+#define RUN_CLASS_FACTOR 4 /* ratio between the sizes of consecutive classes */
+
+/**
+ * @brief run listed in a manifest
+ *  
+ * a run is a snapshot holding the counters added, and the deletes and renames done,
+ * since the run before it; the runs of a directory summed from the oldest one give the whole history
+ */
+struct run_info {
+    uint64_t id; /** > id of the run, names its file */
+    uint64_t size; /** > bytes of the file, sets its size class */
+};
+
+/**
+ * @brief live runs of a directory, oldest first
+ *  
+ * the manifest is replaced with a rename, so adding or merging runs is atomic:
+ * files of runs not listed in it are leftovers of a write that didnt complete
+ */
+struct manifest {
+    uint64_t segment; /** > last write-ahead log segment merged into the runs */
+    uint64_t next_id; /** > id of the next run written */
+    size_t count; /** > count of runs */
+    struct run_info runs[MAX_RUNS]; /** > runs, oldest first */
+};
+
+/**
+ * @brief statistics of the compactions of a directory
+ *  
+ * the new runs are counted by the thread writing them,
+ * everything else by the thread compacting them
+ */
+struct compaction_stats {
+    stat_counter flushed; /** > bytes of the runs written from the write-ahead log */
+    stat_counter compactions; /** > merges done */
+    stat_counter merged; /** > runs merged */
+    stat_counter read; /** > bytes of the runs merged */
+    stat_counter written; /** > bytes of the runs written by merges */
+};
+
+/* decides if a path is kept while merging runs, returns 1 to keep it */
+typedef int run_filter(const char *path, void *arg);
+
+/**
+ * @brief formats the path of a run
+ * 
+ * @param dir directory of the runs
+ * @param id id of the run
+ * @param buff buffer the path is written into, RUN_PATH_LENGTH bytes
+ */
+void run_path(const char *dir, uint64_t id, char *buff);
+
+/**
+ * @brief reads the manifest of a directory
+ * 
+ * @param dir directory of the runs
+ * @param m manifest struct, left empty if there is no manifest
+ * @return 1 if loaded, 0 if there is no manifest, -1 if it is damaged
+ */
+int manifest_load(const char *dir, struct manifest *m);
+
+/**
+ * @brief replaces the manifest of a directory
+ * 
+ * @param dir directory of the runs
+ * @param m manifest struct
+ * @param sync flag indicating if the manifest is synced before and after being renamed
+ * @return 1 if successful, 0 if failed
+ */
+int manifest_save(const char *dir, const struct manifest *m, int sync);
+
+/**
+ * @brief removes the files of a directory that are not live runs or the manifest
+ * 
+ * @param dir directory of the runs
+ * @param m manifest struct
+ * @return count of files removed
+ */
+size_t manifest_clean(const char *dir, const struct manifest *m);
+
+/**
+ * @brief size class of a run
+ *  
+ * class 0 holds runs up to RUN_CLASS_SIZE bytes, each class after it
+ * holds runs RUN_CLASS_FACTOR times bigger
+ * 
+ * @param size bytes of the run
+ * @return size class
+ */
+unsigned run_class(uint64_t size);
+
+/**
+ * @brief picks the runs that must be merged next
+ *  
+ * tiered: once COMPACT_FANIN adjacent runs of the same class pile up anywhere in the manifest
+ * they are merged into a single run, which usually belongs to the next class,
+ * so each counter is rewritten once per class and write amplification stays logarithmic
+ *  
+ * runs are not always ordered by size, a checkpoint after a busy interval can add a run bigger
+ * than the ones before it; when no tier is full, runs followed by a run of a higher class
+ * are merged into it, so they are never stranded below COMPACT_FANIN
+ *  
+ * only adjacent runs are merged, their deletes and renames keep their order
+ * 
+ * @param m manifest struct
+ * @param first index of the oldest run to merge
+ * @return count of runs to merge, 0 if none
+ */
+size_t compaction_pick(const struct manifest *m, size_t *first);
+
+/**
+ * @brief merges adjacent runs into a new one
+ *  
+ * the counters of each run are added on top of the older ones after applying its deletes and renames,
+ * the operations are kept for the runs older than the merged ones, unless the oldest live run is merged
+ *  
+ * the activities are summed the same way, those with every bucket out of its ring are dropped
+ * 
+ * @param dir directory of the runs
+ * @param runs runs merged, oldest first
+ * @param count count of runs
+ * @param bottom flag indicating if the oldest run merged is the oldest live run
+ * @param id id of the new run
+ * @param filter function deciding which paths are kept, NULL keeps every path
+ * @param arg argument passed to filter
+ * @param sync flag indicating if the new run is synced before being renamed
+ * @param size set to the bytes of the new run
+ * @param stats statistics updated
+ * @return 1 if successful, 0 if failed
+ */
+int run_merge(const char *dir, const struct run_info *runs, size_t count, int bottom, uint64_t id,
+              run_filter *filter, void *arg, int sync, uint64_t *size, struct compaction_stats *stats);
+
+/**
+ * @brief reads the counters of every file under a path from the runs of a directory
+ *  
+ * only the blocks holding the path are read from each run, and the blocks of the paths
+ * renamed into it; deletes and renames are applied in the order they happened
+ *  
+ * the table can hold files outside the path too, it must be walked from the path,
+ * the activity of each file is summed with the counters, see getactivity
+ * 
+ * @param dir directory of the runs
+ * @param path directory or file searched, "" for every file
+ * @param out table the files are added to
+ * @param runs set to the count of runs read
+ * @return 1 if successful, 0 if failed
+ */
+int run_set_query(const char *dir, const char *path, struct file_table *out, size_t *runs);
+
+#endif /* _RUN_SET_H_ */
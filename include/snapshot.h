@@ -0,0 +1,252 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/snapshot.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t, uint64_t */
+#include "activity.h" /* activity */
+
+#define SNAPSHOT_MAGIC "FLIDX001" /* first bytes of a snapshot */
+#define SNAPSHOT_MAGIC_SIZE 8 /* length of SNAPSHOT_MAGIC without its terminator */
+#define SNAPSHOT_VERSION 4 /* version of the layout written */
+#define SNAPSHOT_MIN_VERSION 2 /* oldest version read, it has no activity section */
+#define SNAPSHOT_ACTIVITY_VERSION 4 /* oldest version whose activities are read, those of version 3 had shorter rings */
+#define SNAPSHOT_BLOCK_ENTRIES 64 /* paths per block of the sparse index */
+
+/**
+ * @brief first bytes of a snapshot
+ *  
+ * a snapshot is laid out as the header, the counters, the sparse index, the operations and the paths:
+ *  
+ * - the paths are sorted and stored one after another, each with its terminator
+ *  
+ * - the counters are fixed width, the counters of the n-th path are the n-th ones
+ *  
+ * - the sparse index holds the offset of the first path of each block of SNAPSHOT_BLOCK_ENTRIES paths,
+ * so a lookup binary searches the index and only scans a single block
+ *  
+ * - the operations are deletes and renames that apply to the snapshots older than this one,
+ * in the order they happened, their paths are stored after the sorted paths
+ *  
+ * - the activities are the time bucketed counters of the paths that have any,
+ * ordered by the index of their path
+ */
+struct snapshot_header {
+    char magic[SNAPSHOT_MAGIC_SIZE]; /** > SNAPSHOT_MAGIC */
+    uint32_t version; /** > SNAPSHOT_VERSION */
+    uint32_t block_entries; /** > paths per block of the sparse index */
+    uint64_t count; /** > count of paths */
+    uint64_t segment; /** > last write-ahead log segment merged into the snapshot */
+    uint64_t counters_offset; /** > offset of the counters from the start of the file */
+    uint64_t index_offset; /** > offset of the sparse index */
+    uint64_t strings_offset; /** > offset of the paths */
+    uint64_t strings_size; /** > bytes of the paths, terminators included */
+    uint64_t ops_offset; /** > offset of the operations */
+    uint64_t ops_count; /** > count of operations */
+    uint64_t activity_offset; /** > offset of the activities, read since SNAPSHOT_ACTIVITY_VERSION */
+    uint64_t activity_count; /** > count of activities, read since SNAPSHOT_ACTIVITY_VERSION */
+};
+
+/**
+ * kind of an operation of a snapshot
+ */
+enum snapshot_op_type {
+    SNAPSHOT_DELETE = 1, /** > drops every path under a path */
+    SNAPSHOT_MOVE = 2 /** > moves every path under a path to another one */
+};
+
+/**
+ * @brief delete or rename stored in a snapshot
+ */
+struct snapshot_op {
+    uint32_t type; /** > snapshot_op_type */
+    uint32_t reserved; /** > always 0 */
+    uint64_t from; /** > offset in the strings of the path deleted or renamed */
+    uint64_t to; /** > offset in the strings of the new path of a rename, 0 for a delete */
+};
+
+/**
+ * @brief counters of a path
+ */
+struct snapshot_counter {
+    uint32_t opened; /** > count of the opening event */
+    uint32_t modified; /** > count of the modifying event */
+};
+
+/**
+ * @brief time bucketed counters of a path
+ */
+struct snapshot_activity {
+    uint64_t entry; /** > index of the path */
+    struct activity activity; /** > buckets of the path */
+};
+
+/**
+ * @brief path added to a snapshot being built
+ */
+struct snapshot_entry {
+    size_t path; /** > offset of the path in the strings of the builder */
+    struct snapshot_counter counter; /** > counters of the path */
+    size_t activity; /** > index of the activity of the path in the builder, SIZE_MAX if none */
+};
+
+/**
+ * @brief paths collected before a snapshot is written
+ *  
+ * the paths can be added in any order, they are sorted when the snapshot is published
+ */
+struct snapshot_builder {
+    char *strings; /** > malloc'ed paths, each with its terminator */
+    size_t used; /** > bytes used of strings */
+    size_t cap; /** > bytes allocated for strings */
+    struct snapshot_entry *entries; /** > malloc'ed entries */
+    size_t count; /** > count of entries */
+    size_t entries_cap; /** > entries allocated */
+    struct snapshot_op *ops; /** > malloc'ed operations, their offsets point into strings */
+    size_t ops_count; /** > count of operations */
+    size_t ops_cap; /** > operations allocated */
+    struct activity *activities; /** > malloc'ed activities of the entries */
+    size_t activity_count; /** > count of activities */
+    size_t activity_cap; /** > activities allocated */
+    int failed; /** > set if a path couldnt be added */
+};
+
+/**
+ * @brief snapshot mapped in memory
+ *  
+ * the file is only read through the mapping,
+ * so a lookup only faults in the pages of the blocks it scans
+ */
+struct snapshot {
+    const unsigned char *map; /** > mapping of the whole file */
+    size_t size; /** > size of the mapping */
+    const struct snapshot_header *header; /** > header, at the start of the mapping */
+    const struct snapshot_counter *counters; /** > counters of every path */
+    const uint64_t *index; /** > offset in strings of the first path of each block */
+    const char *strings; /** > sorted paths, followed by the paths of the operations */
+    const struct snapshot_op *ops; /** > operations, in the order they happened */
+    const struct snapshot_activity *activities; /** > activities, in the order of their paths */
+    uint64_t activity_count; /** > count of activities, 0 for a snapshot older than SNAPSHOT_ACTIVITY_VERSION */
+    uint64_t blocks; /** > count of blocks */
+};
+
+/* called for each path found by snapshot_walk, activity is NULL for a path without one */
+typedef void snapshot_handler(const char *path, size_t len, const struct snapshot_counter *counter,
+                              const struct activity *activity, void *arg);
+
+/* called for each operation of a snapshot, to is NULL for a delete */
+typedef void snapshot_op_handler(const char *from, const char *to, void *arg);
+
+/**
+ * @brief adds a path to a builder
+ *  
+ * a zeroed builder is empty
+ * 
+ * @param builder builder struct
+ * @param path full path of the file
+ * @param len length of path
+ * @param opened count of the opening event
+ * @param modified count of the modifying event
+ * @param activity time bucketed counters of the path, copied, NULL if none
+ * @return 1 if successful, 0 if failed
+ */
+int snapshot_add(struct snapshot_builder *builder, const char *path, size_t len, uint32_t opened, uint32_t modified,
+                 const struct activity *activity);
+
+/**
+ * @brief adds an operation to a builder
+ *  
+ * operations keep the order they were added in
+ * 
+ * @param builder builder struct
+ * @param from path deleted or renamed
+ * @param to new path of a rename, NULL for a delete
+ * @return 1 if successful, 0 if failed
+ */
+int snapshot_add_op(struct snapshot_builder *builder, const char *from, const char *to);
+
+/**
+ * @brief writes the paths of a builder as a snapshot
+ *  
+ * the snapshot is written to tmp_path and renamed over path once complete,
+ * so readers always map either the previous snapshot or the new one
+ * 
+ * @param builder builder struct, its entries are sorted
+ * @param path path of the snapshot
+ * @param tmp_path path the snapshot is written to before being renamed
+ * @param segment last write-ahead log segment merged into the snapshot
+ * @param sync flag indicating if the file is synced before being renamed
+ * @return 1 if successful, 0 if failed
+ */
+int snapshot_publish(struct snapshot_builder *builder, const char *path, const char *tmp_path, uint64_t segment, int sync);
+
+/**
+ * @brief frees the paths of a builder, leaving it empty
+ * 
+ * @param builder builder struct
+ */
+void snapshot_clear(struct snapshot_builder *builder);
+
+/**
+ * @brief maps a snapshot
+ * 
+ * @param snap snapshot struct that is going to be initialized
+ * @param path path of the snapshot
+ * @return 1 if successful, 0 if the file couldnt be mapped or is not a valid snapshot
+ */
+int snapshot_open(struct snapshot *snap, const char *path);
+
+/**
+ * @brief unmaps a snapshot
+ * 
+ * @param snap snapshot struct
+ */
+void snapshot_close(struct snapshot *snap);
+
+/**
+ * @brief calls a handler for every path starting with a prefix, in order
+ *  
+ * the first path is found with a binary search of the sparse index,
+ * then the paths are scanned until one doesnt start with the prefix
+ * 
+ * @param snap snapshot struct
+ * @param prefix prefix of the paths, a directory ending in '/' or "" for every path
+ * @param handler function called for each path
+ * @param arg argument passed to handler
+ * @return count of paths found
+ */
+size_t snapshot_walk(const struct snapshot *snap, const char *prefix, snapshot_handler *handler, void *arg);
+
+/**
+ * @brief calls a handler for every operation of a snapshot, in the order they happened
+ * 
+ * @param snap snapshot struct
+ * @param handler function called for each operation
+ * @param arg argument passed to handler
+ * @return count of operations
+ */
+size_t snapshot_ops(const struct snapshot *snap, snapshot_op_handler *handler, void *arg);
+
+#endif /* _SNAPSHOT_H_ */
@@ -0,0 +1,85 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/stat_counter.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _STAT_COUNTER_H_
+#define _STAT_COUNTER_H_
+
+#include <stdint.h> /* uint64_t */
+#include <stdatomic.h> /* _Atomic, atomic_load_explicit, atomic_store_explicit, memory_order_relaxed */
+
+/**
+ * @brief counter written by a single thread and read by any other
+ *  
+ * updates are plain relaxed stores, so counting on the hot path
+ * costs the same as a regular increment
+ */
+typedef _Atomic uint64_t stat_counter;
+
+/**
+ * @brief adds a value to a counter
+ *  
+ * must only be called from the thread that owns the counter
+ * 
+ * @param counter counter that is going to be updated
+ * @param n value added to the counter
+ */
+static inline void stat_add(stat_counter *counter, uint64_t n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+/**
+ * @brief raises a counter to a value if it is greater
+ *  
+ * must only be called from the thread that owns the counter
+ * 
+ * @param counter counter that is going to be updated
+ * @param n candidate value
+ */
+static inline void stat_max(stat_counter *counter, uint64_t n) {
+    if (n > atomic_load_explicit(counter, memory_order_relaxed))
+        atomic_store_explicit(counter, n, memory_order_relaxed);
+}
+
+/**
+ * @brief sets a counter used as a gauge
+ *  
+ * must only be called from the thread that owns the counter
+ * 
+ * @param counter counter that is going to be updated
+ * @param n new value
+ */
+static inline void stat_set(stat_counter *counter, uint64_t n) {
+    atomic_store_explicit(counter, n, memory_order_relaxed);
+}
+
+/**
+ * @brief reads the current value of a counter from any thread
+ * 
+ * @param counter counter that is going to be read
+ * @return value of the counter
+ */
+static inline uint64_t stat_get(stat_counter *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+#endif /* _STAT_COUNTER_H_ */
@@ -0,0 +1,247 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/include/wal.h
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _WAL_H_
+#define _WAL_H_
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint8_t, uint32_t, uint64_t */
+#include "io_ring.h" /* io_ring */
+
+#define WAL_MAGIC "FLWAL001" /* first bytes of every segment, followed by its id */
+#define WAL_MAGIC_SIZE 8 /* length of WAL_MAGIC without its terminator */
+#define WAL_HEADER_SIZE 16 /* bytes of the header of a segment, magic and id */
+#define WAL_RECORD_HEADER 8 /* bytes before each record, length and crc of its payload */
+#define WAL_MAX_PAYLOAD 16384 /* max length of a record, anything longer is treated as a torn write */
+#define WAL_SEGMENT_SIZE (4U << 20) /* bytes a segment can grow to before a new one is started */
+#define WAL_DIR_LENGTH 256 /* max length of the directory of the segments */
+#define WAL_SEGMENT_FORMAT "%s/%016llx.wal" /* path of a segment, directory and id */
+
+/**
+ * kind of a record, the first byte of its payload
+ */
+enum wal_type {
+    WAL_COUNT = 1, /** > counters added to a file, opened and modified deltas */
+    WAL_DELETE = 2, /** > file or directory deleted, drops every entry under the path */
+    WAL_MOVE = 3, /** > file or directory renamed, moves every entry under the path */
+    WAL_TIME = 4 /** > seconds since the epoch the counters after it were committed at */
+};
+
+/**
+ * when the segments are flushed to the disk
+ */
+enum wal_sync {
+    WAL_SYNC_COMMIT, /** > after each group commit, nothing committed is lost on a crash */
+    WAL_SYNC_SEGMENT, /** > when a segment is sealed, a crash loses at most the open segment */
+    WAL_SYNC_NONE /** > left to the kernel writeback */
+};
+
+/**
+ * @brief append-only log of counter deltas, split in numbered segments
+ *  
+ * records are buffered and written together by wal_commit,
+ * each one is prefixed by its length and the crc32c of its payload,
+ * so a torn write at the end of a segment is detected when replaying
+ *  
+ * records are only appended, the segments are removed once they were merged
+ *  
+ * with a ring, a group is written and synced in the background while the next one is built,
+ * the commit after it, or the next rotation, waits for it
+ */
+struct wal {
+    char dir[WAL_DIR_LENGTH]; /** > directory of the segments */
+    int fd; /** > open segment, -1 if the log is closed */
+    uint64_t segment; /** > id of the open segment */
+    size_t size; /** > bytes of the open segment */
+    enum wal_sync sync; /** > fsync policy */
+    unsigned char *buff; /** > records of the group being built */
+    size_t len; /** > bytes used of buff */
+    size_t cap; /** > bytes allocated for buff */
+    size_t pending; /** > records in buff */
+    int failed; /** > set when a record couldnt be buffered, the whole group is dropped */
+    uint64_t time; /** > seconds since the epoch stamped before the counters of the group, 0 for none */
+    int stamped; /** > set once the time of the group was added */
+    struct io_ring *ring; /** > ring the groups are written through, NULL for blocking writes, set after wal_open */
+    unsigned char *inflight; /** > group being written through the ring, swapped with buff */
+    size_t inflight_cap; /** > bytes allocated for inflight */
+    size_t inflight_start; /** > offset of the group in flight in the open segment */
+    size_t inflight_len; /** > bytes of the group in flight, 0 if none */
+    unsigned inflight_ops; /** > requests of the group in flight not completed yet */
+};
+
+/**
+ * @brief record read back from a segment
+ */
+struct wal_entry {
+    enum wal_type type; /** > kind of the record */
+    const char *path; /** > file the record applies to */
+    const char *to; /** > new path of a WAL_MOVE record, NULL otherwise */
+    uint64_t time; /** > seconds since the epoch of a WAL_TIME record */
+    uint32_t opened; /** > openings added by a WAL_COUNT record */
+    uint32_t modified; /** > modifications added by a WAL_COUNT record */
+};
+
+/* called for each valid record while replaying, the strings are only valid during the call */
+typedef void wal_handler(const struct wal_entry *entry, void *arg);
+
+/**
+ * @brief opens the log, starting a new segment
+ *  
+ * the segment is created empty, segments left by a previous run must
+ * be replayed and removed before, or have a lower id
+ * 
+ * @param wal log struct that is going to be initialized
+ * @param dir directory of the segments, must exist
+ * @param sync fsync policy
+ * @param segment id of the first segment, 1 or higher
+ * @return 1 if successful, 0 if failed
+ */
+int wal_open(struct wal *wal, const char *dir, enum wal_sync sync, uint64_t segment);
+
+/**
+ * @brief sets the time of the counters of the current group
+ *  
+ * the time is written before the first counters of the group,
+ * a group without counters writes no time
+ * 
+ * @param wal log struct
+ * @param time seconds since the epoch
+ */
+void wal_time(struct wal *wal, uint64_t time);
+
+/**
+ * @brief adds the counters of a file to the current group
+ * 
+ * @param wal log struct
+ * @param path full path of the file
+ * @param len length of path
+ * @param opened openings since the last commit
+ * @param modified modifications since the last commit
+ * @return 1 if successful, 0 if failed
+ */
+int wal_count(struct wal *wal, const char *path, size_t len, uint32_t opened, uint32_t modified);
+
+/**
+ * @brief adds a delete to the current group
+ * 
+ * @param wal log struct
+ * @param path path deleted
+ * @return 1 if successful, 0 if failed
+ */
+int wal_delete(struct wal *wal, const char *path);
+
+/**
+ * @brief adds a rename to the current group
+ * 
+ * @param wal log struct
+ * @param from old path
+ * @param to new path
+ * @return 1 if successful, 0 if failed
+ */
+int wal_move(struct wal *wal, const char *from, const char *to);
+
+/**
+ * @brief writes the current group with a single write
+ *  
+ * synced when the policy is WAL_SYNC_COMMIT, a new segment is started
+ * once the open one grows past WAL_SEGMENT_SIZE
+ *  
+ * a group that couldnt be written is cut off from the segment and dropped,
+ * so the records after it can still be replayed
+ *  
+ * with a ring, the write and its sync are only submitted, the group before
+ * is waited for first, so a failure can be reported one commit late
+ * 
+ * @param wal log struct
+ * @return 1 if successful or there was nothing to write, 0 if this group or the one in flight failed
+ */
+int wal_commit(struct wal *wal);
+
+/**
+ * @brief seals the open segment and starts the next one
+ *  
+ * the group in flight is waited for first
+ * 
+ * @param wal log struct
+ * @return 1 if successful, 0 if failed
+ */
+int wal_rotate(struct wal *wal);
+
+/**
+ * @brief syncs and closes the open segment, and frees the group buffer
+ *  
+ * the open segment is removed if nothing was committed to it
+ * 
+ * @param wal log struct
+ */
+void wal_close(struct wal *wal);
+
+/**
+ * @brief finds the lowest and highest segment ids of a directory
+ * 
+ * @param dir directory of the segments
+ * @param first lowest id found
+ * @param last highest id found
+ * @return count of segments found, first and last are only set if there was any
+ */
+size_t wal_range(const char *dir, uint64_t *first, uint64_t *last);
+
+/**
+ * @brief reads back the records of a range of segments, in the order they were written
+ *  
+ * missing segments are skipped, a segment is read up to its first record
+ * with a bad length or crc, the tail left by a crash in the middle of a write
+ * 
+ * @param dir directory of the segments
+ * @param first lowest id replayed
+ * @param last highest id replayed
+ * @param handler function called for each record
+ * @param arg argument passed to handler
+ * @param torn set to the count of segments that ended in a damaged record
+ * @return count of records replayed
+ */
+size_t wal_replay(const char *dir, uint64_t first, uint64_t last, wal_handler *handler, void *arg, size_t *torn);
+
+/**
+ * @brief removes every segment up to an id
+ *  
+ * with a ring, the unlinks are submitted in batches, falling back to unlink on kernels without IORING_OP_UNLINKAT;
+ * the ring must have no group in flight
+ * 
+ * @param dir directory of the segments
+ * @param last highest id removed
+ * @param ring ring the unlinks are submitted through, NULL for blocking unlinks
+ * @return count of segments removed
+ */
+size_t wal_remove(const char *dir, uint64_t last, struct io_ring *ring);
+
+/**
+ * @brief crc32c (castagnoli) of a buffer
+ * 
+ * @param data bytes
+ * @param len count of bytes
+ * @return checksum
+ */
+uint32_t wal_crc32c(const void *data, size_t len);
+
+#endif /* _WAL_H_ */
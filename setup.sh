@@ -4,19 +4,40 @@ compile_flags="-g -O3 -Iinclude"
 service_file="/etc/systemd/system/file-listener.service"
 working_dir="/var/log/file-listener"
 auto_start=0
+run_tests=0
 version="0.0.0"
 
-while getopts "s" o; do
+while getopts "st" o; do
     case "$o" in
         s)
             auto_start=1
             ;;
+        t)
+            run_tests=1
+            ;;
         *)
-            echo "Not valid flag, you may only use '-s' flag."
+            echo "Not valid flag, you may only use '-s' or '-t' flags."
             exit 1
     esac
 done
 
+listener_srcs="src/listener/path_cache.c src/listener/path_trie.c src/listener/path_rules.c src/listener/event_ring.c src/listener/burst_filter.c src/listener/wal.c src/listener/io_ring.c src/listener/line_writer.c src/file_table.c src/activity.c src/snapshot.c src/run_set.c src/line_reader.c"
+
+if (( run_tests )); then
+    echo "Compiling tests..."
+    gcc $compile_flags tests/alloc_events.c $listener_srcs -Llib -lfileutils -pthread -o alloc_events || exit 1
+    gcc $compile_flags tests/compaction_pick.c src/run_set.c src/snapshot.c src/file_table.c src/activity.c -o compaction_pick || exit 1
+    gcc $compile_flags tests/activity_window.c src/activity.c -o activity_window || exit 1
+
+    echo "Running tests..."
+    status=0
+    sudo LD_LIBRARY_PATH=lib ./alloc_events || status=1
+    ./compaction_pick || status=1
+    ./activity_window || status=1
+    rm -f alloc_events compaction_pick activity_window
+    exit $status
+fi
+
 sudo echo "Hi :3"
 
 echo "Moving shared libraries to '/usr/local/lib'..."
@@ -28,9 +49,9 @@ echo "Moving header files of libraries to '/usr/local/include'..."
 sudo mv -v include/*utils.h /usr/local/include
 
 echo "Compiling components..."
-gcc $compile_flags src/fview.c -lprocutils -o fview
-gcc $compile_flags src/listener/file_listener.c src/file_table.c -lfileutils -lstrutils -o file-listener
-gcc $compile_flags src/listener/listener_blacklist/addflblk.c -lprocutils -lfileutils -o addflblk
+gcc $compile_flags src/fview.c src/snapshot.c src/run_set.c src/file_table.c src/activity.c src/line_reader.c -lprocutils -lfileutils -o fview
+gcc $compile_flags src/listener/file_listener.c $listener_srcs -lfileutils -pthread -o file-listener
+gcc $compile_flags src/listener/listener_blacklist/addflblk.c src/listener/path_rules.c -lprocutils -lfileutils -o addflblk
 
 echo "Moving file-listener to '/usr/sbin'..."
 sudo mv -v file-listener /usr/sbin
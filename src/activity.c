@@ -0,0 +1,169 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/activity.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t, uint64_t, UINT32_MAX */
+#include <string.h> /* memset */
+#include "activity.h"
+
+/**
+ * @brief ring of buckets of the same length
+ */
+struct tier {
+    size_t first; /** > index of the first bucket of the ring */
+    uint32_t size; /** > count of buckets */
+    uint32_t unit; /** > minutes covered by each bucket */
+};
+
+/* finest ring first */
+static const struct tier tiers[] = {
+    { 0, ACTIVITY_MINUTES, 1 },
+    { ACTIVITY_MINUTES, ACTIVITY_HOURS, 60 },
+    { ACTIVITY_MINUTES + ACTIVITY_HOURS, ACTIVITY_DAYS, 1440 }
+};
+
+#define TIER_COUNT (sizeof(tiers) / sizeof(tiers[0]))
+
+static uint32_t saturated_add(uint32_t a, uint32_t b) {
+    return (a > UINT32_MAX - b) ? UINT32_MAX : a + b;
+}
+
+/* the bucket of a unit is still in the ring of an activity stamped at stamp */
+static int in_ring(const struct tier *t, uint32_t stamp, uint32_t unit) {
+    uint32_t newest = stamp / t->unit;
+
+    return unit <= newest && newest - unit < t->size;
+}
+
+/* moves the rings forward to a minute, clearing the buckets that go out of them */
+static void roll(struct activity *activity, uint32_t now) {
+    for (size_t i = 0; i < TIER_COUNT; i++) {
+        const struct tier *t = &tiers[i];
+        uint32_t from = activity->stamp / t->unit;
+        uint32_t to = now / t->unit;
+
+        if (to - from >= t->size) {
+            memset(&activity->opened[t->first], 0, sizeof(uint32_t) * t->size);
+            memset(&activity->modified[t->first], 0, sizeof(uint32_t) * t->size);
+            continue;
+        }
+
+        for (uint32_t unit = from + 1; unit <= to; unit++) {
+            activity->opened[t->first + unit % t->size] = 0;
+            activity->modified[t->first + unit % t->size] = 0;
+        }
+    }
+
+    activity->stamp = now;
+}
+
+void activity_add(struct activity *activity, uint32_t minute, uint32_t opened, uint32_t modified) {
+    if (activity->stamp == 0)
+        activity->stamp = minute;
+    else if (minute > activity->stamp)
+        roll(activity, minute);
+
+    for (size_t i = 0; i < TIER_COUNT; i++) {
+        const struct tier *t = &tiers[i];
+        uint32_t unit = minute / t->unit;
+        if (!in_ring(t, activity->stamp, unit))
+            continue;
+
+        size_t b = t->first + unit % t->size;
+        activity->opened[b] = saturated_add(activity->opened[b], opened);
+        activity->modified[b] = saturated_add(activity->modified[b], modified);
+    }
+}
+
+void activity_merge(struct activity *dst, const struct activity *src) {
+    if (src->stamp == 0)
+        return;
+
+    if (dst->stamp == 0) {
+        *dst = *src;
+        return;
+    }
+
+    if (src->stamp > dst->stamp)
+        roll(dst, src->stamp);
+
+    for (size_t i = 0; i < TIER_COUNT; i++) {
+        const struct tier *t = &tiers[i];
+        uint32_t newest = src->stamp / t->unit;
+
+        for (uint32_t k = 0; k < t->size && k <= newest; k++) {
+            uint32_t unit = newest - k;
+            if (!in_ring(t, dst->stamp, unit))
+                continue;
+
+            size_t b = t->first + unit % t->size;
+            dst->opened[b] = saturated_add(dst->opened[b], src->opened[b]);
+            dst->modified[b] = saturated_add(dst->modified[b], src->modified[b]);
+        }
+    }
+}
+
+int activity_expired(const struct activity *activity, uint32_t now) {
+    /* the last ring covers the longest time */
+    const struct tier *t = &tiers[TIER_COUNT - 1];
+    uint32_t newest = activity->stamp / t->unit;
+
+    /* a clock set back keeps the activity until it catches up */
+    return activity->stamp == 0 || (now / t->unit >= newest && now / t->unit - newest >= t->size);
+}
+
+void activity_window(const struct activity *activity, uint32_t now, uint32_t window, uint64_t *opened, uint64_t *modified) {
+    *opened = 0;
+    *modified = 0;
+
+    if (!activity || activity->stamp == 0 || window == 0)
+        return;
+
+    if (window > ACTIVITY_MAX_WINDOW)
+        window = ACTIVITY_MAX_WINDOW;
+
+    /* the current bucket only holds the minutes up to now, the oldest one is counted whole */
+    uint32_t oldest = (now >= window - 1) ? now - (window - 1) : 0;
+
+    const struct tier *t = &tiers[TIER_COUNT - 1];
+    for (size_t i = 0; i < TIER_COUNT; i++) {
+        if (now / tiers[i].unit - oldest / tiers[i].unit < tiers[i].size) {
+            t = &tiers[i];
+            break;
+        }
+    }
+
+    uint32_t newest = now / t->unit;
+    uint32_t units = newest - oldest / t->unit + 1;
+
+    for (uint32_t k = 0; k < units && k <= newest; k++) {
+        uint32_t unit = newest - k;
+
+        /* buckets the rings didnt reach yet hold older events, they are not in the window */
+        if (!in_ring(t, activity->stamp, unit))
+            continue;
+
+        *opened += activity->opened[t->first + unit % t->size];
+        *modified += activity->modified[t->first + unit % t->size];
+    }
+}
@@ -22,44 +22,773 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <stdio.h> /* perror */
-#include <stdlib.h> /* malloc, free */
-#include <string.h> /* strncpy */
+#include <stdlib.h> /* malloc, calloc, free */
+#include <string.h> /* memchr, memcmp, memcpy, memset, strnlen */
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint16_t, uint32_t, uint64_t, SIZE_MAX */
 #include "file_table.h"
 
-int additem(struct _file **table, const char *filename, const uint32_t op_count, const uint32_t mod_count) {
-    if (!filename || *filename == '\0') {
-        return -1;
+#define MIN_CHUNK_CAP 16 /* initial capacity of the chunk array of a table */
+#define NAME_PARENT 4 /* offset of the parent id in a name record */
+#define NAME_OFFSET 8 /* offset of the name in a name record */
+#define HASH_SEED 0x2d358dccaa6c78a5ULL /* constants of the name hash, odd and with balanced bits */
+#define HASH_MUL0 0xa0761d6478bd642fULL
+#define HASH_MUL1 0xe7037ed1a0b428dbULL
+
+/* a delete or rename, stored in the arena and linked in the order they were added */
+struct table_record {
+    uint64_t seq; /* sequence number given by the caller */
+    uint32_t from; /* node of the path deleted or renamed */
+    uint32_t to; /* node of the new path, NO_NODE for a delete */
+    uint32_t next; /* id of the next record, NO_NODE for the last one */
+};
+
+/* state of movepath() while it walks the files being moved */
+struct move_state {
+    const char *to; /* new path of the walked directory */
+    size_t to_len; /* length of to */
+    size_t from_len; /* length of the path of the walked directory */
+    size_t moved; /* files moved so far */
+};
+
+/* a spare slot or chunk array */
+struct spare_block {
+    void *ptr; /* freed array, NULL if the slot is empty */
+    size_t size; /* size of the array in bytes */
+};
+
+static _Thread_local char *spare_chunks = NULL; /* freed arena chunks, linked by their first bytes */
+
+static _Thread_local size_t spare_count = 0; /* count of spare chunks */
+
+static _Thread_local struct spare_block spare_blocks[MAX_SPARE_BLOCKS]; /* freed arrays, reused by size */
+
+static void *alloc_block(size_t size) {
+    for (size_t i = 0; i < MAX_SPARE_BLOCKS; i++) {
+        if (spare_blocks[i].ptr && spare_blocks[i].size == size) {
+            void *ptr = spare_blocks[i].ptr;
+            spare_blocks[i].ptr = NULL;
+            return ptr;
+        }
+    }
+
+    return malloc(size);
+}
+
+/* large arrays come from calloc as untouched zero pages, so clearing them costs nothing up front */
+static void *alloc_zeroed_block(size_t size) {
+    for (size_t i = 0; i < MAX_SPARE_BLOCKS; i++) {
+        if (spare_blocks[i].ptr && spare_blocks[i].size == size) {
+            void *ptr = spare_blocks[i].ptr;
+            spare_blocks[i].ptr = NULL;
+            return memset(ptr, 0, size);
+        }
+    }
+
+    return calloc(1, size);
+}
+
+static void free_block(void *ptr, size_t size) {
+    for (size_t i = 0; i < MAX_SPARE_BLOCKS; i++) {
+        if (!spare_blocks[i].ptr) {
+            spare_blocks[i].ptr = ptr;
+            spare_blocks[i].size = size;
+            return;
+        }
+    }
+
+    free(ptr);
+}
+
+static char *alloc_chunk(void) {
+    if (!spare_chunks)
+        return (char *)malloc(TABLE_CHUNK_SIZE);
+
+    char *chunk = spare_chunks;
+    memcpy(&spare_chunks, chunk, sizeof(spare_chunks));
+    spare_count--;
+
+    return chunk;
+}
+
+/* returns a chunk to the spare list of the calling thread */
+static void free_chunk(char *chunk) {
+    if (spare_count >= MAX_SPARE_CHUNKS) {
+        free(chunk);
+        return;
     }
 
-    struct _file *item = NULL;
-    HASH_FIND_STR(*table, filename, item);
-    if (!item) {
-        item = (struct _file *)malloc(sizeof(struct _file));
-        if (item == NULL) {
+    memcpy(chunk, &spare_chunks, sizeof(spare_chunks));
+    spare_chunks = chunk;
+    spare_count++;
+}
+
+/**
+ * @brief bump-allocates bytes from the arena of a table
+ *  
+ * the bytes never span two chunks, a new chunk is started when the last one is full
+ *  
+ * @param table table owning the arena
+ * @param size bytes requested, at most TABLE_CHUNK_SIZE
+ * @param align alignment of the bytes, a power of two
+ * @param offset set to the offset of the bytes in the arena
+ * @return pointer to the bytes, NULL if failed
+ */
+static void *arena_alloc(struct file_table *table, size_t size, size_t align, uint32_t *offset) {
+    size_t pos = (table->used + align - 1) & ~(align - 1);
+
+    if (table->chunk_count == 0 || pos + size > TABLE_CHUNK_SIZE) {
+        if (table->chunk_count >= MAX_TABLE_CHUNKS)
+            return NULL;
+
+        if (table->chunk_count == table->chunk_cap) {
+            uint32_t cap = table->chunk_cap ? table->chunk_cap * 2 : MIN_CHUNK_CAP;
+
+            char **chunks = (char **)alloc_block(sizeof(char *) * cap);
+            if (!chunks) {
+                perror("malloc");
+                return NULL;
+            }
+
+            if (table->chunks) {
+                memcpy(chunks, table->chunks, sizeof(char *) * table->chunk_count);
+                free_block(table->chunks, sizeof(char *) * table->chunk_cap);
+            }
+
+            table->chunks = chunks;
+            table->chunk_cap = cap;
+        }
+
+        char *chunk = alloc_chunk();
+        if (!chunk) {
             perror("malloc");
-            return -1;
+            return NULL;
         }
 
-        strncpy(item->key, filename, sizeof(item->key) - 1);
-        item->key[sizeof(item->key) - 1] = '\0';
-        item->opening = op_count;
-        item->modifying = mod_count;
-        HASH_ADD_STR(*table, key, item);
+        table->chunks[table->chunk_count++] = chunk;
+        pos = 0;
+    }
+
+    table->used = (uint32_t)(pos + size);
+    *offset = ((table->chunk_count - 1) << TABLE_CHUNK_SHIFT) | (uint32_t)pos;
+
+    return table->chunks[table->chunk_count - 1] + pos;
+}
+
+static void *arena_at(const struct file_table *table, uint32_t offset) {
+    return table->chunks[offset >> TABLE_CHUNK_SHIFT] + (offset & TABLE_CHUNK_MASK);
+}
+
+static struct _file *node_at(const struct file_table *table, uint32_t id) {
+    return (struct _file *)arena_at(table, id);
+}
+
+/* the name record of a node: its length, 2 bytes of padding, the id of its parent and the name */
+static const char *node_record(const struct _file *node) {
+    return (const char *)(node + 1);
+}
+
+static size_t node_name_len(const struct _file *node) {
+    uint16_t len;
+    memcpy(&len, node_record(node), sizeof(len));
+    return len;
+}
+
+static uint32_t node_parent(const struct _file *node) {
+    uint32_t parent;
+    memcpy(&parent, node_record(node) + NAME_PARENT, sizeof(parent));
+    return parent;
+}
+
+static const char *node_name(const struct _file *node) {
+    return node_record(node) + NAME_OFFSET;
+}
+
+/* multiplies two words and folds the 128 bits of the product */
+static uint64_t hash_mix(uint64_t a, uint64_t b) {
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+/* loads up to 8 bytes, zero padded */
+static uint64_t hash_load(const char *p, size_t len) {
+    uint64_t v = 0;
+    memcpy(&v, p, len < sizeof(v) ? len : sizeof(v));
+    return v;
+}
+
+/**
+ * @brief hashes the name of a node together with the id of its parent
+ *  
+ * consumes 16 bytes per round with a single wide multiplication,
+ * names of a few dozen bytes take two or three rounds
+ *  
+ * @param parent id of the parent of the node
+ * @param name name of the node, not null terminated
+ * @param len length of name
+ * @return 32 bit hash, never 0
+ */
+static uint32_t hash_name(uint32_t parent, const char *name, size_t len) {
+    uint64_t h = hash_mix(HASH_SEED ^ parent, HASH_MUL0 ^ len);
+
+    for (; len > 16; len -= 16, name += 16)
+        h = hash_mix(hash_load(name, 8) ^ HASH_MUL0, hash_load(name + 8, 8) ^ h);
+
+    uint64_t a = hash_load(name, len);
+    uint64_t b = len > 8 ? hash_load(name + 8, len - 8) : 0;
+
+    h = hash_mix(a ^ HASH_MUL0, b ^ h);
+    uint32_t hash = (uint32_t)hash_mix(h ^ HASH_MUL1, HASH_SEED);
+
+    /* 0 marks the empty slots */
+    return hash ? hash : 1;
+}
+
+static int node_equals(const struct _file *node, uint32_t parent, const char *name, size_t len) {
+    return node_name_len(node) == len &&
+           node_parent(node) == parent &&
+           memcmp(node_name(node), name, len) == 0;
+}
+
+/**
+ * @brief looks a node up in one index
+ *  
+ * a probe stops as soon as it reaches a slot closer to its home than the key would be,
+ * robin hood probing keeps every key before such a slot
+ *  
+ * @return the node, NULL if missing
+ */
+static struct _file *index_find(const struct file_table *table, const struct table_slot *slots, uint32_t mask,
+                                uint32_t hash, uint32_t parent, const char *name, size_t len) {
+    for (uint32_t i = hash & mask, dist = 0;; i = (i + 1) & mask, dist++) {
+        const struct table_slot *slot = &slots[i];
+        if (slot->hash == 0 || ((i - slot->hash) & mask) < dist)
+            return NULL;
+
+        if (slot->hash == hash) {
+            struct _file *node = node_at(table, slot->id);
+            if (node_equals(node, parent, name, len))
+                return node;
+        }
+    }
+}
+
+/* inserts a slot into an index with room left, swapping it with the richer slots on its way */
+static void index_insert(struct table_slot *slots, uint32_t mask, struct table_slot slot) {
+    for (uint32_t i = slot.hash & mask, dist = 0;; i = (i + 1) & mask, dist++) {
+        if (slots[i].hash == 0) {
+            slots[i] = slot;
+            return;
+        }
+
+        uint32_t other = (i - slots[i].hash) & mask;
+        if (other < dist) {
+            struct table_slot tmp = slots[i];
+            slots[i] = slot;
+            slot = tmp;
+            dist = other;
+        }
+    }
+}
+
+/* moves up to count slots of the old index, releasing it once all of them are moved */
+static void move_slots(struct file_table *table, size_t count) {
+    for (; count > 0 && table->moved <= table->old_mask; count--) {
+        struct table_slot slot = table->old_slots[table->moved++];
+        if (slot.hash != 0)
+            index_insert(table->slots, table->mask, slot);
+    }
+
+    if (table->moved > table->old_mask) {
+        free_block(table->old_slots, sizeof(struct table_slot) * ((size_t)table->old_mask + 1));
+        table->old_slots = NULL;
+    }
+}
+
+/**
+ * @brief makes room for one more slot in the index
+ *  
+ * a full index is replaced by one twice as large, its slots are moved by move_slots()
+ * while the next inserts happen, at RESIZE_STEP slots per insert the move ends long
+ * before the new index fills up
+ *  
+ * @return 1 if successful, 0 if failed
+ */
+static int reserve_slot(struct file_table *table) {
+    if (table->old_slots)
+        move_slots(table, RESIZE_STEP);
+
+    size_t cap = table->slots ? (size_t)table->mask + 1 : 0;
+    if ((table->filled + 1) * MAX_LOAD_DEN <= cap * MAX_LOAD_NUM)
         return 1;
+
+    /* a resize still running when the next one is due is finished first */
+    if (table->old_slots)
+        move_slots(table, SIZE_MAX);
+
+    size_t new_cap = cap ? cap * 2 : MIN_TABLE_SLOTS;
+    if (new_cap > (size_t)UINT32_MAX + 1)
+        return 0;
+
+    struct table_slot *slots = (struct table_slot *)alloc_zeroed_block(sizeof(struct table_slot) * new_cap);
+    if (!slots) {
+        perror("calloc");
+        return 0;
+    }
+
+    table->old_slots = table->slots;
+    table->old_mask = table->mask;
+    table->moved = 0;
+
+    table->slots = slots;
+    table->mask = (uint32_t)(new_cap - 1);
+
+    if (!table->old_slots)
+        return 1;
+
+    move_slots(table, RESIZE_STEP);
+    return 1;
+}
+
+/**
+ * @brief finds the node of a path component, adding it if asked to
+ *  
+ * @param table table holding the node
+ * @param parent id of the parent of the component, NO_NODE for the first one
+ * @param name name of the component, not null terminated
+ * @param len length of name
+ * @param create flag indicating if a missing node is added
+ * @return node found or added, NULL if missing or failed
+ */
+static struct _file *find_node(struct file_table *table, uint32_t parent, const char *name, size_t len, int create) {
+    if (table->nodes == 0 && !create)
+        return NULL;
+
+    uint32_t hash = hash_name(parent, name, len);
+
+    struct _file *node = NULL;
+    if (table->slots)
+        node = index_find(table, table->slots, table->mask, hash, parent, name, len);
+    if (!node && table->old_slots)
+        node = index_find(table, table->old_slots, table->old_mask, hash, parent, name, len);
+    if (node || !create)
+        return node;
+
+    if (!reserve_slot(table))
+        return NULL;
+
+    uint32_t id;
+    node = (struct _file *)arena_alloc(table, sizeof(struct _file) + NAME_OFFSET + len + 1, _Alignof(struct _file), &id);
+    if (!node)
+        return NULL;
+
+    char *record = (char *)(node + 1);
+    uint16_t name_len = (uint16_t)len;
+    memcpy(record, &name_len, sizeof(name_len));
+    memcpy(record + NAME_PARENT, &parent, sizeof(parent));
+    memcpy(record + NAME_OFFSET, name, len);
+    record[NAME_OFFSET + len] = '\0';
+
+    node->id = id;
+    node->child = NO_NODE;
+    node->flags = 0;
+    node->opening = 0;
+    node->modifying = 0;
+    node->activity = NO_NODE;
+
+    if (parent == NO_NODE) {
+        node->sibling = table->nodes ? table->first : NO_NODE;
+        table->first = id;
+    } else {
+        struct _file *p = node_at(table, parent);
+        node->sibling = p->child;
+        p->child = id;
+    }
+
+    struct table_slot slot = { hash, id };
+    index_insert(table->slots, table->mask, slot);
+    table->filled++;
+    table->nodes++;
+
+    return node;
+}
+
+/**
+ * @brief finds the node of a path, component by component
+ *  
+ * @param table table holding the nodes
+ * @param path path split on '/', not null terminated
+ * @param len length of path
+ * @param create flag indicating if missing nodes are added
+ * @return node of the last component, NULL if missing or failed
+ */
+static struct _file *find_path(struct file_table *table, const char *path, size_t len, int create) {
+    uint32_t parent = NO_NODE;
+    struct _file *node = NULL;
+
+    size_t start = 0;
+    for (;;) {
+        const char *slash = (const char *)memchr(path + start, '/', len - start);
+        size_t end = slash ? (size_t)(slash - path) : len;
+
+        node = find_node(table, parent, path + start, end - start, create);
+        if (!node || end == len)
+            return node;
+
+        parent = node->id;
+        start = end + 1;
+    }
+}
+
+/**
+ * @brief finds the node of the file of a path
+ *  
+ * the directory of the last file found is cached,
+ * files of the same directory are found with a single lookup
+ *  
+ * @param table table holding the nodes
+ * @param filename full path of the file
+ * @param create flag indicating if missing nodes are added
+ * @return node of the file, NULL if missing or failed
+ */
+static struct _file *find_item(struct file_table *table, const char *filename, int create) {
+    size_t len = strnlen(filename, MAX_KEY_LENGTH);
+
+    size_t dir_len = len;
+    while (dir_len > 0 && filename[dir_len - 1] != '/')
+        dir_len--;
+
+    uint32_t parent = NO_NODE;
+    if (dir_len > 0) {
+        if (table->last_len == dir_len && memcmp(table->last_path, filename, dir_len) == 0) {
+            parent = table->last_dir;
+        } else {
+            /* the directory is looked up without its trailing slash */
+            struct _file *dir = find_path(table, filename, dir_len - 1, create);
+            if (!dir)
+                return NULL;
+
+            parent = dir->id;
+            table->last_dir = parent;
+            table->last_len = dir_len;
+            memcpy(table->last_path, filename, dir_len);
+        }
     }
 
-    item->opening += op_count;
-    item->modifying += mod_count;
+    return find_node(table, parent, filename + dir_len, len - dir_len, create);
+}
+
+int additem(struct file_table *table, const char *filename, const uint32_t op_count, const uint32_t mod_count) {
+    if (!filename || *filename == '\0') {
+        return -1;
+    }
+
+    struct _file *item = find_item(table, filename, 1);
+    if (!item)
+        return -1;
+
+    if (item->flags & FILE_TRACKED) {
+        item->opening += op_count;
+        item->modifying += mod_count;
+        return 0;
+    }
+
+    item->flags |= FILE_TRACKED;
+    item->opening = op_count;
+    item->modifying = mod_count;
+    table->count++;
+
+    return 1;
+}
+
+struct activity *addactivity(struct file_table *table, const char *filename) {
+    if (!filename || *filename == '\0')
+        return NULL;
+
+    struct _file *item = find_item(table, filename, 0);
+    if (!item || !(item->flags & FILE_TRACKED))
+        return NULL;
+
+    if (item->activity != NO_NODE)
+        return (struct activity *)arena_at(table, item->activity);
+
+    uint32_t id;
+    struct activity *activity = (struct activity *)arena_alloc(table, sizeof(struct activity), _Alignof(struct activity), &id);
+    if (!activity)
+        return NULL;
+
+    memset(activity, 0, sizeof(*activity));
+    item->activity = id;
+
+    return activity;
+}
+
+const struct activity *getactivity(const struct file_table *table, const struct _file *item) {
+    if (item->activity == NO_NODE)
+        return NULL;
+
+    return (const struct activity *)arena_at(table, item->activity);
+}
+
+void delitem(struct file_table *table, struct _file *item) {
+    if (!(item->flags & FILE_TRACKED))
+        return;
+
+    item->flags &= ~FILE_TRACKED;
+    item->opening = 0;
+    item->modifying = 0;
+    item->activity = NO_NODE;
+    table->count--;
+}
 
-    return 0;
+/* appends the name of a node to the path of its parent */
+static size_t push_name(char *path, size_t len, const struct _file *node) {
+    size_t name_len = node_name_len(node);
+
+    path[len++] = '/';
+    memcpy(path + len, node_name(node), name_len);
+
+    return len + name_len;
 }
 
-void clear_table(struct _file **table) {
-    struct _file *item, *tmp;
+/**
+ * @brief visits the tracked nodes of a subtree in depth-first order
+ *  
+ * the path of the current node is kept in path, names are appended
+ * when going down and cut when going back up, so no path is rebuilt from the root
+ *  
+ * @param table table holding the nodes
+ * @param root node the walk starts from
+ * @param path buffer holding the path of root, at least MAX_KEY_LENGTH + 1 bytes long
+ * @param len length of the path of root
+ * @param handler function called on each tracked node
+ * @param arg argument given to handler
+ * @return amount of nodes visited
+ */
+static size_t walk_node(struct file_table *table, struct _file *root, char *path, size_t len, table_handler handler, void *arg) {
+    size_t visited = 0;
+    struct _file *node = root;
+
+    for (;;) {
+        if (node->flags & FILE_TRACKED) {
+            path[len] = '\0';
+            handler(table, node, path, len, arg);
+            visited++;
+        }
+
+        if (node->child != NO_NODE) {
+            node = node_at(table, node->child);
+            len = push_name(path, len, node);
+            continue;
+        }
+
+        /* climbs until a node with a sibling left to visit is found */
+        for (;;) {
+            if (node == root)
+                return visited;
 
-    HASH_ITER(hh, *table, item, tmp) {
-        HASH_DEL(*table, item);
-        free(item);
+            len -= node_name_len(node) + 1;
+
+            if (node->sibling != NO_NODE) {
+                node = node_at(table, node->sibling);
+                len = push_name(path, len, node);
+                break;
+            }
+
+            node = node_at(table, node_parent(node));
+        }
     }
-    *table = NULL;
+}
+
+size_t walktable(struct file_table *table, const char *dir, table_handler handler, void *arg) {
+    if (table->nodes == 0)
+        return 0;
+
+    char path[MAX_KEY_LENGTH + 1];
+
+    if (dir) {
+        size_t len = strnlen(dir, MAX_KEY_LENGTH);
+        while (len > 0 && dir[len - 1] == '/')
+            len--;
+
+        struct _file *node = find_path(table, dir, len, 0);
+        if (!node)
+            return 0;
+
+        memcpy(path, dir, len);
+        return walk_node(table, node, path, len, handler, arg);
+    }
+
+    size_t visited = 0;
+    for (uint32_t id = table->first; id != NO_NODE;) {
+        struct _file *node = node_at(table, id);
+        size_t len = node_name_len(node);
+
+        memcpy(path, node_name(node), len);
+        visited += walk_node(table, node, path, len, handler, arg);
+
+        id = node->sibling;
+    }
+
+    return visited;
+}
+
+/* untracks each file visited, counting them in arg */
+static void delete_handler(struct file_table *table, struct _file *item, const char *path, size_t len, void *arg) {
+    (void)path;
+    (void)len;
+
+    delitem(table, item);
+    (*(size_t *)arg)++;
+}
+
+size_t delpath(struct file_table *table, const char *path) {
+    size_t count = 0;
+    walktable(table, path, delete_handler, &count);
+    return count;
+}
+
+/* re-adds each file visited under the new directory, the nodes added are never under the one being walked */
+static void move_handler(struct file_table *table, struct _file *item, const char *path, size_t len, void *arg) {
+    struct move_state *state = (struct move_state *)arg;
+
+    char moved[MAX_KEY_LENGTH + 1];
+    size_t suffix = len - state->from_len;
+    if (state->to_len + suffix > MAX_KEY_LENGTH)
+        return;
+
+    memcpy(moved, state->to, state->to_len);
+    memcpy(moved + state->to_len, path + state->from_len, suffix);
+    moved[state->to_len + suffix] = '\0';
+
+    if (additem(table, moved, item->opening, item->modifying) == -1)
+        return;
+
+    const struct activity *activity = getactivity(table, item);
+    if (activity) {
+        struct activity *dst = addactivity(table, moved);
+        if (dst)
+            activity_merge(dst, activity);
+    }
+
+    delitem(table, item);
+    state->moved++;
+}
+
+size_t movepath(struct file_table *table, const char *from, const char *to) {
+    struct move_state state = {
+        .to = to,
+        .to_len = strnlen(to, MAX_KEY_LENGTH),
+        .from_len = strnlen(from, MAX_KEY_LENGTH),
+    };
+
+    /* walktable() cuts the trailing slashes of the directory too */
+    while (state.from_len > 0 && from[state.from_len - 1] == '/')
+        state.from_len--;
+    while (state.to_len > 0 && to[state.to_len - 1] == '/')
+        state.to_len--;
+
+    /* a path cannot be moved below itself, the walk would visit the files it adds */
+    if (state.to_len >= state.from_len && memcmp(to, from, state.from_len) == 0 &&
+        (state.to_len == state.from_len || to[state.from_len] == '/'))
+        return 0;
+
+    walktable(table, from, move_handler, &state);
+    return state.moved;
+}
+
+int addrecord(struct file_table *table, uint64_t seq, const char *from, const char *to) {
+    struct _file *from_node = find_path(table, from, strnlen(from, MAX_KEY_LENGTH), 1);
+    if (!from_node)
+        return 0;
+
+    uint32_t to_id = NO_NODE;
+    if (to) {
+        struct _file *to_node = find_path(table, to, strnlen(to, MAX_KEY_LENGTH), 1);
+        if (!to_node)
+            return 0;
+
+        to_id = to_node->id;
+    }
+
+    uint32_t id;
+    struct table_record *record = (struct table_record *)arena_alloc(table, sizeof(struct table_record), _Alignof(struct table_record), &id);
+    if (!record)
+        return 0;
+
+    record->seq = seq;
+    record->from = from_node->id;
+    record->to = to_id;
+    record->next = NO_NODE;
+
+    if (table->record_count)
+        ((struct table_record *)arena_at(table, table->last_record))->next = id;
+    else
+        table->records = id;
+
+    table->last_record = id;
+    table->record_count++;
+
+    return 1;
+}
+
+/* writes the full path of a node into path, which holds at least MAX_KEY_LENGTH + 1 bytes */
+static size_t node_path(const struct file_table *table, const struct _file *node, char *path) {
+    size_t len = node_name_len(node);
+    for (const struct _file *n = node; node_parent(n) != NO_NODE;) {
+        n = node_at(table, node_parent(n));
+        len += node_name_len(n) + 1;
+    }
+
+    path[len] = '\0';
+
+    size_t end = len;
+    for (const struct _file *n = node;; n = node_at(table, node_parent(n))) {
+        size_t name_len = node_name_len(n);
+        end -= name_len;
+        memcpy(path + end, node_name(n), name_len);
+
+        if (node_parent(n) == NO_NODE)
+            break;
+
+        path[--end] = '/';
+    }
+
+    return len;
+}
+
+size_t walkrecords(struct file_table *table, record_handler handler, void *arg) {
+    char from[MAX_KEY_LENGTH + 1];
+    char to[MAX_KEY_LENGTH + 1];
+
+    size_t visited = 0;
+    for (uint32_t id = table->records; visited < table->record_count; visited++) {
+        const struct table_record *record = (const struct table_record *)arena_at(table, id);
+
+        node_path(table, node_at(table, record->from), from);
+        if (record->to != NO_NODE)
+            node_path(table, node_at(table, record->to), to);
+
+        handler(record->seq, from, (record->to != NO_NODE) ? to : NULL, arg);
+        id = record->next;
+    }
+
+    return visited;
+}
+
+void clear_table(struct file_table *table) {
+    if (table->slots)
+        free_block(table->slots, sizeof(struct table_slot) * ((size_t)table->mask + 1));
+
+    if (table->old_slots)
+        free_block(table->old_slots, sizeof(struct table_slot) * ((size_t)table->old_mask + 1));
+
+    for (uint32_t i = 0; i < table->chunk_count; i++) {
+        free_chunk(table->chunks[i]);
+    }
+
+    if (table->chunks)
+        free_block(table->chunks, sizeof(char *) * table->chunk_cap);
+
+    memset(table, 0, sizeof(*table));
 }
@@ -21,7 +21,7 @@ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,7 +30,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <signal.h>
 #include <sys/stat.h>
 #include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include "activity.h"
 #include "file_table.h"
+#include "run_set.h"
+#include "line_reader.h"
 #include "procutils.h"
 #include "fileutils.h"
 #include "strutils.h"
@@ -38,11 +43,32 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define FILE_LISTENER_NAME "file-listener"
 
 #define SAVE_PATH "/var/log/file-listener/file-events" /* log file path for storing in disk file events recorded by fanotify */
+#define RUNS_DIR_PATH "/var/log/file-listener/runs" /* sorted runs written by file-listener, see run_set.h */
+#define DROPS_PATH "/var/log/file-listener/file-listener.drops" /* intervals in which file-listener lost events */
+
+/* file found inside the directory searched, the counters are those of the window if one is set */
+struct found {
+    char *path;
+    uint64_t opened;
+    uint64_t modified;
+};
 
 struct match {
-    struct _file **table;
-    char *searching;
-    const char *readingpath;
+    const char *searching;
+    int op;
+    int mod;
+    uint32_t window; /* minutes counted, 0 counts every event */
+    uint32_t now; /* minute since the epoch the window ends at */
+    struct found *found;
+    size_t count;
+    size_t cap;
+    int failed;
+};
+
+struct drops {
+    uint32_t intervals;
+    unsigned long long overflows;
+    unsigned long long dropped;
 };
 
 static void printhelp(void) {
@@ -60,20 +86,201 @@ static void emit_signal(void) {
     kill(listener_pid, SIGUSR1);
 }
 
-static void handle_match(char *line, void *arg) {
-    /* ... */
+static void handle_drop(struct line_view line, void *arg) {
+    struct drops *d = (struct drops *)arg;
+
+    /* start:end:overflows:dropped, the interval itself is not reported */
+    struct line_view end, overflows_field, dropped_field;
+    uint64_t overflows, dropped;
+    if (!line_view_cut(&line, ':', &dropped_field) ||
+        !line_view_cut(&line, ':', &overflows_field) ||
+        !line_view_cut(&line, ':', &end) ||
+        !line_view_u64(overflows_field, &overflows) ||
+        !line_view_u64(dropped_field, &dropped))
+        return;
+
+    d->intervals++;
+    d->overflows += overflows;
+    d->dropped += dropped;
+}
+
+/* results are incomplete when the listener lost events, the kernel queue overflowed or paths couldnt be resolved */
+static void warn_drops(void) {
+    struct drops d = { 0 };
+    if (!line_reader_scan(DROPS_PATH, handle_drop, &d) || d.intervals == 0)
+        return;
+
+    fprintf(stderr, "Warning: '%s' lost events in %u intervals (%llu queue overflows, %llu events dropped), results may be incomplete.\n",
+            FILE_LISTENER_NAME, d.intervals, d.overflows, d.dropped);
+}
+
+static void handle_match(struct file_table *table, struct _file *item, const char *path, size_t len, void *arg) {
+    struct match *mt = (struct match *)arg;
+
+    /* the directory itself is not one of its files */
+    if (mt->failed || len == strlen(mt->searching))
+        return;
+
+    uint64_t opened = item->opening, modified = item->modifying;
+    if (mt->window) {
+        activity_window(getactivity(table, item), mt->now, mt->window, &opened, &modified);
+
+        /* files untouched during the window are not reported */
+        if (opened == 0 && modified == 0)
+            return;
+    }
+
+    if (mt->count == mt->cap) {
+        size_t new_cap = mt->cap ? mt->cap * 2 : 64;
+        struct found *tmp = (struct found *)realloc(mt->found, sizeof(struct found) * new_cap);
+        if (!tmp) {
+            perror("realloc");
+            mt->failed = 1;
+            return;
+        }
+
+        mt->found = tmp;
+        mt->cap = new_cap;
+    }
+
+    mt->found[mt->count].path = strdup(path);
+    if (!mt->found[mt->count].path) {
+        mt->failed = 1;
+        return;
+    }
+
+    mt->found[mt->count].opened = opened;
+    mt->found[mt->count].modified = modified;
+    mt->count++;
+}
+
+/* value the matches are ordered by, only the counters requested are added up */
+static uint64_t match_key(const struct match *mt, const struct found *f) {
+    return (mt->op ? f->opened : 0) + (mt->mod ? f->modified : 0);
+}
+
+static const struct match *sorting;
+
+static int compare_found(const void *a, const void *b) {
+    uint64_t key_a = match_key(sorting, (const struct found *)a);
+    uint64_t key_b = match_key(sorting, (const struct found *)b);
+
+    if (key_a != key_b)
+        return (key_a < key_b) - (key_a > key_b);
+
+    return strcmp(((const struct found *)a)->path, ((const struct found *)b)->path);
+}
+
+/* only the blocks of each run holding paths under the directory are read */
+static int search_matches(struct match *mt, size_t *runs) {
+    int root = strcmp(mt->searching, "/") == 0;
+
+    struct file_table table = { 0 };
+    if (!run_set_query(RUNS_DIR_PATH, root ? "" : mt->searching, &table, runs)) {
+        clear_table(&table);
+        return 0;
+    }
+
+    walktable(&table, root ? NULL : mt->searching, handle_match, mt);
+    clear_table(&table);
+
+    if (mt->failed)
+        return 0;
+
+    /* without a condition every key is 0, the matches end up in path order */
+    sorting = mt;
+    qsort(mt->found, mt->count, sizeof(struct found), compare_found);
+
+    return 1;
 }
 
-static int search_matches(struct match *mt, const char *path) {
-    mt->readingpath = path;
-    return readfile(path, handle_match, mt);
+static void free_matches(struct match *mt) {
+    for (size_t i = 0; i < mt->count; i++)
+        free(mt->found[i].path);
+    free(mt->found);
+}
+
+/* length with an optional unit: s, m, h or d, minutes by default; seconds are rounded up to whole minutes */
+static int parse_window(const char *arg, uint32_t *minutes) {
+    char *endptr;
+    errno = 0;
+    unsigned long long value = strtoull(arg, &endptr, 10);
+    if (endptr == arg || errno == ERANGE || arg[0] == '-')
+        return 0;
+
+    unsigned long long scale;
+    switch (*endptr) {
+        case 's': scale = 0; break;
+        case '\0':
+        case 'm': scale = 1; break;
+        case 'h': scale = 60; break;
+        case 'd': scale = 1440; break;
+        default: return 0;
+    }
+
+    if (*endptr && endptr[1] != '\0')
+        return 0;
+
+    /* anything past the last ring is cut later, only the overflow matters here */
+    if (scale == 0) {
+        value = value / 60 + (value % 60 != 0);
+    } else if (value > UINT32_MAX / scale) {
+        value = UINT32_MAX;
+    } else {
+        value *= scale;
+    }
+
+    *minutes = value > UINT32_MAX ? UINT32_MAX : (uint32_t)value;
+    return 1;
+}
+
+/* seconds since the epoch, or a local date as YYYY-MM-DD with an optional HH:MM */
+static int parse_since(const char *arg, time_t *since) {
+    char *endptr;
+    errno = 0;
+    long long value = strtoll(arg, &endptr, 10);
+    if (endptr != arg && *endptr == '\0' && errno == 0) {
+        *since = (time_t)value;
+        return 1;
+    }
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+
+    const char *end = strptime(arg, "%Y-%m-%d %H:%M", &tm);
+    if (!end || *end) {
+        memset(&tm, 0, sizeof(tm));
+        end = strptime(arg, "%Y-%m-%d", &tm);
+    }
+
+    if (!end || *end)
+        return 0;
+
+    tm.tm_isdst = -1;
+    *since = mktime(&tm);
+
+    return *since != (time_t)-1;
+}
+
+static void print_metadata(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == -1) {
+        printf("    (no longer exists)\n");
+        return;
+    }
+
+    char mtime[32];
+    strftime(mtime, sizeof(mtime), "%Y-%m-%d %H:%M:%S", localtime(&st.st_mtime));
+
+    printf("    size: %lld bytes, mode: %o, owner: %u:%u, last modification: %s\n",
+           (long long)st.st_size, (unsigned)(st.st_mode & 07777), (unsigned)st.st_uid, (unsigned)st.st_gid, mtime);
 }
 
 int main(int argc, char *argv[]) {
     int opt;
 
     /* if neither of op or mod are active, returns all the matches found without filtering */
-    int op, mod = 0;
+    int op = 0, mod = 0;
 
     int metadata = 0;
     int verbose = 0;
@@ -82,17 +289,24 @@ int main(int argc, char *argv[]) {
 
     uint32_t n = 0;
 
+    /* minutes counted back from now, 0 counts every event recorded */
+    uint32_t window = 0;
+    int since_set = 0;
+    time_t since = 0;
+
     struct option long_ops[] = {
         {"opened", no_argument, NULL, 'o'},
         {"modified", no_argument, NULL, 'm'},
         {"range", required_argument, NULL, 'n'},
+        {"window", required_argument, NULL, 'w'},
+        {"since", required_argument, NULL, 's'},
         {"verbose", no_argument, NULL, 'v'},
         {"show-metadata", no_argument, NULL, 'a'},
         {"help", no_argument, NULL, 'h'},
         {0, 0, 0, 0}
     };
     
-    while ((opt = getopt_long(argc, argv, "movan:h", long_ops, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "movan:w:s:h", long_ops, NULL)) != -1) {
         switch (opt) {
             case 'm': mod = 1; break;
             case 'o': op = 1; break;
@@ -112,6 +326,21 @@ int main(int argc, char *argv[]) {
 
                 n = (uint32_t)tmp;
 
+                break;
+            case 'w':
+                if (!parse_window(optarg, &window) || window == 0) {
+                    fprintf(stderr, "Error: Length like '90', '45s', '2h' or '3d' expected when using flag '--window'.\n");
+                    return 2;
+                }
+
+                break;
+            case 's':
+                if (!parse_since(optarg, &since)) {
+                    fprintf(stderr, "Error: Timestamp or date like '2024-05-01 13:30' expected when using flag '--since'.\n");
+                    return 2;
+                }
+
+                since_set = 1;
                 break;
             case 'v': verbose = 1; break;
             case 'a': metadata = 1; break;
@@ -132,29 +361,78 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "Directory path expected.\n");
         return EXIT_FAILURE;
     }
+
+    if (window && since_set) {
+        fprintf(stderr, "Error: Flags '--window' and '--since' cant be used together.\n");
+        return 2;
+    }
+
+    time_t now = time(NULL);
+    if (since_set) {
+        if (since > now) {
+            fprintf(stderr, "Error: Date passed to '--since' is in the future.\n");
+            return 2;
+        }
+
+        /* the minute holding since is counted whole */
+        uint64_t seconds = (uint64_t)(now - since);
+        uint64_t minutes = seconds / 60 + 1;
+        window = minutes > UINT32_MAX ? UINT32_MAX : (uint32_t)minutes;
+    }
+
+    if (window > ACTIVITY_MAX_WINDOW) {
+        fprintf(stderr, "Warning: Only the last %u days are kept by time, the window was cut to them.\n", ACTIVITY_MAX_WINDOW / 1440U);
+        window = ACTIVITY_MAX_WINDOW;
+    }
     
     emit_signal();
+    warn_drops();
 
-    char *dirpath = argv[optind];
-
-    struct _file *table;
+    char dirpath[PATH_MAX];
+    if (!realpath(argv[optind], dirpath)) {
+        fprintf(stderr, "Error: Couldnt resolve '%s'. -> %s\n", argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
 
     struct match mt = {
-        .table = &table,
         .searching = dirpath,
+        .op = op,
+        .mod = mod,
+        .window = window,
+        .now = (uint32_t)(now / 60)
     };
 
-/**
- * search matches ->
- * 4 possible conditions (max of 3):
- * - most/least modified   
- * - most/least opened
- * 
- * first save entries that matches <dirpath> variable
- * then filter them with the conditions (based on the flags)
- * right before printing the general information, checks if the flag -a is active
- * if the flag -a is active, prints all metadata of the file
- */
+    size_t runs = 0;
+    errno = 0;
+    if (!search_matches(&mt, &runs)) {
+        fprintf(stderr, "Error: Couldnt search '%s' in '%s'. -> %s\n", dirpath, RUNS_DIR_PATH, errno ? strerror(errno) : "damaged run");
+        fprintf(stderr, "If the error persist, try checking if '%s' is running.\n", FILE_LISTENER_NAME);
+        free_matches(&mt);
+        return EXIT_FAILURE;
+    }
+
+    if (verbose)
+        printf("Searched '%s' in %zu runs.\n", dirpath, runs);
+
+    if (verbose && window)
+        printf("Counted the events of the last %u minutes.\n", window);
+
+    /* without a condition the matches are printed in path order */
+    size_t limit = n ? n : 1;
+    if (limit > mt.count)
+        limit = mt.count;
+
+    if (verbose)
+        printf("%zu matches found, printing %zu.\n", mt.count, limit);
+
+    for (size_t i = 0; i < limit; i++) {
+        printf("%s opened: %llu modified: %llu\n", mt.found[i].path,
+               (unsigned long long)mt.found[i].opened, (unsigned long long)mt.found[i].modified);
+        if (metadata)
+            print_metadata(mt.found[i].path);
+    }
+
+    free_matches(&mt);
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/line_reader.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#define _GNU_SOURCE
+#include <fcntl.h> /* open, O_RDONLY, O_CLOEXEC */
+#include <stdint.h> /* UINT64_MAX */
+#include <string.h> /* memchr, memrchr */
+#include <sys/mman.h> /* mmap, munmap, madvise, MAP_FAILED, MADV_SEQUENTIAL */
+#include <sys/stat.h> /* fstat */
+#include <unistd.h> /* close */
+#include "line_reader.h"
+
+int line_reader_scan(const char *path, void (*line_handler)(struct line_view line, void *arg), void *arg) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return 0;
+    }
+
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        close(fd);
+        return 1;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return 0;
+
+    /* lines are read once from the start to the end */
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const char *p = (const char *)map;
+    const char *end = p + size;
+    while (p < end) {
+        const char *eol = (const char *)memchr(p, '\n', (size_t)(end - p));
+        if (!eol)
+            eol = end;
+
+        struct line_view line = { .data = p, .len = (size_t)(eol - p) };
+        if (line.len && line.data[line.len - 1] == '\r')
+            line.len--;
+
+        if (line.len)
+            line_handler(line, arg);
+
+        p = eol + 1;
+    }
+
+    munmap(map, size);
+    return 1;
+}
+
+int line_view_cut(struct line_view *line, char delim, struct line_view *field) {
+    const char *sep = (const char *)memrchr(line->data, delim, line->len);
+    if (!sep)
+        return 0;
+
+    field->data = sep + 1;
+    field->len = line->len - (size_t)(field->data - line->data);
+    line->len = (size_t)(sep - line->data);
+
+    return 1;
+}
+
+int line_view_u64(struct line_view field, uint64_t *out) {
+    if (field.len == 0)
+        return 0;
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < field.len; i++) {
+        unsigned int digit = (unsigned int)(field.data[i] - '0');
+        if (digit > 9)
+            return 0;
+
+        value = (value > (UINT64_MAX - digit) / 10) ? UINT64_MAX : value * 10 + digit;
+    }
+
+    *out = value;
+    return 1;
+}
@@ -0,0 +1,61 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/listener/burst_filter.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h> /* memset */
+#include "burst_filter.h"
+
+void burst_filter_init(struct burst_filter *filter, uint64_t window_ns) {
+    memset(filter, 0, sizeof(*filter));
+    filter->window_ns = window_ns;
+}
+
+int burst_filter_check(struct burst_filter *filter, uint64_t key, uint64_t now) {
+    if (!filter->window_ns)
+        return 0;
+
+    stat_add(&filter->raw, 1);
+
+    struct burst_slot *slot = &filter->slots[key & (BURST_SLOTS - 1)];
+
+    /* a zero since marks a slot that never opened a window */
+    if (slot->since && slot->key == key && now - slot->since < filter->window_ns) {
+        stat_add(&filter->coalesced, 1);
+        return 1;
+    }
+
+    slot->key = key;
+    slot->since = now;
+
+    return 0;
+}
+
+uint64_t burst_key(uint64_t hash, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
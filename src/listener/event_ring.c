@@ -0,0 +1,146 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/listener/event_ring.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h> /* perror */
+#include <stdlib.h> /* aligned_alloc, free */
+#include <string.h> /* memset */
+#include "event_ring.h"
+
+/* records are 8 byte aligned, so a padding record always has room for its size */
+#define RECORD_ALIGN 8
+
+static size_t record_size(size_t info_len) {
+    size_t size = sizeof(struct event_record) + info_len;
+    return (size + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+}
+
+int event_ring_init(struct event_ring *ring, size_t size) {
+    memset(ring, 0, sizeof(*ring));
+
+    size_t real_size = 4096;
+    while (real_size < size)
+        real_size <<= 1;
+
+    /* a zero size marks a record that is not committed yet */
+    ring->data = (unsigned char *)aligned_alloc(64, real_size);
+    if (!ring->data) {
+        perror("aligned_alloc");
+        return 0;
+    }
+    memset(ring->data, 0, real_size);
+
+    ring->size = real_size;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->full, 0);
+    atomic_init(&ring->high_water, 0);
+
+    return 1;
+}
+
+void event_ring_free(struct event_ring *ring) {
+    free(ring->data);
+    ring->data = NULL;
+    ring->size = 0;
+}
+
+struct event_record *event_ring_reserve(struct event_ring *ring, size_t info_len) {
+    size_t needed = record_size(info_len);
+    if (needed > ring->size / 2) {
+        return NULL;
+    }
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t offset, pad;
+
+    for (;;) {
+        offset = head & (ring->size - 1);
+
+        /* a record never wraps around, the end of the ring is padded instead */
+        pad = (ring->size - offset < needed) ? ring->size - offset : 0;
+
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head + pad + needed - tail > ring->size) {
+            atomic_fetch_add_explicit(&ring->full, 1, memory_order_relaxed);
+            return NULL;
+        }
+
+        if (atomic_compare_exchange_weak_explicit(&ring->head, &head, head + pad + needed,
+                                                    memory_order_relaxed, memory_order_relaxed)) {
+            uint64_t used = head + pad + needed - tail;
+            uint64_t high = atomic_load_explicit(&ring->high_water, memory_order_relaxed);
+            while (used > high && !atomic_compare_exchange_weak_explicit(&ring->high_water, &high, used,
+                                                    memory_order_relaxed, memory_order_relaxed));
+            break;
+        }
+    }
+
+    if (pad) {
+        struct event_record *pad_record = (struct event_record *)(ring->data + offset);
+        atomic_store_explicit(&pad_record->size, (uint32_t)pad | EVENT_RING_PAD, memory_order_release);
+        offset = 0;
+    }
+
+    struct event_record *record = (struct event_record *)(ring->data + offset);
+    record->info_len = (uint32_t)info_len;
+
+    return record;
+}
+
+void event_ring_commit(struct event_ring *ring, struct event_record *record) {
+    (void)ring;
+    atomic_store_explicit(&record->size, (uint32_t)record_size(record->info_len), memory_order_release);
+}
+
+struct event_record *event_ring_peek(struct event_ring *ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    for (;;) {
+        struct event_record *record = (struct event_record *)(ring->data + (tail & (ring->size - 1)));
+
+        uint32_t size = atomic_load_explicit(&record->size, memory_order_acquire);
+        if (size == 0)
+            return NULL;
+
+        if (!(size & EVENT_RING_PAD))
+            return record;
+
+        size &= ~EVENT_RING_PAD;
+        memset(record, 0, size);
+
+        tail += size;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+}
+
+void event_ring_pop(struct event_ring *ring, struct event_record *record) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t size = atomic_load_explicit(&record->size, memory_order_relaxed);
+
+    memset(record, 0, size);
+    atomic_store_explicit(&ring->tail, tail + size, memory_order_release);
+}
+
+int event_ring_empty(struct event_ring *ring) {
+    return event_ring_peek(ring) == NULL;
+}
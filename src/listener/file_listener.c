@@ -22,652 +22,3442 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #define _GNU_SOURCE
-#include <stdio.h> /* perror, snprintf, ssize_t, remove */
-#include <stdlib.h> /* malloc, free, strtol, EXIT_SUCCESS, EXIT_FAILURE */
-#include <unistd.h> /* readlink */
+#include <stdio.h> /* perror, snprintf, ssize_t, remove, rename, fopen, fgets, fclose, FILE */
+#include <stdlib.h> /* malloc, free, strtol, strtoull, qsort, EXIT_SUCCESS, EXIT_FAILURE */
+#include <unistd.h> /* readlink, fsync, close */
 #include <sys/fanotify.h> /* fanotify_init, fanotify_mark, fanotify_event_metadata, all the macros starting with FAN */
 #include <sys/stat.h> /* mkdir, stat */
+#include <sys/sysmacros.h> /* makedev */
 #include <syslog.h> /* syslog, openlog, closelog, all the macros starting with LOG */
-#include <time.h> /* time */
-#include <fcntl.h> /* creat, O_RDONLY, O_LARGEFILE AT_FDCWD */
-#include <string.h> /* strerror, strcmp, strncmp, strncpy */
+#include <time.h> /* time, clock_gettime, nanosleep, timespec, CLOCK_MONOTONIC */
+#include <fcntl.h> /* creat, open, open_by_handle_at, file_handle, O_RDONLY, O_PATH, O_LARGEFILE AT_FDCWD */
+#include <string.h> /* strerror, strcmp, strncmp, strncpy, strtok_r */
 #include <signal.h> /* sigaction, sigemptyset, sa_handler, SIGTERM, SIGKILL, SIGUSER1, SIGUSER2 */
 #include <errno.h> /* errno */
-#include <stdint.h> /* uint32_t, uint16_t, UINT32_MAX */
-#include <poll.h> /* poll, pollfd, POLLIN */
-#include "uthash.h" /* HASH_DEL, HASH_ITER */
-#include "file_table.h" /* _file, additem, clean_table */
-#include "strutils.h" /* splitstr */
-#include "fileutils.h" /* readfile, savefile, PATH_LENGTH */
+#include <stdint.h> /* uint64_t, uint32_t, uint16_t, UINT32_MAX */
+#include <poll.h> /* poll, pollfd, POLLIN, POLLPRI, POLLERR */
+#include <getopt.h> /* getopt_long, no_argument, option */
+#include <pthread.h> /* pthread_create, pthread_join, pthread_rwlock_t, pthread_mutex_t, pthread_cond_t, pthread_sigmask */
+#include <sched.h> /* sched_yield */
+#include <stdatomic.h> /* atomic_int, atomic_uint, atomic_load, atomic_store, atomic_thread_fence */
+#include <sys/eventfd.h> /* eventfd, eventfd_read, eventfd_write */
+#include "activity.h" /* activity, activity_add */
+#include "file_table.h" /* _file, file_table, additem, delitem, addactivity, getactivity, walktable, delpath, movepath, addrecord, walkrecords, clear_table */
+#include "fileutils.h" /* readfile, appendline, PATH_LENGTH */
+#include "path_cache.h" /* path_cache, path_cache_find, path_cache_add, path_cache_remove, path_cache_invalidate */
+#include "path_trie.h" /* path_trie, path_trie_insert, path_trie_match, path_trie_clear, PATH_TRIE_EXACT, PATH_TRIE_PREFIX */
+#include "path_rules.h" /* path_rules, path_rule_kind, path_rules_add, path_rules_compile, path_rules_match, path_rules_clear */
+#include "event_ring.h" /* event_ring, event_record, event_ring_reserve, event_ring_commit, event_ring_peek, event_ring_pop */
+#include "burst_filter.h" /* burst_filter, burst_filter_init, burst_filter_check, burst_key, BURST_KEY_SEED */
+#include "stat_counter.h" /* stat_counter, stat_add, stat_get */
+#include "wal.h" /* wal, wal_entry, wal_sync, wal_open, wal_time, wal_count, wal_delete, wal_move, wal_commit, wal_rotate, wal_close, wal_range, wal_replay, wal_remove */
+#include "io_ring.h" /* io_ring, io_ring_init, io_ring_free, io_ring_prepare, io_ring_submit, io_ring_reap, io_ring_ready */
+#include "snapshot.h" /* snapshot_builder, snapshot_add, snapshot_add_op, snapshot_publish, snapshot_clear */
+#include "run_set.h" /* manifest, run_info, compaction_stats, run_path, manifest_load, manifest_save, manifest_clean, compaction_pick, run_merge, run_set_query */
+#include "line_writer.h" /* line_writer, line_writer_open, line_writer_reserve, line_writer_commit, line_writer_close, LINE_WRITER_SIZE */
+#include "line_reader.h" /* line_view, line_reader_scan, line_view_cut, line_view_u64 */
 
 #define SAVE_PATH "/var/log/file-listener/file-events" /* log file path for storing in disk file events recorded by fanotify */
 #define BLACKLIST_PATH "/var/log/file-listener/file-listener.blacklist" /* file path for the blacklist file */
+#define DROPS_PATH "/var/log/file-listener/file-listener.drops" /* intervals in which events were lost, read by fview */
 
-#define TMP_FILE_PATH "/tmp/file-listener/%u.tmp" /* temporary log file for storing in disk file events recorded by fanotify */
+#define SAVE_TMP_PATH SAVE_PATH ".tmp" /* export being written, renamed over SAVE_PATH once complete */
+#define SNAPSHOT_PATH SAVE_PATH ".idx" /* snapshot published by older versions, removed once SAVE_PATH is moved into the runs */
+#define WAL_DIR_PATH "/var/log/file-listener/wal" /* directory of the write-ahead log segments */
+#define RUNS_DIR_PATH "/var/log/file-listener/runs" /* directory of the sorted runs and their manifest, read by fview */
 
-#define MAX_TMP_FILES 500 /* max temporary log files that can be created */
-#define MAX_TMP_SIZE 250 /* max items a temporary file can store before opening a new temporary file */
+#define CHECKPOINT_MARK "#checkpoint:" /* first line of SAVE_PATH in older versions, followed by the last segment merged into it */
 
-#define MAX_COUNT 5 /* max temporary files procesed at once */
+#define MAX_WAL_SEGMENTS 16 /* max sealed segments kept before they are written as a run */
+#define MAX_GROUP_SIZE 250 /* max new items a worker table can store before requesting an early commit */
+
+#define DIRENT_MASK (FAN_DELETE | FAN_MOVED_FROM | FAN_ONDIR) /* deletes and renames, of files and directories */
 
 #define INTERVAL_SEC 15 /* timout for each time the process saves data */
 
 #define INT_BUFF_SIZE 11 /* size for buffers that holds integer values to be parsed */
 
+#define PATH_CACHE_SIZE 16384 /* default max directories the path cache can hold */
+
+#define RING_SIZE (1U << 20) /* bytes of the ring between the readers and each worker */
+#define MAX_WORKERS 64 /* max worker threads that can be started */
+#define WORKER_BATCH 256 /* max events a worker handles before releasing the blacklist lock */
+
+#define MODIFY_WINDOW_MS 0 /* default window repeated FAN_MODIFY events are collapsed in, every write is counted unless set */
+#define MAX_MODIFY_WINDOW_MS 60000 /* max window that can be set with --modify-window */
+
+#define MAX_GROUPS 64 /* max fanotify groups, one per watched filesystem */
+
+#define READ_MIN_SIZE 4096U /* size of the read buffer of an idle reader */
+#define READ_MAX_SIZE (256U * 1024U) /* size the read buffer of a reader can grow up to while its queue is hot */
+#define READ_SHRINK_AFTER 32 /* consecutive small reads before the read buffer is halved */
+#define READ_IDLE_SEC 1 /* seconds without events after which the read buffer goes back to READ_MIN_SIZE */
+#define MAX_READ_DELAY 100000L /* max microseconds a reader can wait for a burst to build up */
+#define MOUNTINFO_PATH "/proc/self/mountinfo" /* mount table, polled for mounts and unmounts */
+
+#define IO_RING_ENTRIES 16 /* requests the ring of the write-ahead log holds, a group commit and a batch of unlinks */
+#define READER_RING_ENTRIES 4 /* requests the ring of a reader holds, two polls and a read */
+
+#define MAX_IGNORE_MARKS 8192 /* max kernel ignore marks a group installs for blacklisted directories */
+#define IGNORE_MASK (FAN_OPEN | FAN_MODIFY | FAN_CLOSE) /* events dropped in the kernel for blacklisted directories */
+
+#define EVENT_MASK (FAN_OPEN | FAN_MODIFY) /* events counted by default, one per open and one per write */
+#define SESSION_MASK FAN_CLOSE /* events counted in session mode, one per open and close of a file */
+#define COUNT_MASK (FAN_OPEN | FAN_MODIFY | FAN_CLOSE) /* events that are counted in the table */
+
+/* fanotify flags for FID reporting mode (linux 5.9+), events carry file handles instead of open fds */
+#define FAN_FID_FLAGS (FAN_REPORT_FID | FAN_REPORT_DFID_NAME)
+
+/**
+ * user_data of the requests of a reader ring, the polls are also the bits of the ones armed
+ */
+enum reader_op {
+    READER_POLL_EVENTS = 1, /** > fanotify has events to read */
+    READER_POLL_STOP = 2, /** > the reader was stopped */
+    READER_READ = 4 /** > read of the fanotify descriptor */
+};
+
+/**
+ * how fanotify reports the file of each event
+ */
+enum listener_mode {
+    MODE_FD, /** > classic mode, each event holds an open file descriptor */
+    MODE_FID /** > events carry the parent directory handle and the file name */
+};
+
+/**
+ * @brief thread that resolves, filters and aggregates events
+ *  
+ * each worker drains its own ring, filled by the reader threads
+ */
+struct worker {
+    pthread_t thread; /** > thread running worker_loop */
+    struct event_ring ring; /** > events dispatched to this worker */
+    int wake_fd; /** > eventfd used to wake the worker up while it sleeps */
+    atomic_int sleeping; /** > set while the worker waits on wake_fd */
+    struct path_cache dir_cache; /** > resolved paths of directory handles, only used in FID mode */
+    struct file_table table; /** > private table the worker aggregates into */
+    uint16_t content_count; /** > new items stored in table since it was handed off */
+    struct file_table frozen; /** > table handed off to the persistence thread, valid once flush_requested is cleared */
+    atomic_int flush_requested; /** > set by the main thread, cleared by the worker once frozen is published */
+    stat_counter handoffs; /** > tables handed off */
+    stat_counter handoff_ns; /** > time ingestion stopped to hand the tables off */
+    stat_counter handoff_peak_ns; /** > longest handoff */
+    char last_ignored[PATH_LENGTH]; /** > last directory this worker installed an ignore mark on */
+    char path[PATH_LENGTH]; /** > scratch buffer the path of the current event is resolved into */
+    struct burst_filter modify_filter; /** > collapses repeated FAN_MODIFY events before their path is resolved */
+    uint64_t now; /** > monotonic time of the current batch in nanoseconds, only kept while modify_filter is enabled */
+    stat_counter events; /** > events handled */
+    stat_counter blacklisted; /** > events that reached user space and were dropped by the blacklist */
+    stat_counter dropped; /** > events lost in user space, their path couldnt be resolved or their filesystem was unmounted */
+    unsigned int cache_epoch; /** > value of cache_epoch the path cache was last cleared at */
+};
+
+/**
+ * @brief fanotify group watching one filesystem
+ *  
+ * each group has its own reader thread draining it into the worker rings
+ */
+struct fan_group {
+    pthread_t thread; /** > thread running reader_loop */
+    uint32_t id; /** > stamped on the records of the group, never reused */
+    int fan_fd; /** > file descriptor of fanotify */
+    int mount_fd; /** > descriptor on the root mount to resolve file handles in FID mode, -1 for other mounts */
+    enum listener_mode mode; /** > reporting mode the group was initialized with */
+    int dirents; /** > set when directory deletes and renames are reported, the path cache is only used then */
+    int renames; /** > set when FAN_RENAME is reported, renamed files keep their counters then */
+    dev_t dev; /** > device of the watched filesystem */
+    char path[PATH_LENGTH]; /** > mount point the group was marked on */
+    char **ignored_mounts; /** > blacklisted mount points holding a mount ignore mark */
+    atomic_int ignore_marks; /** > kernel ignore marks currently installed */
+    atomic_int stop; /** > set by the main thread to stop this reader only */
+    int stop_fd; /** > eventfd waking the reader up when it is stopped, so it can wait without timeout */
+    uint64_t pending; /** > bit per worker that received events not yet signaled, reader only */
+    uint32_t next_worker; /** > round robin dispatch for events without file identity */
+    stat_counter events; /** > events read from fanotify */
+    stat_counter overflows; /** > FAN_Q_OVERFLOW events, each one means the kernel queue was full and events were lost */
+    stat_counter reads; /** > reads returning events */
+    stat_counter read_size; /** > current size of the read buffer */
+    stat_counter read_peak; /** > largest size the read buffer grew to */
+    uint64_t reported_events; /** > events at the last report, main thread only */
+    uint64_t reported_reads; /** > reads at the last report, main thread only */
+    uint64_t reported_overflows; /** > overflows at the last report, main thread only */
+    stat_counter stalls; /** > times an event waited for room in a full ring */
+    stat_counter stall_ns; /** > time spent waiting for room in full rings */
+};
+
+/**
+ * @brief mount point found in the mount table
+ */
+struct mount_entry {
+    dev_t dev; /** > device of the mounted filesystem */
+    int whole; /** > set when the whole filesystem is mounted, not a bind mount of a subdirectory */
+    char path[PATH_LENGTH]; /** > mount point */
+};
+
+/**
+ * @brief filesystems found while reading the mount table, one entry per device
+ */
+struct mount_scan {
+    struct mount_entry *entries; /** > malloc'ed entries */
+    size_t count; /** > count of entries */
+};
+
 /**
  * struct that stores the count of items the blacklist currently holds
  */
 struct blacklist_updater {
     char ***blk_entries; /** > entries of the blacklist */
+    struct path_trie *trie; /** > trie the entries are inserted into */
+    struct path_rules *rules; /** > glob and regex rules */
+    size_t count; /** > count of entries */
+};
+
+/**
+ * struct that stores the state of a table being written as text
+ */
+struct table_content {
+    struct line_writer writer; /** > file the entries are formatted into */
     size_t count; /** > count of entries */
+    int prune; /** > set if files are checked with stat, deletes were not all reported */
+    int failed; /** > set if an entry couldnt be stored */
+};
+
+/**
+ * struct that stores the state of a table being added to the write-ahead log
+ */
+struct table_log {
+    int prune; /** > set if files are checked with stat, deletes were not all reported */
+    size_t count; /** > count of entries logged */
+    int failed; /** > set if an entry couldnt be logged */
+};
+
+/**
+ * @brief delete or rename collected from a worker table
+ */
+struct saved_record {
+    uint64_t seq; /** > sequence number of the record, records are logged in this order */
+    char *from; /** > malloc'ed path deleted or renamed */
+    char *to; /** > malloc'ed new path of a rename, NULL for a delete */
+};
+
+/**
+ * @brief table and operations replayed from the write-ahead log, written as a new run
+ */
+struct run_delta {
+    struct file_table table; /** > counters replayed */
+    struct snapshot_builder builder; /** > new run, the deletes and renames are added while replaying */
+    int prune; /** > set if files are checked with stat before being written */
+    int failed; /** > set if a file couldnt be added to the run */
+    uint32_t minute; /** > minute since the epoch of the counters being replayed, 0 if unknown */
+};
+
+/**
+ * @brief cost of the flushes, on each side of the handoff
+ */
+struct flush_stats {
+    stat_counter flushes; /** > tables handed off to the persistence thread, main thread only */
+    stat_counter deferred; /** > flushes put off while the previous tables were still being committed, main thread only */
+    stat_counter wait_ns; /** > time the main thread waited for the workers to hand their tables off, main thread only */
+    stat_counter commit_ns; /** > time spent committing the frozen tables, persistence thread only */
+    stat_counter commit_peak_ns; /** > longest commit, persistence thread only */
+};
+
+/**
+ * struct that stores the records collected from the worker tables
+ */
+struct record_list {
+    struct saved_record *records; /** > malloc'ed records */
+    size_t count; /** > count of records */
+    size_t cap; /** > records allocated */
+    int failed; /** > set if a record couldnt be stored */
 };
 
-volatile sig_atomic_t running = 1; /* flag for the main loop */
+atomic_int running = 1; /* flag for the main loop, read by every thread */
+
+volatile sig_atomic_t merge_requested = 0; /* set by SIGUSR1, handled by the main loop */
+
+volatile sig_atomic_t blacklist_requested = 0; /* set by SIGUSR2, handled by the main loop */
 
-char **blk_entries; /* list to store all the blacklist entries */
+atomic_int reader_done = 0; /* set when every reader stopped, workers exit once their ring is empty */
 
-uint16_t file_count = 1; /* counter for the current amount of opening temporary files created */
+char **blk_entries; /* list to store all the blacklist entries, used to install the kernel ignore marks */
+
+struct path_trie blk_trie; /* blacklist entries and the paths the daemon writes to, matched by path_in_blacklist */
+
+struct path_rules blk_rules; /* glob and regex rules of the blacklist, matched by path_in_blacklist */
+
+pthread_rwlock_t blk_lock; /* held for reading by the workers, for writing while updating the blacklist */
+
+atomic_uint ignore_flags = FAN_MARK_IGNORE_SURV; /* falls back to FAN_MARK_IGNORED_MASK on kernels older than 6.0, also written by the workers */
+
+atomic_int flush_wanted = 0; /* set by a worker whose table grew past MAX_GROUP_SIZE */
+
+atomic_ullong record_seq = 0; /* orders the deletes and renames recorded by different workers */
+
+atomic_int stat_fallback = 0; /* set when a group cant report deletes, saved files are checked with stat then */
+
+atomic_int deletes_lost = 0; /* set on queue overflows, the next save checks files with stat since deletes may have been lost */
+
+struct wal wal; /* write-ahead log the tables are committed to, owned by the persistence thread while it runs */
+
+enum wal_sync wal_sync = WAL_SYNC_COMMIT; /* fsync policy of the write-ahead log */
+
+int use_io_uring = 0; /* set by --io-uring, the readers and the write-ahead log go through io_uring when the kernel allows it */
+
+struct io_ring io_ring = { .fd = -1 }; /* ring the write-ahead log is written through, owned like wal */
+
+uint64_t checkpoint_segment = 0; /* last segment written as a run, owned like wal */
+
+struct manifest manifest; /* live runs of RUNS_DIR_PATH, guarded by runs_lock */
+
+pthread_mutex_t runs_lock = PTHREAD_MUTEX_INITIALIZER; /* held while manifest is read or replaced */
+
+pthread_cond_t compact_cond = PTHREAD_COND_INITIALIZER; /* signaled when a run is added or the compactor must stop */
+
+pthread_t compactor; /* thread running compactor_loop */
+
+int compactor_started = 0; /* set once the compactor thread runs, only used by the main thread */
+
+int compactor_stop = 0; /* set to stop the compactor, guarded by runs_lock */
+
+struct compaction_stats compact_stats; /* runs written from the write-ahead log and merged by the compactor */
+
+pthread_t persister; /* thread running persist_loop */
+
+int persister_started = 0; /* set once the persistence thread runs, only used by the main thread */
+
+pthread_mutex_t persist_lock = PTHREAD_MUTEX_INITIALIZER; /* guards persist_pending, persist_merge and persist_stop */
+
+pthread_cond_t persist_cond = PTHREAD_COND_INITIALIZER; /* signaled when tables are handed off or the persistence thread must stop */
+
+int persist_pending = 0; /* set from the handoff until the frozen tables are committed, guarded by persist_lock */
+
+int persist_merge = 0; /* set when the commit is followed by a checkpoint, guarded by persist_lock */
+
+int persist_stop = 0; /* set to stop the persistence thread, guarded by persist_lock */
+
+struct flush_stats flush_stats; /* handoffs requested by the main thread and commits of the persistence thread */
+
+enum listener_mode mode = MODE_FID; /* reporting mode requested for new groups */
+
+int all_filesystems = 0; /* watch every filesystem with its own group instead of the root mount only */
+
+int mountinfo_fd = -1; /* mount table, polled for mounts and unmounts when watching every filesystem */
+
+size_t cache_size = PATH_CACHE_SIZE; /* max directories the path cache of each worker can hold, 0 disables it */
+
+uint64_t count_mask = EVENT_MASK; /* events the groups subscribe to, SESSION_MASK in session mode */
+
+long modify_window = MODIFY_WINDOW_MS; /* milliseconds identical FAN_MODIFY events are collapsed in, 0 disables it */
+
+long read_delay = 0; /* microseconds a reader waits after waking up so a burst is drained with fewer reads, 0 disables it */
+
+struct timespec last_report; /* time of the last statistics report, only used by the main thread */
+
+time_t interval_start; /* wall clock time of the last statistics report, only used by the main thread */
+
+uint64_t reported_dropped = 0; /* events dropped by the workers at the last report, only used by the main thread */
+
+unsigned int queue_flags = 0; /* FAN_UNLIMITED_QUEUE when the kernel queue must never overflow */
+
+atomic_uint cache_epoch = 0; /* bumped on queue overflows, directory renames may have been lost so every path cache is cleared */
+
+size_t worker_count = 1; /* count of worker threads */
+
+struct worker *workers = NULL; /* worker threads, see worker_count */
+
+struct fan_group *groups[MAX_GROUPS] = { NULL }; /* watched filesystems, a group is stored at slot id % MAX_GROUPS */
+
+uint32_t next_group = 0; /* id of the next group, only used by the main thread */
 
 /** 
  * @brief main loop of the process 
  *  
- * starts recording events using fanotify and poll
+ * starts the reader and worker threads, then handles
+ * the periodic saves, the mount table changes and the requests coming from signals
  *  
- * each time an event is registered, saves it in a table
- *  
- * when reached a certain amount of saves, loads all the data to a permanent file
- * @param file_table table that stores all the file events recorded
- * @param fan_fd file descriptor of fanotify
+ * when the process is stopped, waits for every thread to finish
+ * @return 1 if successful, 0 if the threads couldnt be started
  */
-static void loop(struct _file **file_table, int fan_fd);
+static int loop(void);
 
 /**
  * @brief pre-finish cleanup
  *  
  * prepares the process to finish,
  * it cleans the memory and saves all the allocated data
- * @param file_table table that stores all the file events recorded
- * @param fan_fd file descriptor of fanotify
  */
-static void clean_loop(struct _file **file_table, int fan_fd);
+static void clean_loop(void);
 
 /**
- * @brief signal handling
- *  
- * when a signal is recieved, it updates the value of variable running to 0.
- * this makes the function loop to stop after the next iteration.
+ * @brief starts the worker threads and the groups watching the filesystems
  *  
- * @param sig number of the signal recieved.
- * 
+ * the threads are started with every signal blocked,
+ * so signals are always delivered to the main thread
+ * @return 1 if successful, 0 if failed
  */
-static void terminate(const int sig);
+static int start_threads(void);
 
 /**
- * @brief returns a file path
- *  
- * given a file descriptor fd, reads the link from '/proc/self/fd/...'
- * to return the path of the file descriptor
+ * @brief waits for the reader and worker threads to finish
  *  
- * @param fd file descriptor
- * @param buff buffer that is going to store the real path
- * @param size length of the path
- * @return real file path of a file descriptor
+ * must be called after running is set to 0
  */
-static int getfilepath(const int fd, char *buff, size_t size);
+static void stop_threads(void);
 
 /**
- * clears the current content stored in memory by the blacklist
+ * @brief creates a thread with every signal blocked
+ *  
+ * @param thread thread handle
+ * @param routine thread routine
+ * @param arg argument of the routine
+ * @return 1 if successful, 0 if failed
  */
-static void clear_blacklist(void);
+static int spawn_thread(pthread_t *thread, void *(*routine)(void *), void *arg);
 
 /**
- * @brief checks if a line its inside the blacklist
- * 
- * comparing line to the path searched,
- * if the path is equal to the line, it marks it as found
- * 
- * @param line the line that is going to be compared
- * @param arg struct that holds the entries of the blacklist and the count of the entries
+ * @brief starts watching a filesystem
+ *  
+ * initializes a new fanotify group on the mount point, installs its
+ * ignore marks and starts its reader thread
+ *  
+ * @param path mount point
+ * @param dev device of the filesystem
+ * @param mark_type FAN_MARK_FILESYSTEM to watch the whole filesystem, FAN_MARK_MOUNT for this mount only
+ * @return 1 if successful, 0 if failed
  */
-static void blacklist_handler(char *line, void *arg);
+static int add_group(const char *path, dev_t dev, unsigned int mark_type);
 
 /**
- * updates the content of the blacklist stored in memory
+ * @brief stops watching a filesystem
+ *  
+ * stops the reader of the group, then unpublishes it holding blk_lock for writing,
+ * the records of the group still queued in the rings are dropped by the workers
+ *  
+ * @param g group struct
  */
-static int update_blacklist(void);
+static void remove_group(struct fan_group *g);
 
-/* on signal recieved calls the method for updating the blacklist */
-static void updateblk(const int sig); 
+/* closes the descriptors of a group and frees it */
+static void free_group(struct fan_group *g);
 
 /**
- * @brief returns if a path its inside a blacklist
+ * @brief returns the group that read a record
  *  
- * reads the content stored in memory by the blacklist_entry struct
- * returns whether or not a path is inside the blacklist
+ * workers must hold blk_lock for reading
  *  
- * @param path path that is going to be checked if its inside the blacklist
- * @return 1 if found, 0 if not found
+ * @param id group id stamped on the record
+ * @return group struct, NULL if the group was removed
  */
-static int path_in_blacklist(const char *path);
+static struct fan_group *find_group(uint32_t id);
 
 /**
- * @brief handles a file line read
- * 
- * when reached a line while reading a file, handles it
- * by splitting using ':' as a delimiter
- * 
- * then adds that splitted line into a table
- * 
- * @param line line that is going to be processed
- * @param arg table that is going to be modified
+ * @brief matches the watched filesystems against the mount table
+ *  
+ * starts a group for every new filesystem and removes the groups
+ * of the filesystems that were unmounted
  */
-static void loadtable_handler(char *line, void *arg);
+static void sync_groups(void);
 
 /**
- * @brief loads a file for storing its data
+ * @brief handles a line of the mount table
  *  
- * loads a file and parses its content
- * each line parsed will be stored as a new item in the table
- * in the process, it modifies the items in the table with each item added
- * 
- * @param path path of the file that is going to be read
- * @param table file table address
- * @return 1 if successful, 0 if failed
+ * skips pseudo filesystems and blacklisted mount points,
+ * keeps a single mount point per device
+ *  
+ * @param line line of /proc/self/mountinfo
+ * @param arg mount_scan struct
  */
-static int loadtable(const char* path, struct _file **table);
+static void mountinfo_handler(char *line, void *arg);
+
+/* decodes in place the octal escapes the mount table uses for spaces, tabs and newlines */
+static void unescape_mount(char *path);
 
 /**
- * @brief returns the content of a table
- * 
- * given a table, returns its content in a malloc'ed array
- * @param table table thats going to be read
- * @param out malloc'ed array that is going to be returned
- * @return amount of entries alloc'ed
+ * @brief returns if a filesystem type holds no regular files worth watching
+ *  
+ * @param fstype filesystem type
+ * @return 1 if pseudo, 0 if not
  */
-static size_t get_file_content(struct _file **table, char ***out);
+static int pseudo_filesystem(const char *fstype);
 
 /**
- * @brief saves a struct into disk
+ * @brief hands the tables of every worker off to the persistence thread
  *  
- * saves the current content of a table into a file
- * truncates the file and re-writes the new content into it
+ * each worker swaps its table for an empty one at its next batch and keeps
+ * ingesting, the frozen tables are committed by persist_loop, so neither
+ * the workers nor the main thread wait for the write-ahead log
  *  
- * @param table the struct that is going to be saved into disk
- * @param save_path path of the file where the entries are going to be stored in disk
- * @return 1 if successful, 0 if failed
- * 
+ * a flush is put off while the previous frozen tables are still being committed
+ * @param merge flag indicating if a checkpoint follows the commit
+ * @return 1 if the tables were handed off, 0 if the flush was put off
  */
-static int savetable(struct _file **table, const char *save_path);
+static int flush_workers(int merge);
 
 /**
- * @brief merge all temporary files created into one single table
+ * @brief hands the table of a worker off to the persistence thread
  *  
- * using a pre-formatted path, formats it up to tmp_count
- * and reads its content, after loading everything, 
- * saves the table into a permanent file path
+ * only called by the worker itself, when the main thread requested it
  *  
- * @param save_path path of the file where the entries are going to be stored in disk
- * @return 1 if successful, 0 if failed
+ * the table handed off before was committed by the time the next flush is requested,
+ * it is cleared here so its arena chunks go back to the worker and the new table reuses them
+ * @param w worker struct
  */
-static int mergetmp(const char *save_path);
+static void handoff_table(struct worker *w);
 
 /**
- * @brief custom signal handling
+ * @brief persistence thread
  *  
- * handles SIGUSR1 and merges both tables into permanent space on disk
- * @param sig number of the signal recieved.
+ * sleeps until the workers hand their tables off, then commits them as one group
+ * and writes a checkpoint when requested or when too many segments were sealed
+ *  
+ * the tables are sharded by file, all of them are written as one group
+ * and written later as a run by checkpoint
+ * @param arg unused
  */
-void mergeall(const int sig);
+static void *persist_loop(void *arg);
 
-/** 
- * @brief initalize fanotify in a specific path
+/**
+ * @brief stops the persistence thread
  *  
- * given a path, tries to initialize fanotify on that path
- * with the flags FAN_OPEN and FAN_MODIFY
- * 
- * @param path path where fanotify is going to be setted up
- * @return file descriptor of fanotify
-*/
-static int init_fanotify(const char *path);
+ * waits for the frozen tables handed off to be committed,
+ * the write-ahead log is used by the main thread again afterwards
+ */
+static void stop_persister(void);
 
 /**
- * @brief sets up the signals the daemon needs
+ * @brief reader thread
  *  
- * sets up signals that can end the process, such as:
+ * only drains the fanotify group: copies each event into a compact record
+ * and pushes it to the ring of the worker in charge of it
  *  
- * - SIGTERM
+ * the read buffer grows while reads come back full and shrinks back once
+ * the queue cools down, the reader sleeps without timeout until events or a stop request arrive
  *  
- * - SIGKILL
+ * when a ring is full, waits for the worker instead of dropping the event
+ * @param arg group struct
+ */
+static void *reader_loop(void *arg);
+
+/**
+ * @brief resizes the reads of a reader
  *  
- *  sets up both SIGUSR1 and SIGUSR2 for handling events like:
- * 
- * - merging file content
- * - updating blacklist
+ * the buffer is only reallocated when it has to grow past its capacity,
+ * shrinking just shortens the reads, so a reader swinging between idle and hot does not allocate
+ *  
+ * @param g group of the reader
+ * @param buffer current read buffer
+ * @param capacity allocated size of the buffer, updated when it grows
+ * @param size new size of the reads
+ * @return resized buffer, the current one if the allocation failed
  */
-static void setup_signals(void);
+static struct fanotify_event_metadata *resize_read_buffer(struct fan_group *g, struct fanotify_event_metadata *buffer,
+                                                          size_t *capacity, size_t size);
 
-/** 
- * @brief sets up the files needed by the daemon
+/**
+ * @brief waits for events through the ring of a reader
  *  
- * creates every file needed for processing data
+ * arms a poll on the fanotify descriptor and another one on the stop eventfd,
+ * unless they are still armed, and sleeps in io_uring_enter until one of them completes
  *  
- * see macros:
+ * @param g group of the reader
+ * @param ring ring of the reader
+ * @param armed bits of the polls armed, see reader_op
+ * @return 1 if fanotify has events, 0 if not, -1 if the ring failed
+ */
+static int ring_wait_events(struct fan_group *g, struct io_ring *ring, unsigned int *armed);
+
+/**
+ * @brief reads the fanotify descriptor through the ring of a reader
  *  
- * - SAVE_PATH
+ * the descriptor is non-blocking, an empty queue completes with EAGAIN like read does
  *  
- * - BLACKLIST_PATH
+ * @param g group of the reader
+ * @param ring ring of the reader
+ * @param armed bits of the polls armed, cleared when a poll completes meanwhile
+ * @param buffer read buffer
+ * @param size bytes to read
+ * @return bytes read, -1 if failed with errno set
+ */
+static ssize_t ring_read_events(struct fan_group *g, struct io_ring *ring, unsigned int *armed, void *buffer, size_t size);
+
+/**
+ * @brief worker thread
  *  
- * - TMP_FILE_PATH
+ * pops events from its ring, resolves their path,
+ * checks the blacklist and adds them to the table
+ * @param arg worker struct
  */
-static void setup_files(void);
+static void *worker_loop(void *arg);
 
-int main(void) {
-    struct _file *file_table = NULL; /* stores file events in memory */
-    blk_entries = NULL;
+/**
+ * @brief copies an event into the ring of a worker
+ *  
+ * blocks while the ring is full, counting the stall
+ *  
+ * @param g group the event was read from
+ * @param w worker the event is sent to
+ * @param meta event metadata
+ * @param info info record of the event, NULL in fd mode
+ * @param info_len bytes copied from info, renames carry the old and the new name records
+ * @param hash hash of the file identity
+ */
+static void push_event(struct fan_group *g, struct worker *w, const struct fanotify_event_metadata *meta,
+                        const struct fanotify_event_info_header *info, size_t info_len, uint32_t hash);
 
-    int fan_fd; /* file descriptor of fanotify events */
+/**
+ * @brief dispatches an event read from fanotify
+ *  
+ * events of the same file always go to the same worker,
+ * directory deletes and renames go to every worker since each one has its own path cache
+ *  
+ * @param g group the event was read from
+ * @param meta event metadata followed by its info records
+ */
+static void dispatch_event(struct fan_group *g, const struct fanotify_event_metadata *meta);
 
-    setup_signals();
+/* wakes up the workers that received events from a group while sleeping */
+static void wake_workers(struct fan_group *g);
 
-    openlog("file_listener", LOG_PID | LOG_CONS, LOG_DAEMON);
-    syslog(LOG_INFO, "Daemon has started.");
+/**
+ * @brief handles an event popped from the ring of a worker
+ *  
+ * @param w worker struct
+ * @param record event record
+ */
+static void handle_event(struct worker *w, const struct event_record *record);
 
-    setup_files();
-    update_blacklist();
+/**
+ * @brief checks if an event repeats a FAN_MODIFY seen within the modify window
+ *  
+ * the key is the file, the pid and the mask of the event: in FID mode the parent
+ * directory handle and the name, in fd mode the inode, so the path is never resolved
+ *  
+ * @param w worker handling the event
+ * @param g group the event was read from
+ * @param record event record
+ * @return 1 if the event must be dropped, 0 if it must be recorded
+ */
+static int coalesce_event(struct worker *w, struct fan_group *g, const struct event_record *record);
 
-    fan_fd = init_fanotify("/");
-    if (fan_fd < 0) {
-        return EXIT_FAILURE;
-    }
-    
-    loop(&file_table, fan_fd);
-    clean_loop(&file_table, fan_fd);
-    
-    syslog(LOG_INFO, "Daemon has stopped.");
-    closelog();
+/**
+ * @brief returns an info record of an event
+ *  
+ * walks the info records that follow the event metadata
+ *  
+ * @param meta event metadata followed by its info records
+ * @param type type of the info record searched
+ * @return info record, NULL if not found
+ */
+static const struct fanotify_event_info_header *find_info(const struct fanotify_event_metadata *meta, uint8_t type);
+
+/**
+ * @brief hashes the file identity of a FID info record
+ *  
+ * the identity is the parent directory handle plus the file name
+ *  
+ * @param info FAN_EVENT_INFO_TYPE_DFID_NAME info record
+ * @return hash of the identity
+ */
+static uint32_t hash_info(const struct fanotify_event_info_header *info);
+
+/**
+ * @brief signal handling
+ *  
+ * when a signal is recieved, it updates the value of variable running to 0.
+ * this makes the function loop to stop after the next iteration.
+ *  
+ * @param sig number of the signal recieved.
+ * 
+ */
+static void terminate(const int sig);
+
+/**
+ * @brief returns a file path
+ *  
+ * given a file descriptor fd, reads the link from '/proc/self/fd/...'
+ * to return the path of the file descriptor
+ *  
+ * @param fd file descriptor
+ * @param buff buffer that is going to store the real path
+ * @param size length of the path
+ * @return real file path of a file descriptor
+ */
+static int getfilepath(const int fd, char *buff, size_t size);
+
+/**
+ * @brief returns the path of a directory handle
+ *  
+ * looks the handle up in the path cache first,
+ * on a miss opens the handle and reads its path, then caches it
+ *  
+ * @param cache path cache of the calling worker, NULL to skip it
+ * @param g group the handle was reported by
+ * @param fid info record holding the fsid and the directory handle
+ * @param buff buffer that is going to store the real path
+ * @param size length of the path
+ * @return 0 if resolved, -1 if failed
+ */
+static int getdirpath(struct path_cache *cache, const struct fan_group *g, const struct fanotify_event_info_fid *fid, char *buff, size_t size);
+
+/**
+ * @brief returns the file path of an event reported in FID mode
+ *  
+ * resolves the parent directory handle stored in the record
+ * and appends the file name to it
+ *  
+ * @param cache path cache of the calling worker, NULL to skip it
+ * @param g group the event was read from
+ * @param info DFID_NAME, OLD_DFID_NAME or NEW_DFID_NAME info record of the event
+ * @param buff buffer that is going to store the real path
+ * @param size length of the path
+ * @return 0 if resolved, 1 if the event has no file to record, -1 if failed
+ */
+static int getfidpath(struct path_cache *cache, const struct fan_group *g, const struct fanotify_event_info_header *info, char *buff, size_t size);
+
+/**
+ * @brief finds an info record of a given type among the ones copied into an event record
+ *  
+ * @param record event record
+ * @param type info type searched
+ * @return info record, NULL if missing
+ */
+static const struct fanotify_event_info_header *record_info(const struct event_record *record, uint8_t type);
+
+/**
+ * @brief returns the file path of an event
+ *  
+ * depending on the mode the group was initialized with,
+ * reads the path from the event file descriptor or from its file handle
+ *  
+ * @param w worker handling the event
+ * @param g group the event was read from
+ * @param record event record
+ * @param buff buffer that is going to store the real path
+ * @param size length of the path
+ * @return 0 if resolved, 1 if the event has no file to record, -1 if failed
+ */
+static int geteventpath(struct worker *w, struct fan_group *g, const struct event_record *record, char *buff, size_t size);
+
+/* closes the file descriptor of an event, if it holds one */
+static void close_event(const struct event_record *record);
+
+/**
+ * @brief handles a directory entry event
+ *  
+ * when a directory is deleted or renamed, drops its cached path,
+ * on rename every path cached below it is dropped too
+ *  
+ * @param w worker handling the event
+ * @param g group the event was read from
+ * @param record event record
+ */
+static void handle_dirent(struct worker *w, struct fan_group *g, const struct event_record *record);
+
+/**
+ * @brief applies a delete or a rename to the table of a worker
+ *  
+ * the files under the deleted path are removed, the ones under a renamed path
+ * are moved with their counters, so saved tables never need to stat their files
+ *  
+ * directory events reach every worker, only the one picked by the hash records them
+ * so the entries saved before are pruned or moved once when the temporary files are merged
+ *  
+ * without FAN_RENAME support, the old name of a rename is handled as a delete
+ *  
+ * @param w worker handling the event
+ * @param g group the event was read from
+ * @param record event record
+ */
+static void prune_entries(struct worker *w, struct fan_group *g, const struct event_record *record);
+
+/* logs the statistics of the daemon, called once per save interval */
+static void report_stats(void);
+
+/**
+ * @brief records the events lost during the last interval
+ *  
+ * when something was lost, appends a line 'start:end:overflows:dropped'
+ * to DROPS_PATH, so fview can flag its results as incomplete
+ *  
+ * @param overflows kernel queue overflows during the interval, each one lost an unknown count of events
+ * @param dropped events lost in user space during the interval
+ */
+static void report_drops(uint64_t overflows, uint64_t dropped);
+
+/**
+ * clears the current content stored in memory by the blacklist
+ */
+static void clear_blacklist(void);
+
+/**
+ * @brief adds a line of the blacklist file to the blacklist
+ * 
+ * lines tagged with PATH_RULE_GLOB_TAG or PATH_RULE_REGEX_TAG are added as rules,
+ * untagged empty lines and relative paths are skipped, they would match either every path or none
+ * 
+ * @param line the line that is going to be added
+ * @param arg struct that holds the entries of the blacklist and the count of the entries
+ */
+static void blacklist_handler(char *line, void *arg);
+
+/**
+ * @brief updates the content of the blacklist stored in memory
+ *  
+ * also replaces the kernel ignore marks of every group, so events under
+ * blacklisted directories are not even queued
+ *  
+ * the new blacklist is built and compiled first, blk_lock is only held for writing
+ * while it replaces the current one and the ignore marks are synced
+ * @return 1 if successful, 0 if failed
+ */
+static int update_blacklist(void);
+
+/**
+ * @brief installs a kernel ignore mark on a directory
+ *  
+ * the mark drops IGNORE_MASK events of the directory children,
+ * or of the whole mount when type is FAN_MARK_MOUNT
+ *  
+ * @param g group the mark is installed in
+ * @param path directory path
+ * @param type 0 for an inode mark, FAN_MARK_MOUNT for a mount mark
+ * @return 1 if installed, 0 if failed
+ */
+static int add_ignore_mark(struct fan_group *g, const char *path, unsigned int type);
+
+/**
+ * @brief replaces the kernel ignore marks of a group with the ones of the current blacklist
+ *  
+ * only the blacklisted directories living on the filesystem of the group are marked,
+ * inode marks only cover the direct children of a directory, deeper directories
+ * are marked by learn_ignore_mark as their events show up
+ *  
+ * @param g group struct
+ */
+static void sync_ignore_marks(struct fan_group *g);
+
+/**
+ * @brief installs an ignore mark on the directory of a blacklisted path
+ *  
+ * called when the blacklist drops an event in user space,
+ * so the next events of the same directory are dropped by the kernel
+ *  
+ * @param w worker handling the event
+ * @param g group the event was read from
+ * @param path blacklisted path
+ */
+static void learn_ignore_mark(struct worker *w, struct fan_group *g, const char *path);
+
+/* on signal recieved requests the main loop to update the blacklist */
+static void updateblk(const int sig); 
+
+/**
+ * @brief returns if a path its inside a blacklist
+ *  
+ * looks the path up in blk_trie, one component at a time, then runs it through the automatons of blk_rules,
+ * so the cost depends on the length of the path and not on the size of the blacklist
+ *  
+ * @param path path that is going to be checked if its inside the blacklist
+ * @return 1 if found, 0 if not found
+ */
+static int path_in_blacklist(const char *path);
+
+/**
+ * @brief handles a file line read
+ * 
+ * when reached a line while reading a file, handles it
+ * by cutting its two counters off at the last ':' delimiters
+ * 
+ * then adds that splitted line into a table
+ * 
+ * the checkpoint line heading the file is skipped
+ * 
+ * @param line view of the line that is going to be processed
+ * @param arg table that is going to be modified
+ */
+static void loadtable_handler(struct line_view line, void *arg);
+
+/**
+ * @brief loads a file for storing its data
+ *  
+ * loads a file and parses its content
+ * each line parsed will be stored as a new item in the table
+ * in the process, it modifies the items in the table with each item added
+ * 
+ * @param path path of the file that is going to be read
+ * @param table file table address
+ * @return 1 if successful, 0 if failed
+ */
+static int loadtable(const char* path, struct file_table *table);
+
+/**
+ * @brief formats a file of a table as a line of its file
+ *  
+ * the line is formatted straight into the buffer of the writer,
+ * files that are blacklisted, or no longer exist when the content is pruned, are removed from the table instead
+ *  
+ * @param table table being walked
+ * @param item node of the file
+ * @param path full path of the file
+ * @param len length of path
+ * @param arg table_content struct the entry is stored into
+ */
+static void content_handler(struct file_table *table, struct _file *item, const char *path, size_t len, void *arg);
+
+/**
+ * @brief removes a file from a table if it must not be saved
+ *  
+ * files that are blacklisted, or no longer exist when the table is pruned, are not saved
+ *  
+ * takes blk_lock for reading, callers must not hold it
+ *  
+ * @param table table the file belongs to
+ * @param item node of the file
+ * @param path full path of the file
+ * @param prune flag indicating if the file is checked with stat
+ * @return 1 if removed, 0 if not
+ */
+static int drop_entry(struct file_table *table, struct _file *item, const char *path, int prune);
+
+/**
+ * @brief adds a file of a table to the current group of the write-ahead log
+ *  
+ * @param table table being walked
+ * @param item node of the file
+ * @param path full path of the file
+ * @param len length of path
+ * @param arg table_log struct
+ */
+static void log_handler(struct file_table *table, struct _file *item, const char *path, size_t len, void *arg);
+
+/**
+ * @brief adds the files of a table to the current group of the write-ahead log
+ *  
+ * @param table the struct that is going to be logged
+ * @param prune flag indicating if files are checked with stat before being logged
+ * @return count of entries logged
+ */
+static size_t logtable(struct file_table *table, int prune);
+
+/**
+ * @brief saves a struct into disk
+ *  
+ * saves the current content of a table into a file
+ * truncates the file and re-writes the new content into it,
+ * or appends the content when trunc is 0
+ *  
+ * the entries are streamed through a buffer of LINE_WRITER_SIZE bytes,
+ * so saving takes the same memory whatever the size of the table;
+ * an empty table leaves an empty file
+ *  
+ * @param table the struct that is going to be saved into disk
+ * @param save_path path of the file where the entries are going to be stored in disk
+ * @param trunc flag indicating if the file is going to be truncated
+ * @param prune flag indicating if files are checked with stat before being saved
+ * @return 1 if successful, 0 if failed
+ * 
+ */
+static int savetable(struct file_table *table, const char *save_path, int trunc, int prune);
+
+/**
+ * @brief adds the deletes and renames recorded by the workers to the current group of the write-ahead log
+ *  
+ * the records of every worker are logged in the order they happened,
+ * before the tables they come with, so replaying only applies them to the entries logged before
+ *  
+ * @param frozen flag indicating if the frozen tables are logged, or the current ones
+ * @return count of records logged
+ */
+static size_t logrecords(int frozen);
+
+/**
+ * @brief commits the tables and records of every worker as one group
+ *  
+ * @param frozen flag indicating if the frozen tables are committed, or the current ones
+ * @return 1 if something was committed, 0 if not
+ */
+static int commit_tables(int frozen);
+
+/* adds a record of a table to a record_list struct */
+static void record_collector(uint64_t seq, const char *from, const char *to, void *arg);
+
+/* orders saved_record structs by sequence number */
+static int compare_records(const void *a, const void *b);
+
+/**
+ * @brief writes the sealed segments of the write-ahead log as a new run
+ *  
+ * seals the open segment and replays every segment after the last checkpoint
+ * into a delta, which becomes the newest run of RUNS_DIR_PATH; the deletes and
+ * renames replayed are kept in the run, they apply to the runs older than it
+ *  
+ * only what was logged since the previous checkpoint is written,
+ * merging the runs is left to the compactor thread
+ *  
+ * the manifest holds the last segment written, so segments left behind
+ * by a crash before their removal are never written twice
+ * @return 1 if successful, 0 if failed
+ */
+static int checkpoint(void);
+
+/**
+ * @brief applies a record of the write-ahead log to a delta
+ *  
+ * @param entry record replayed
+ * @param arg run_delta struct
+ */
+static void replay_handler(const struct wal_entry *entry, void *arg);
+
+/**
+ * @brief reads the last segment merged into a permanent file
+ *  
+ * only the files written before the runs were introduced hold one
+ *  
+ * @param save_path path of the permanent file
+ * @return id of the segment, 0 if the file has no checkpoint line
+ */
+static uint64_t read_checkpoint(const char *save_path);
+
+/**
+ * @brief adds a file of a delta to its run
+ *  
+ * files that are blacklisted, or no longer exist when the delta is pruned, are dropped
+ *  
+ * @param table table being walked
+ * @param item node of the file
+ * @param path full path of the file
+ * @param len length of path
+ * @param arg run_delta struct
+ */
+static void run_collector(struct file_table *table, struct _file *item, const char *path, size_t len, void *arg);
+
+/**
+ * @brief writes a delta as the newest run and adds it to the manifest
+ *  
+ * the run is written without holding runs_lock, the lock is only held
+ * while the manifest is replaced; an empty delta only moves the segment of the manifest
+ *  
+ * @param delta run_delta struct
+ * @param segment last segment of the write-ahead log replayed into the delta
+ * @return 1 if successful, 0 if failed
+ */
+static int add_run(struct run_delta *delta, uint64_t segment);
+
+/**
+ * @brief compactor thread
+ *  
+ * sleeps until a run is added, then merges the runs picked by compaction_pick
+ * until none are left, each merge is published by replacing the manifest
+ *  
+ * runs_lock is only held to pick the runs and to splice the merged one in,
+ * so checkpoints keep adding runs while a merge is running
+ *  
+ * once the oldest run is merged, SAVE_PATH is rewritten from the runs
+ * @param arg unused
+ */
+static void *compactor_loop(void *arg);
+
+/* stops the compactor thread, waiting for the merge in progress */
+static void stop_compactor(void);
+
+/**
+ * @brief decides if a file is kept while merging runs
+ *  
+ * @param path full path of the file
+ * @param arg flag indicating if the file is checked with stat
+ * @return 1 to keep it, 0 if it is blacklisted or no longer exists
+ */
+static int compact_filter(const char *path, void *arg);
+
+/**
+ * @brief rewrites SAVE_PATH with the counters of every run
+ *  
+ * the file is written to SAVE_TMP_PATH and renamed over SAVE_PATH,
+ * it is only a plain text copy of the runs kept for reading by hand
+ */
+static void export_runs(void);
+
+/**
+ * @brief custom signal handling
+ *  
+ * handles SIGUSR1 and requests the main loop to commit
+ * the tables and write the write-ahead log as a run
+ * @param sig number of the signal recieved.
+ */
+void mergeall(const int sig);
+
+/** 
+ * @brief initalize fanotify in a specific path
+ *  
+ * given a group holding a path, tries to initialize fanotify on that path
+ * with the flags FAN_OPEN and FAN_MODIFY, or FAN_CLOSE in session mode
+ *  
+ * if the group mode is MODE_FID but the kernel or the filesystem does not support
+ * file handle reporting, falls back to MODE_FD
+ * 
+ * @param g group struct, its path and mode are set
+ * @param mark_type FAN_MARK_FILESYSTEM or FAN_MARK_MOUNT
+ * @return 1 if successful, 0 if failed
+*/
+static int init_fanotify(struct fan_group *g, unsigned int mark_type);
+
+/**
+ * @brief creates the fanotify group and marks its path
+ *  
+ * @param g group struct
+ * @param mark_type FAN_MARK_FILESYSTEM or FAN_MARK_MOUNT
+ * @param level log level of the errors, fallbacks are only warnings
+ * @return 1 if successful, 0 if failed, the descriptors opened are left for the caller to close
+ */
+static int init_group(struct fan_group *g, unsigned int mark_type, int level);
+
+/**
+ * @brief parses the command line options of the daemon
+ *  
+ * - `-f` `--fd-mode`: forces the classic file descriptor reporting mode
+ *  
+ * - `-c` `--cache-size`: max directories the path cache of each worker can hold, 0 disables it
+ *  
+ * - `-w` `--workers`: count of worker threads
+ *  
+ * - `-a` `--all-filesystems`: watches every mounted filesystem, not only the root mount
+ *  
+ * - `-d` `--read-delay`: microseconds a reader waits after waking up before reading, 0 disables it
+ *  
+ * - `-m` `--modify-window`: milliseconds identical FAN_MODIFY events are collapsed in, 0 disables it
+ *  
+ * - `-u` `--unlimited-queue`: lifts the limit of the kernel queue, so it never overflows
+ *  
+ * - `-s` `--sessions`: counts one open per open and close of a file and one modification
+ * per write session, from FAN_CLOSE_NOWRITE and FAN_CLOSE_WRITE instead of every FAN_OPEN and FAN_MODIFY
+ *  
+ * - `-y` `--fsync`: when the write-ahead log is synced, `commit` after each save (default),
+ * `segment` when a segment is sealed, or `none`
+ *  
+ * - `-i` `--io-uring`: reads fanotify and writes the write-ahead log through io_uring,
+ * falls back to blocking calls when the kernel doesnt allow it
+ *  
+ * @param argc argument count
+ * @param argv argument values
+ * @return 1 if successful, 0 if failed
+ */
+static int parse_options(int argc, char *argv[]);
+
+/**
+ * @brief sets up the signals the daemon needs
+ *  
+ * sets up signals that can end the process, such as:
+ *  
+ * - SIGTERM
+ *  
+ * - SIGKILL
+ *  
+ *  sets up both SIGUSR1 and SIGUSR2 for handling events like:
+ * 
+ * - merging file content
+ * - updating blacklist
+ */
+static void setup_signals(void);
+
+/** 
+ * @brief sets up the files needed by the daemon
+ *  
+ * creates every file needed for processing data
+ *  
+ * see macros:
+ *  
+ * - SAVE_PATH
+ *  
+ * - BLACKLIST_PATH
+ *  
+ * - WAL_DIR_PATH
+ *  
+ * - RUNS_DIR_PATH
+ */
+static void setup_files(void);
+
+/**
+ * @brief loads the manifest of the runs and starts the compactor
+ *  
+ * without a manifest, the content of SAVE_PATH is moved into the first run,
+ * the files of runs that are not live are removed
+ *  
+ * @return 1 if successful, 0 if failed
+ */
+static int setup_runs(void);
+
+/**
+ * @brief opens the write-ahead log
+ *  
+ * segments after the last checkpoint were left by a run that didnt stop cleanly,
+ * they are written as a run before a new segment is started
+ *  
+ * @return 1 if successful, 0 if failed
+ */
+static int setup_wal(void);
+
+int main(int argc, char *argv[]) {
+    blk_entries = NULL;
+    path_trie_init(&blk_trie);
+    path_rules_init(&blk_rules);
+
+    if (!parse_options(argc, argv)) {
+        return EXIT_FAILURE;
+    }
+
+    setup_signals();
+
+    openlog("file_listener", LOG_PID | LOG_CONS, LOG_DAEMON);
+    syslog(LOG_INFO, "Daemon has started.");
+
+    pthread_rwlockattr_t blk_attr;
+    pthread_rwlockattr_init(&blk_attr);
+    pthread_rwlockattr_setkind_np(&blk_attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&blk_lock, &blk_attr);
+    pthread_rwlockattr_destroy(&blk_attr);
+
+    setup_files();
+
+    update_blacklist();
+
+    if (!setup_runs()) {
+        syslog(LOG_ERR, "Couldnt load the runs in '%s'.", RUNS_DIR_PATH);
+        clear_blacklist();
+        closelog();
+        return EXIT_FAILURE;
+    }
+
+    if (!setup_wal()) {
+        syslog(LOG_ERR, "Couldnt open the write-ahead log in '%s'.", WAL_DIR_PATH);
+        stop_compactor();
+        clear_blacklist();
+        closelog();
+        return EXIT_FAILURE;
+    }
+    
+    int r = loop();
+    clean_loop();
+    
+    syslog(LOG_INFO, "Daemon has stopped.");
+    closelog();
+
+    return r ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int start_threads(void) {
+    workers = (struct worker *)calloc(worker_count, sizeof(struct worker));
+    if (!workers) {
+        perror("calloc");
+        return 0;
+    }
+
+    for (size_t i = 0; i < worker_count; i++)
+        workers[i].wake_fd = -1;
+
+    for (size_t i = 0; i < worker_count; i++) {
+        struct worker *w = &workers[i];
+
+        w->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (w->wake_fd == -1 || !event_ring_init(&w->ring, RING_SIZE)) {
+            syslog(LOG_ERR, "Error: Couldnt set up worker %zu. -> %s", i, strerror(errno));
+            return 0;
+        }
+
+        path_cache_init(&w->dir_cache, (mode == MODE_FID) ? cache_size : 0);
+        burst_filter_init(&w->modify_filter, (uint64_t)modify_window * 1000000ULL);
+    }
+
+    for (size_t i = 0; i < worker_count; i++) {
+        if (!spawn_thread(&workers[i].thread, worker_loop, &workers[i])) {
+            syslog(LOG_ERR, "Error: Couldnt start worker %zu.", i);
+            worker_count = i;
+            stop_threads();
+            return 0;
+        }
+    }
+
+    if (all_filesystems) {
+        mountinfo_fd = open(MOUNTINFO_PATH, O_RDONLY | O_CLOEXEC);
+        if (mountinfo_fd == -1)
+            syslog(LOG_WARNING, "Couldnt open '%s', mounts made later wont be watched. -> %s", MOUNTINFO_PATH, strerror(errno));
+
+        sync_groups();
+    } else {
+        struct stat st;
+        if (stat("/", &st) == 0)
+            add_group("/", st.st_dev, FAN_MARK_MOUNT);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &last_report);
+    interval_start = time(NULL);
+
+    for (size_t i = 0; i < MAX_GROUPS; i++) {
+        if (groups[i])
+            return 1;
+    }
+
+    syslog(LOG_ERR, "Error: No filesystem could be watched.");
+    stop_threads();
+    return 0;
+}
+
+static void stop_threads(void) {
+    for (size_t i = 0; i < MAX_GROUPS; i++) {
+        if (groups[i])
+            eventfd_write(groups[i]->stop_fd, 1);
+    }
+
+    for (size_t i = 0; i < MAX_GROUPS; i++) {
+        if (groups[i])
+            pthread_join(groups[i]->thread, NULL);
+    }
+
+    atomic_store(&reader_done, 1);
+
+    /* workers drain what is left in their ring before exiting */
+    for (size_t i = 0; i < worker_count; i++) {
+        eventfd_write(workers[i].wake_fd, 1);
+        pthread_join(workers[i].thread, NULL);
+    }
+}
+
+static int spawn_thread(pthread_t *thread, void *(*routine)(void *), void *arg) {
+    /* signals are handled by the main thread only */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+
+    int r = pthread_create(thread, NULL, routine, arg) == 0;
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return r;
+}
+
+static int add_group(const char *path, dev_t dev, unsigned int mark_type) {
+    /* ids are never reused, so records of a removed group cant be taken for the ones of a new group */
+    size_t tries = 0;
+    while (groups[next_group % MAX_GROUPS] && tries++ < MAX_GROUPS)
+        next_group++;
+
+    if (groups[next_group % MAX_GROUPS]) {
+        syslog(LOG_WARNING, "Couldnt watch '%s', %d filesystems are already watched.", path, MAX_GROUPS);
+        return 0;
+    }
+
+    struct fan_group *g = (struct fan_group *)calloc(1, sizeof(struct fan_group));
+    if (!g) {
+        perror("calloc");
+        return 0;
+    }
+
+    g->id = next_group++;
+    g->fan_fd = -1;
+    g->mount_fd = -1;
+    g->mode = mode;
+    g->dev = dev;
+    strncpy(g->path, path, PATH_LENGTH - 1);
+
+    g->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (g->stop_fd == -1) {
+        syslog(LOG_ERR, "Error: Couldnt create the stop eventfd for '%s'. -> %s", path, strerror(errno));
+        free(g);
+        return 0;
+    }
+
+    if (!init_fanotify(g, mark_type)) {
+        free_group(g);
+        return 0;
+    }
+
+    sync_ignore_marks(g);
+
+    pthread_rwlock_wrlock(&blk_lock);
+    groups[g->id % MAX_GROUPS] = g;
+    pthread_rwlock_unlock(&blk_lock);
+
+    /* published before its reader starts, so the workers never miss the group of a record */
+    if (!spawn_thread(&g->thread, reader_loop, g)) {
+        syslog(LOG_ERR, "Error: Couldnt start reader thread for '%s'.", path);
+
+        pthread_rwlock_wrlock(&blk_lock);
+        groups[g->id % MAX_GROUPS] = NULL;
+        pthread_rwlock_unlock(&blk_lock);
+
+        free_group(g);
+        return 0;
+    }
+
+    return 1;
+}
+
+static void remove_group(struct fan_group *g) {
+    atomic_store(&g->stop, 1);
+    eventfd_write(g->stop_fd, 1);
+    pthread_join(g->thread, NULL);
+
+    pthread_rwlock_wrlock(&blk_lock);
+    groups[g->id % MAX_GROUPS] = NULL;
+    pthread_rwlock_unlock(&blk_lock);
+
+    syslog(LOG_INFO, "Stopped watching '%s'.", g->path);
+    free_group(g);
+}
+
+static void free_group(struct fan_group *g) {
+    for (size_t i = 0; g->ignored_mounts && g->ignored_mounts[i]; i++)
+        free(g->ignored_mounts[i]);
+    free(g->ignored_mounts);
+
+    if (g->fan_fd != -1)
+        close(g->fan_fd);
+
+    if (g->mount_fd != -1)
+        close(g->mount_fd);
+
+    close(g->stop_fd);
+    free(g);
+}
+
+static struct fan_group *find_group(uint32_t id) {
+    struct fan_group *g = groups[id % MAX_GROUPS];
+    return (g && g->id == id) ? g : NULL;
+}
+
+static void sync_groups(void) {
+    struct mount_scan scan = {
+        .entries = NULL,
+        .count = 0UL
+    };
+
+    if (!readfile(MOUNTINFO_PATH, mountinfo_handler, &scan)) {
+        syslog(LOG_ERR, "Error: Couldnt read the mount table '%s'.", MOUNTINFO_PATH);
+        free(scan.entries);
+        return;
+    }
+
+    for (size_t i = 0; i < MAX_GROUPS; i++) {
+        struct fan_group *g = groups[i];
+        if (!g)
+            continue;
+
+        size_t j = 0;
+        while (j < scan.count && scan.entries[j].dev != g->dev)
+            j++;
+
+        if (j == scan.count)
+            remove_group(g);
+    }
+
+    for (size_t j = 0; j < scan.count; j++) {
+        size_t i = 0;
+        while (i < MAX_GROUPS && (!groups[i] || groups[i]->dev != scan.entries[j].dev))
+            i++;
+
+        if (i == MAX_GROUPS)
+            add_group(scan.entries[j].path, scan.entries[j].dev, FAN_MARK_FILESYSTEM);
+    }
+
+    free(scan.entries);
+}
+
+static void mountinfo_handler(char *line, void *arg) {
+    struct mount_scan *scan = (struct mount_scan *)arg;
+
+    /* id parent major:minor root mount-point options [optional fields] - fstype source super-options */
+    char *save = NULL;
+    char *fields[5];
+    for (size_t i = 0; i < 5; i++) {
+        fields[i] = strtok_r(i ? NULL : line, " ", &save);
+        if (!fields[i])
+            return;
+    }
+
+    char *fstype = NULL;
+    for (char *token = strtok_r(NULL, " ", &save); token; token = strtok_r(NULL, " ", &save)) {
+        if (strcmp(token, "-") == 0) {
+            fstype = strtok_r(NULL, " ", &save);
+            break;
+        }
+    }
+
+    unsigned int major, minor;
+    if (!fstype || sscanf(fields[2], "%u:%u", &major, &minor) != 2 || pseudo_filesystem(fstype))
+        return;
+
+    char *root = fields[3];
+    char *path = fields[4];
+    unescape_mount(root);
+    unescape_mount(path);
+
+    /* the trailing slash lets entries such as '/run/' match the mount point itself */
+    char dirpath[PATH_LENGTH];
+    snprintf(dirpath, sizeof(dirpath), "%s%s", path, (strcmp(path, "/") == 0) ? "" : "/");
+    if (path_in_blacklist(dirpath))
+        return;
+
+    dev_t dev = makedev(major, minor);
+    int whole = strcmp(root, "/") == 0;
+
+    for (size_t i = 0; i < scan->count; i++) {
+        struct mount_entry *entry = &scan->entries[i];
+        if (entry->dev != dev)
+            continue;
+
+        /* a filesystem mark covers every mount of the filesystem, any mount point resolves its handles */
+        if (whole && !entry->whole) {
+            entry->whole = 1;
+            strncpy(entry->path, path, PATH_LENGTH - 1);
+        }
+
+        return;
+    }
+
+    struct mount_entry *tmp = (struct mount_entry *)realloc(scan->entries, sizeof(struct mount_entry) * (scan->count + 1));
+    if (!tmp) {
+        perror("realloc");
+        return;
+    }
+
+    struct mount_entry *entry = &tmp[scan->count++];
+    entry->dev = dev;
+    entry->whole = whole;
+    strncpy(entry->path, path, PATH_LENGTH - 1);
+    entry->path[PATH_LENGTH - 1] = '\0';
+
+    scan->entries = tmp;
+}
+
+static void unescape_mount(char *path) {
+    char *out = path;
+
+    for (char *in = path; *in; in++) {
+        if (in[0] == '\\' && in[1] >= '0' && in[1] <= '3' && in[2] >= '0' && in[2] <= '7' && in[3] >= '0' && in[3] <= '7') {
+            *out++ = (char)(((in[1] - '0') << 6) | ((in[2] - '0') << 3) | (in[3] - '0'));
+            in += 3;
+            continue;
+        }
+
+        *out++ = *in;
+    }
+
+    *out = '\0';
+}
+
+static int pseudo_filesystem(const char *fstype) {
+    static const char *pseudo[] = {
+        "proc", "sysfs", "devtmpfs", "devpts", "cgroup", "cgroup2", "securityfs",
+        "debugfs", "tracefs", "pstore", "bpf", "mqueue", "hugetlbfs", "configfs",
+        "fusectl", "autofs", "binfmt_misc", "efivarfs", "nsfs", "rpc_pipefs", "selinuxfs",
+        NULL
+    };
+
+    for (size_t i = 0; pseudo[i]; i++) {
+        if (strcmp(fstype, pseudo[i]) == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+static int loop(void) {
+    if (!spawn_thread(&persister, persist_loop, NULL)) {
+        syslog(LOG_ERR, "Error: Couldnt start the persistence thread.");
+        return 0;
+    }
+    persister_started = 1;
+
+    if (!start_threads()) {
+        stop_persister();
+        return 0;
+    }
+
+    time_t last_save = time(NULL);
+
+    /* the mount table reports POLLPRI each time a filesystem is mounted or unmounted */
+    struct pollfd mounts = {
+        .fd = mountinfo_fd,
+        .events = POLLPRI
+    };
+
+    while(running) {
+        /* signals interrupt the wait, so their requests are handled right away */
+        int ret = poll(&mounts, (mountinfo_fd != -1) ? 1 : 0, 1000);
+
+        if (ret > 0 && (mounts.revents & (POLLPRI | POLLERR)))
+            sync_groups();
+
+        if (blacklist_requested) {
+            blacklist_requested = 0;
+
+            update_blacklist();
+
+            /* mount points may have been added to or removed from the blacklist */
+            if (all_filesystems)
+                sync_groups();
+        }
+
+        /* a request that found the previous commit still running is retried at the next wake up */
+        if (merge_requested && flush_workers(1))
+            merge_requested = 0;
+
+        time_t now = time(NULL);
+        if ((now - last_save >= INTERVAL_SEC || atomic_load(&flush_wanted)) && flush_workers(0)) {
+            atomic_store(&flush_wanted, 0);
+
+            last_save = now;
+
+            report_stats();
+        }
+    }
+
+    stop_threads();
+    stop_persister();
+    return 1;
+}
+
+static int flush_workers(int merge) {
+    pthread_mutex_lock(&persist_lock);
+    int busy = persist_pending;
+    pthread_mutex_unlock(&persist_lock);
+
+    /* the frozen tables are cleared by the next handoff, they must be committed first */
+    if (busy) {
+        stat_add(&flush_stats.deferred, 1);
+        return 0;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t i = 0; i < worker_count; i++) {
+        atomic_store_explicit(&workers[i].flush_requested, 1, memory_order_release);
+        eventfd_write(workers[i].wake_fd, 1);
+    }
+
+    /* workers answer after their current batch, or as soon as they are woken up */
+    for (size_t i = 0; i < worker_count; i++) {
+        while (atomic_load_explicit(&workers[i].flush_requested, memory_order_acquire)) {
+            struct timespec wait = { .tv_sec = 0, .tv_nsec = 1000000L };
+            nanosleep(&wait, NULL);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stat_add(&flush_stats.wait_ns, (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL + (uint64_t)(end.tv_nsec - start.tv_nsec));
+    stat_add(&flush_stats.flushes, 1);
+
+    pthread_mutex_lock(&persist_lock);
+    persist_pending = 1;
+    persist_merge = merge;
+    pthread_cond_signal(&persist_cond);
+    pthread_mutex_unlock(&persist_lock);
+
+    return 1;
+}
+
+static int commit_tables(int frozen) {
+    /* deletes lost in a queue overflow leave entries nothing would prune */
+    int prune = atomic_exchange(&deletes_lost, 0) || stat_fallback;
+
+    wal_time(&wal, (uint64_t)time(NULL));
+
+    size_t count = logrecords(frozen);
+    for (size_t i = 0; i < worker_count; i++) {
+        struct worker *w = &workers[i];
+        count += logtable(frozen ? &w->frozen : &w->table, prune);
+    }
+
+    if (!wal_commit(&wal)) {
+        syslog(LOG_ERR, "Couldnt commit %zu entries to the write-ahead log.", count);
+        return 0;
+    }
+
+    return count != 0;
+}
+
+static void handoff_table(struct worker *w) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    clear_table(&w->frozen);
+
+    w->frozen = w->table;
+    memset(&w->table, 0, sizeof(w->table));
+    w->content_count = 0;
+
+    atomic_store_explicit(&w->flush_requested, 0, memory_order_release);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint64_t ns = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL + (uint64_t)(end.tv_nsec - start.tv_nsec);
+    stat_add(&w->handoffs, 1);
+    stat_add(&w->handoff_ns, ns);
+    stat_max(&w->handoff_peak_ns, ns);
+}
+
+static void *persist_loop(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&persist_lock);
+    for (;;) {
+        while (!persist_pending && !persist_stop)
+            pthread_cond_wait(&persist_cond, &persist_lock);
+
+        if (!persist_pending)
+            break;
+
+        int merge = persist_merge;
+        pthread_mutex_unlock(&persist_lock);
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        commit_tables(1);
+
+        if (merge || wal.segment - checkpoint_segment > MAX_WAL_SEGMENTS)
+            checkpoint();
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        uint64_t ns = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL + (uint64_t)(end.tv_nsec - start.tv_nsec);
+        stat_add(&flush_stats.commit_ns, ns);
+        stat_max(&flush_stats.commit_peak_ns, ns);
+
+        pthread_mutex_lock(&persist_lock);
+        persist_pending = 0;
+    }
+    pthread_mutex_unlock(&persist_lock);
+
+    return NULL;
+}
+
+static void stop_persister(void) {
+    if (!persister_started)
+        return;
+
+    pthread_mutex_lock(&persist_lock);
+    persist_stop = 1;
+    pthread_cond_signal(&persist_cond);
+    pthread_mutex_unlock(&persist_lock);
+
+    pthread_join(persister, NULL);
+    persister_started = 0;
+}
+
+static void *reader_loop(void *arg) {
+    struct fan_group *g = (struct fan_group *)arg;
+
+    size_t size = READ_MIN_SIZE;
+    struct fanotify_event_metadata *buffer = (struct fanotify_event_metadata *)malloc(size);
+    if (!buffer) {
+        syslog(LOG_ERR, "Error: Couldnt allocate the read buffer for '%s'.", g->path);
+        return NULL;
+    }
+    stat_set(&g->read_size, size);
+    stat_max(&g->read_peak, size);
+
+    size_t capacity = size;
+    unsigned int small_reads = 0;
+    struct timespec last_wake = { 0 };
+
+    /* poll if fanotify recieves an event, or if the reader is stopped */
+    struct pollfd fds[2] = {
+        { .fd = g->fan_fd, .events = POLLIN },
+        { .fd = g->stop_fd, .events = POLLIN }
+    };
+
+    struct io_ring ring = { .fd = -1 };
+    unsigned int armed = 0;
+    if (use_io_uring && !io_ring_init(&ring, READER_RING_ENTRIES))
+        syslog(LOG_WARNING, "Couldnt set up io_uring for '%s', reading it with blocking calls.", g->path);
+
+    while (running && !atomic_load(&g->stop)) {
+        if (io_ring_ready(&ring)) {
+            int ret = ring_wait_events(g, &ring, &armed);
+            if (ret == -1) {
+                syslog(LOG_WARNING, "io_uring failed on '%s', reading it with blocking calls. -> %s", g->path, strerror(errno));
+                io_ring_free(&ring);
+            }
+
+            if (ret <= 0)
+                continue;
+        } else {
+            int ret = poll(fds, 2, -1);
+            if (ret <= 0 || !(fds[0].revents & POLLIN))
+                continue;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        /* the queue cooled down, no need to wait for small reads to shrink the buffer */
+        if (size > READ_MIN_SIZE && now.tv_sec - last_wake.tv_sec > READ_IDLE_SEC) {
+            small_reads = 0;
+            buffer = resize_read_buffer(g, buffer, &capacity, READ_MIN_SIZE);
+            size = (size_t)stat_get(&g->read_size);
+        }
+        last_wake = now;
+
+        /* lets the burst that woke us up build up, so it is drained with fewer reads */
+        if (read_delay) {
+            struct timespec delay = { .tv_sec = 0, .tv_nsec = read_delay * 1000L };
+            nanosleep(&delay, NULL);
+        }
+
+        while (running && !atomic_load_explicit(&g->stop, memory_order_relaxed)) {
+            ssize_t len = io_ring_ready(&ring) ? ring_read_events(g, &ring, &armed, buffer, size) : read(g->fan_fd, buffer, size);
+            if (len == -1 && errno != EAGAIN && errno != EINTR) {
+                syslog(LOG_ERR, "Error: Couldnt read event metadata from file descriptior '%d'. -> %s", g->fan_fd, strerror(errno));
+                break;
+            }
+
+            if (len <= 0) break;
+
+            stat_add(&g->reads, 1);
+
+            /* FAN_EVENT_NEXT consumes len */
+            size_t used = (size_t)len;
+
+            struct fanotify_event_metadata *meta;
+            for (meta = buffer; FAN_EVENT_OK(meta, len); meta = FAN_EVENT_NEXT(meta, len)) {
+                stat_add(&g->events, 1);
+                dispatch_event(g, meta);
+            }
+
+            wake_workers(g);
+
+            /* a nearly full read means more events are queued, a hot queue is drained with bigger reads */
+            if (used > size - size / 4 && size < READ_MAX_SIZE) {
+                small_reads = 0;
+                buffer = resize_read_buffer(g, buffer, &capacity, size * 2);
+                size = (size_t)stat_get(&g->read_size);
+            } else if (used < size / 8 && size > READ_MIN_SIZE) {
+                if (++small_reads < READ_SHRINK_AFTER)
+                    continue;
+
+                small_reads = 0;
+                buffer = resize_read_buffer(g, buffer, &capacity, size / 2);
+                size = (size_t)stat_get(&g->read_size);
+            } else {
+                small_reads = 0;
+            }
+        }
+    }
+
+    io_ring_free(&ring);
+    free(buffer);
+    return NULL;
+}
+
+static struct fanotify_event_metadata *resize_read_buffer(struct fan_group *g, struct fanotify_event_metadata *buffer,
+                                                          size_t *capacity, size_t size) {
+    if (size > *capacity) {
+        /* the content is not kept, every event of the buffer was already dispatched */
+        struct fanotify_event_metadata *tmp = (struct fanotify_event_metadata *)malloc(size);
+        if (!tmp)
+            return buffer;
+
+        free(buffer);
+        buffer = tmp;
+        *capacity = size;
+    }
+
+    stat_set(&g->read_size, size);
+    stat_max(&g->read_peak, size);
+
+    return buffer;
+}
+
+static int ring_wait_events(struct fan_group *g, struct io_ring *ring, unsigned int *armed) {
+    /* polls are one shot, only the one that completed is armed again */
+    if (!(*armed & READER_POLL_EVENTS)) {
+        struct io_uring_sqe *sqe = io_ring_prepare(ring, IORING_OP_POLL_ADD, g->fan_fd, READER_POLL_EVENTS);
+        if (!sqe)
+            return -1;
+
+        sqe->poll32_events = POLLIN;
+        *armed |= READER_POLL_EVENTS;
+    }
+
+    if (!(*armed & READER_POLL_STOP)) {
+        struct io_uring_sqe *sqe = io_ring_prepare(ring, IORING_OP_POLL_ADD, g->stop_fd, READER_POLL_STOP);
+        if (!sqe)
+            return -1;
+
+        sqe->poll32_events = POLLIN;
+        *armed |= READER_POLL_STOP;
+    }
+
+    if (io_ring_submit(ring, 1) == -1)
+        return -1;
+
+    int ready = 0;
+
+    struct io_uring_cqe cqe;
+    while (io_ring_reap(ring, &cqe, 0) == 1) {
+        *armed &= ~(unsigned int)cqe.user_data;
+
+        if (cqe.user_data == READER_POLL_EVENTS && cqe.res > 0)
+            ready = 1;
+    }
+
+    return ready;
+}
+
+static ssize_t ring_read_events(struct fan_group *g, struct io_ring *ring, unsigned int *armed, void *buffer, size_t size) {
+    struct io_uring_sqe *sqe = io_ring_prepare(ring, IORING_OP_READ, g->fan_fd, READER_READ);
+    if (!sqe)
+        return read(g->fan_fd, buffer, size);
+
+    sqe->addr = (uint64_t)(uintptr_t)buffer;
+    sqe->len = (uint32_t)size;
+    sqe->off = (uint64_t)-1;
+
+    if (io_ring_submit(ring, 1) == -1)
+        return -1;
+
+    struct io_uring_cqe cqe;
+    for (;;) {
+        if (io_ring_reap(ring, &cqe, 1) != 1)
+            return -1;
+
+        if (cqe.user_data == READER_READ)
+            break;
+
+        *armed &= ~(unsigned int)cqe.user_data;
+    }
+
+    if (cqe.res < 0) {
+        errno = -cqe.res;
+        return -1;
+    }
+
+    return (ssize_t)cqe.res;
+}
+
+static const struct fanotify_event_info_header *find_info(const struct fanotify_event_metadata *meta, uint8_t type) {
+    const char *info = (const char *)meta + meta->metadata_len;
+    const char *end = (const char *)meta + meta->event_len;
+
+    while (info + sizeof(struct fanotify_event_info_header) <= end) {
+        const struct fanotify_event_info_header *hdr = (const struct fanotify_event_info_header *)info;
+        if (hdr->len == 0 || info + hdr->len > end)
+            break;
+
+        if (hdr->info_type == type)
+            return hdr;
+
+        info += hdr->len;
+    }
+
+    return NULL;
+}
+
+static uint32_t hash_info(const struct fanotify_event_info_header *info) {
+    const struct fanotify_event_info_fid *fid = (const struct fanotify_event_info_fid *)info;
+    struct file_handle *handle = (struct file_handle *)fid->handle;
+
+    /* fsid, handle and name are contiguous, the padding after the name is left out */
+    const unsigned char *p = (const unsigned char *)&fid->fsid;
+    const unsigned char *end = handle->f_handle + handle->handle_bytes;
+    end += strlen((const char *)end);
+
+    /* FNV-1a */
+    uint32_t hash = 2166136261U;
+    for (; p < end; p++) {
+        hash ^= *p;
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+static void push_event(struct fan_group *g, struct worker *w, const struct fanotify_event_metadata *meta,
+                        const struct fanotify_event_info_header *info, size_t info_len, uint32_t hash) {
+    struct event_record *record = event_ring_reserve(&w->ring, info_len);
+    if (!record) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        stat_add(&g->stalls, 1);
+
+        while (!(record = event_ring_reserve(&w->ring, info_len))) {
+            eventfd_write(w->wake_fd, 1);
+            sched_yield();
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        stat_add(&g->stall_ns, (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL + (uint64_t)(end.tv_nsec - start.tv_nsec));
+    }
+
+    record->mask = (uint32_t)meta->mask;
+    record->fd = meta->fd;
+    record->pid = meta->pid;
+    record->hash = hash;
+    record->group = g->id;
+    if (info)
+        memcpy(record->info, info, info_len);
+
+    event_ring_commit(&w->ring, record);
+    g->pending |= 1ULL << (w - workers);
+}
+
+static void dispatch_event(struct fan_group *g, const struct fanotify_event_metadata *meta) {
+    /* carries no file, FAN_NOFD must not be closed */
+    if (meta->mask & FAN_Q_OVERFLOW) {
+        stat_add(&g->overflows, 1);
+
+        if (g->dirents) {
+            atomic_fetch_add_explicit(&cache_epoch, 1, memory_order_relaxed);
+            atomic_store_explicit(&deletes_lost, 1, memory_order_relaxed);
+        }
+        return;
+    }
+
+    if (!(meta->mask & (COUNT_MASK | FAN_DELETE | FAN_MOVED_FROM | FAN_RENAME))) {
+        if (meta->fd >= 0)
+            close(meta->fd);
+        return;
+    }
+
+    if (g->mode == MODE_FD) {
+        push_event(g, &workers[g->next_worker++ % worker_count], meta, NULL, 0, 0);
+        return;
+    }
+
+    const struct fanotify_event_info_header *info;
+    size_t info_len;
+
+    if (meta->mask & FAN_RENAME) {
+        /* the new name record follows the old one, both are copied */
+        info = find_info(meta, FAN_EVENT_INFO_TYPE_OLD_DFID_NAME);
+        const struct fanotify_event_info_header *new_info = find_info(meta, FAN_EVENT_INFO_TYPE_NEW_DFID_NAME);
+        if (!info || !new_info || (const char *)new_info < (const char *)info)
+            return;
+
+        info_len = (size_t)((const char *)new_info + new_info->len - (const char *)info);
+    } else {
+        info = find_info(meta, FAN_EVENT_INFO_TYPE_DFID_NAME);
+        if (!info)
+            return;
+
+        info_len = info->len;
+    }
+
+    /* the entries of a directory are spread over every worker, the hash picks the one recording it */
+    uint32_t hash = hash_info(info);
+    if ((meta->mask & (FAN_DELETE | FAN_MOVED_FROM | FAN_RENAME)) && (meta->mask & FAN_ONDIR)) {
+        for (size_t i = 0; i < worker_count; i++)
+            push_event(g, &workers[i], meta, info, info_len, hash);
+        return;
+    }
+
+    push_event(g, &workers[hash % worker_count], meta, info, info_len, hash);
+}
+
+static void wake_workers(struct fan_group *g) {
+    /* pairs with the fence in worker_loop, either the worker sees the new events or we see it sleeping */
+    atomic_thread_fence(memory_order_seq_cst);
+
+    for (size_t i = 0; i < worker_count && g->pending; i++) {
+        struct worker *w = &workers[i];
+        if (!(g->pending & (1ULL << i)))
+            continue;
+
+        g->pending &= ~(1ULL << i);
+        if (atomic_load_explicit(&w->sleeping, memory_order_relaxed))
+            eventfd_write(w->wake_fd, 1);
+    }
+}
+
+static void *worker_loop(void *arg) {
+    struct worker *w = (struct worker *)arg;
+
+    for (;;) {
+        size_t handled = 0;
+
+        if (atomic_load_explicit(&w->flush_requested, memory_order_acquire))
+            handoff_table(w);
+
+        unsigned int epoch = atomic_load_explicit(&cache_epoch, memory_order_relaxed);
+        if (epoch != w->cache_epoch) {
+            path_cache_clear(&w->dir_cache);
+            w->cache_epoch = epoch;
+        }
+
+        /* a batch takes far less than a window, one clock read covers it */
+        if (modify_window) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            w->now = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+        }
+
+        pthread_rwlock_rdlock(&blk_lock);
+
+        struct event_record *record;
+        while (handled < WORKER_BATCH && (record = event_ring_peek(&w->ring)) != NULL) {
+            handle_event(w, record);
+            event_ring_pop(&w->ring, record);
+            handled++;
+        }
+
+        pthread_rwlock_unlock(&blk_lock);
+
+        stat_add(&w->events, handled);
+        if (handled)
+            continue;
+
+        /* the readers stop before the workers, so an empty ring after they stopped stays empty */
+        if (atomic_load(&reader_done) && event_ring_empty(&w->ring))
+            break;
+
+        atomic_store_explicit(&w->sleeping, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        if (event_ring_empty(&w->ring)) {
+            struct pollfd fds = {
+                .fd = w->wake_fd,
+                .events = POLLIN
+            };
+            poll(&fds, 1, 1000);
+
+            eventfd_t value;
+            eventfd_read(w->wake_fd, &value);
+        }
+
+        atomic_store_explicit(&w->sleeping, 0, memory_order_relaxed);
+    }
+
+    return NULL;
+}
+
+static void handle_event(struct worker *w, const struct event_record *record) {
+    /* the filesystem was unmounted while the event was queued */
+    struct fan_group *g = find_group(record->group);
+    if (!g) {
+        stat_add(&w->dropped, 1);
+        close_event(record);
+        return;
+    }
+
+    if (record->mask & (FAN_DELETE | FAN_MOVED_FROM))
+        handle_dirent(w, g, record);
+
+    if (record->mask & (FAN_DELETE | FAN_MOVED_FROM | FAN_RENAME))
+        prune_entries(w, g, record);
+
+    if (!(record->mask & COUNT_MASK)) {
+        close_event(record);
+        return;
+    }
+
+    if (coalesce_event(w, g, record)) {
+        close_event(record);
+        return;
+    }
+
+    char *filepath = w->path;
+    int resolved = geteventpath(w, g, record, filepath, sizeof(w->path));
+    if (resolved != 0) {
+        if (resolved == -1)
+            stat_add(&w->dropped, 1);
+
+        close_event(record);
+        return;
+    }
+
+    if (path_in_blacklist(filepath)) {
+        stat_add(&w->blacklisted, 1);
+        learn_ignore_mark(w, g, filepath);
+
+        close_event(record);
+        return;
+    }
+
+    /* the kernel merges queued events of the same file, a single mask can hold both an open and a modification */
+    uint32_t opened = (record->mask & (FAN_OPEN | FAN_CLOSE)) ? 1U : 0U;
+    uint32_t modified = (record->mask & (FAN_MODIFY | FAN_CLOSE_WRITE)) ? 1U : 0U;
+
+    int added = additem(&w->table, filepath, opened, modified);
+    if (added && added != -1)
+        w->content_count++;
+
+    if (w->content_count >= MAX_GROUP_SIZE)
+        atomic_store_explicit(&flush_wanted, 1, memory_order_relaxed);
+
+    close_event(record);
+}
+
+static int coalesce_event(struct worker *w, struct fan_group *g, const struct event_record *record) {
+    if (record->mask != FAN_MODIFY || !modify_window)
+        return 0;
+
+    uint64_t key = BURST_KEY_SEED;
+
+    if (g->mode == MODE_FID) {
+        const struct fanotify_event_info_fid *fid = (const struct fanotify_event_info_fid *)record->info;
+        struct file_handle *handle = (struct file_handle *)fid->handle;
+
+        /* fsid, handle and name, the padding after the name is left out */
+        const unsigned char *name = handle->f_handle + handle->handle_bytes;
+        const unsigned char *end = name + strlen((const char *)name);
+        key = burst_key(key, &fid->fsid, (size_t)(end - (const unsigned char *)&fid->fsid));
+    } else {
+        struct stat st;
+        if (fstat(record->fd, &st) == -1)
+            return 0;
+
+        key = burst_key(key, &st.st_dev, sizeof(st.st_dev));
+        key = burst_key(key, &st.st_ino, sizeof(st.st_ino));
+    }
+
+    key = burst_key(key, &record->pid, sizeof(record->pid));
+    key = burst_key(key, &record->mask, sizeof(record->mask));
+
+    return burst_filter_check(&w->modify_filter, key, w->now);
+}
+
+static void clean_loop(void) {
+    /* the workers already stopped, events recorded since the last save would be lost otherwise */
+    if (workers)
+        commit_tables(0);
+
+    for (size_t i = 0; workers && i < worker_count; i++) {
+        clear_table(&workers[i].table);
+        clear_table(&workers[i].frozen);
+    }
+
+    checkpoint();
+    wal_close(&wal);
+    io_ring_free(&io_ring);
+    stop_compactor();
+    clear_blacklist();
+
+    for (size_t i = 0; i < MAX_GROUPS; i++) {
+        if (groups[i])
+            free_group(groups[i]);
+        groups[i] = NULL;
+    }
+
+    for (size_t i = 0; workers && i < worker_count; i++) {
+        path_cache_clear(&workers[i].dir_cache);
+        event_ring_free(&workers[i].ring);
+        if (workers[i].wake_fd != -1)
+            close(workers[i].wake_fd);
+    }
+    free(workers);
+
+    if (mountinfo_fd != -1)
+        close(mountinfo_fd);
+
+    pthread_rwlock_destroy(&blk_lock);
+}
+
+static void loadtable_handler(struct line_view line, void *arg) {
+    struct file_table *table = (struct file_table *)arg;
+
+    if (line.data[0] == '#')
+        return;
+
+    /* counters are cut from the end, the path keeps any ':' it holds */
+    struct line_view op_field, mod_field;
+    if (!line_view_cut(&line, ':', &mod_field) || !line_view_cut(&line, ':', &op_field))
+        return;
+
+    if (line.len == 0 || line.len >= PATH_LENGTH)
+        return;
+
+    uint64_t tmp_op, tmp_mod;
+    if (!line_view_u64(op_field, &tmp_op) || !line_view_u64(mod_field, &tmp_mod)) {
+        syslog(LOG_ERR, "Hmmm, are you modifying the files, arent you?. Non-numeric value encountered.\n");
+        return;
+    }
+
+    if (tmp_op > UINT32_MAX)
+        tmp_op = UINT32_MAX;
+    
+    if (tmp_mod > UINT32_MAX)
+        tmp_mod = UINT32_MAX;
+
+    char filename[PATH_LENGTH];
+    memcpy(filename, line.data, line.len);
+    filename[line.len] = '\0';
+
+    additem(table, filename, (uint32_t)tmp_op, (uint32_t)tmp_mod);
+}
+
+static int loadtable(const char* path, struct file_table *table) {
+    return line_reader_scan(path, loadtable_handler, table);
+}
+
+static void content_handler(struct file_table *table, struct _file *item, const char *path, size_t len, void *arg) {
+    struct table_content *content = (struct table_content *)arg;
+    (void)len;
+
+    if (content->failed || drop_entry(table, item, path, content->prune))
+        return;
+
+    uint32_t op_count = item->opening;
+    uint32_t mod_count = item->modifying;
+
+    /* the path, then both counters with their separators and the newline */
+    size_t room = 2 * INT_BUFF_SIZE + 3;
+    char *entry = line_writer_reserve(&content->writer, len + room);
+    if (!entry) {
+        content->failed = 1;
+        return;
+    }
+
+    memcpy(entry, path, len);
+    int n = snprintf(entry + len, room, ":%u:%u\n", op_count, mod_count);
+
+    line_writer_commit(&content->writer, len + (size_t)n);
+    content->count++;
+}
+
+static int drop_entry(struct file_table *table, struct _file *item, const char *path, int prune) {
+    struct stat st;
+    if (prune && stat(path, &st) == -1) {
+        delitem(table, item);
+        return 1;
+    }
+
+    /* the main thread may be replacing the blacklist while a table is committed */
+    pthread_rwlock_rdlock(&blk_lock);
+    int blacklisted = path_in_blacklist(path);
+    pthread_rwlock_unlock(&blk_lock);
+
+    if (blacklisted)
+        delitem(table, item);
+
+    return blacklisted;
+}
+
+static void log_handler(struct file_table *table, struct _file *item, const char *path, size_t len, void *arg) {
+    struct table_log *log = (struct table_log *)arg;
+
+    if (log->failed || drop_entry(table, item, path, log->prune))
+        return;
+
+    if (!wal_count(&wal, path, len, item->opening, item->modifying)) {
+        log->failed = 1;
+        return;
+    }
+
+    log->count++;
+}
+
+static size_t logtable(struct file_table *table, int prune) {
+    struct table_log log = { .prune = prune };
+
+    if (table->count == 0)
+        return 0;
+
+    walktable(table, NULL, log_handler, &log);
+    return log.count;
+}
+
+static int savetable(struct file_table *table, const char *path, int trunc, int prune) {
+    struct table_content content = { .prune = prune };
+
+    if (!line_writer_open(&content.writer, path, trunc, LINE_WRITER_SIZE))
+        return 0;
+
+    if (table->count != 0)
+        walktable(table, NULL, content_handler, &content);
+
+    return line_writer_close(&content.writer) && !content.failed;
+}
+
+static void record_collector(uint64_t seq, const char *from, const char *to, void *arg) {
+    struct record_list *list = (struct record_list *)arg;
+
+    if (list->failed)
+        return;
+
+    if (list->count == list->cap) {
+        size_t new_cap = list->cap ? list->cap * 2 : 64;
+        struct saved_record *tmp = (struct saved_record *)realloc(list->records, sizeof(struct saved_record) * new_cap);
+        if (!tmp) {
+            perror("realloc");
+            list->failed = 1;
+            return;
+        }
+
+        list->records = tmp;
+        list->cap = new_cap;
+    }
+
+    /* a rename missing its new path would be logged as a delete, dropping the counters it moves */
+    char *from_copy = strdup(from);
+    char *to_copy = to ? strdup(to) : NULL;
+    if (!from_copy || (to && !to_copy)) {
+        perror("strdup");
+        free(from_copy);
+        free(to_copy);
+        list->failed = 1;
+        return;
+    }
+
+    list->records[list->count].seq = seq;
+    list->records[list->count].from = from_copy;
+    list->records[list->count].to = to_copy;
+    list->count++;
+}
+
+static int compare_records(const void *a, const void *b) {
+    uint64_t seq_a = ((const struct saved_record *)a)->seq;
+    uint64_t seq_b = ((const struct saved_record *)b)->seq;
+
+    return (seq_a > seq_b) - (seq_a < seq_b);
+}
+
+static size_t logrecords(int frozen) {
+    struct record_list list = { 0 };
+
+    for (size_t i = 0; i < worker_count; i++) {
+        struct file_table *table = frozen ? &workers[i].frozen : &workers[i].table;
+        walkrecords(table, record_collector, &list);
+    }
+
+    if (list.failed)
+        syslog(LOG_ERR, "Couldnt collect the deletes and renames of the tables, they were not logged.");
+
+    size_t count = 0;
+    if (list.count && !list.failed) {
+        qsort(list.records, list.count, sizeof(struct saved_record), compare_records);
+
+        for (size_t i = 0; i < list.count; i++) {
+            struct saved_record *record = &list.records[i];
+            int r = record->to ? wal_move(&wal, record->from, record->to) : wal_delete(&wal, record->from);
+            if (!r)
+                break;
+
+            count++;
+        }
+    }
+
+    for (size_t i = 0; i < list.count; i++) {
+        free(list.records[i].from);
+        free(list.records[i].to);
+    }
+    free(list.records);
+
+    return count;
+}
+
+static void replay_handler(const struct wal_entry *entry, void *arg) {
+    struct run_delta *delta = (struct run_delta *)arg;
+
+    switch (entry->type) {
+        case WAL_COUNT: {
+            additem(&delta->table, entry->path, entry->opened, entry->modified);
+
+            struct activity *activity = delta->minute ? addactivity(&delta->table, entry->path) : NULL;
+            if (activity)
+                activity_add(activity, delta->minute, entry->opened, entry->modified);
+            break;
+        }
+        case WAL_DELETE:
+            delpath(&delta->table, entry->path);
+            if (!snapshot_add_op(&delta->builder, entry->path, NULL))
+                delta->failed = 1;
+            break;
+        case WAL_MOVE:
+            movepath(&delta->table, entry->path, entry->to);
+            if (!snapshot_add_op(&delta->builder, entry->path, entry->to))
+                delta->failed = 1;
+            break;
+        case WAL_TIME:
+            delta->minute = (uint32_t)(entry->time / 60);
+            break;
+    }
+}
+
+static uint64_t read_checkpoint(const char *save_path) {
+    FILE *f = fopen(save_path, "r");
+    if (!f)
+        return 0;
+
+    char line[64];
+    uint64_t segment = 0;
+
+    if (fgets(line, sizeof(line), f) && strncmp(line, CHECKPOINT_MARK, strlen(CHECKPOINT_MARK)) == 0)
+        segment = strtoull(line + strlen(CHECKPOINT_MARK), NULL, 10);
+
+    fclose(f);
+    return segment;
+}
+
+static void run_collector(struct file_table *table, struct _file *item, const char *path, size_t len, void *arg) {
+    struct run_delta *delta = (struct run_delta *)arg;
+
+    if (delta->failed || drop_entry(table, item, path, delta->prune))
+        return;
+
+    if (!snapshot_add(&delta->builder, path, len, item->opening, item->modifying, getactivity(table, item)))
+        delta->failed = 1;
+}
+
+static int add_run(struct run_delta *delta, uint64_t segment) {
+    int sync = wal_sync != WAL_SYNC_NONE;
+
+    walktable(&delta->table, NULL, run_collector, delta);
+    if (delta->failed)
+        return 0;
+
+    int empty = delta->builder.count == 0 && delta->builder.ops_count == 0;
+    char path[RUN_PATH_LENGTH];
+    uint64_t id = 0, size = 0;
+
+    if (!empty) {
+        pthread_mutex_lock(&runs_lock);
+        id = manifest.next_id++;
+        pthread_mutex_unlock(&runs_lock);
+
+        char tmp_path[RUN_PATH_LENGTH + 4];
+        run_path(RUNS_DIR_PATH, id, path);
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+        struct stat st;
+        if (!snapshot_publish(&delta->builder, path, tmp_path, segment, sync) || stat(path, &st) == -1) {
+            syslog(LOG_ERR, "Couldnt write the run '%s'.", path);
+            return 0;
+        }
+
+        size = (uint64_t)st.st_size;
+    }
+
+    pthread_mutex_lock(&runs_lock);
+
+    /* the compactor may have spliced a merge in since the id was taken */
+    struct manifest next = manifest;
+    next.segment = segment;
+    if (!empty) {
+        next.runs[next.count].id = id;
+        next.runs[next.count].size = size;
+        next.count++;
+    }
+
+    int r = manifest_save(RUNS_DIR_PATH, &next, sync);
+    if (r) {
+        manifest = next;
+        pthread_cond_signal(&compact_cond);
+    }
+
+    pthread_mutex_unlock(&runs_lock);
+
+    if (!r) {
+        syslog(LOG_ERR, "Couldnt replace the manifest of '%s'.", RUNS_DIR_PATH);
+        if (!empty)
+            unlink(path);
+        return 0;
+    }
+
+    stat_add(&compact_stats.flushed, size);
+    return 1;
+}
+
+static int checkpoint(void) {
+    /* records committed to the open segment are written too */
+    if (wal.fd != -1 && wal.size > WAL_HEADER_SIZE && !wal_rotate(&wal))
+        syslog(LOG_ERR, "Couldnt start a new segment of the write-ahead log.");
+
+    uint64_t last = (wal.fd != -1) ? wal.segment - 1 : wal.segment;
+    if (last <= checkpoint_segment)
+        return 1;
+
+    pthread_mutex_lock(&runs_lock);
+    size_t runs = manifest.count;
+    pthread_mutex_unlock(&runs_lock);
+
+    /* the segments are kept until the compactor makes room */
+    if (runs >= MAX_RUNS) {
+        syslog(LOG_WARNING, "%zu runs are waiting to be merged in '%s', the write-ahead log is kept.", runs, RUNS_DIR_PATH);
+        return 0;
+    }
+
+    /* segments written before the time records were added count at the time of the checkpoint */
+    struct run_delta delta = { .prune = atomic_load(&stat_fallback), .minute = (uint32_t)(time(NULL) / 60) };
+
+    size_t torn;
+    wal_replay(WAL_DIR_PATH, checkpoint_segment + 1, last, replay_handler, &delta, &torn);
+    if (torn)
+        syslog(LOG_WARNING, "%zu segments of the write-ahead log ended in a damaged record, their tail was skipped.", torn);
+
+    int r = !delta.failed && add_run(&delta, last);
+
+    clear_table(&delta.table);
+    snapshot_clear(&delta.builder);
+
+    if (!r)
+        return 0;
+
+    checkpoint_segment = last;
+    wal_remove(WAL_DIR_PATH, last, wal.ring);
+
+    return 1;
+}
+
+static void *compactor_loop(void *arg) {
+    (void)arg;
+
+    int sync = wal_sync != WAL_SYNC_NONE;
+
+    pthread_mutex_lock(&runs_lock);
+    while (!compactor_stop) {
+        size_t first = 0;
+        size_t count = compaction_pick(&manifest, &first);
+        if (count == 0) {
+            pthread_cond_wait(&compact_cond, &runs_lock);
+            continue;
+        }
+
+        struct run_info runs[MAX_RUNS];
+        memcpy(runs, &manifest.runs[first], sizeof(struct run_info) * count);
+        uint64_t id = manifest.next_id++;
+        int bottom = first == 0;
+
+        pthread_mutex_unlock(&runs_lock);
+
+        /* files missing from disk can only be dropped once every older counter is merged in */
+        int prune = bottom && atomic_load(&stat_fallback);
+        uint64_t size = 0;
+        int r = run_merge(RUNS_DIR_PATH, runs, count, bottom, id, compact_filter, &prune, sync, &size, &compact_stats);
+
+        pthread_mutex_lock(&runs_lock);
+
+        /* checkpoints only append runs, the ones merged are still at the same place */
+        struct manifest next = manifest;
+        next.runs[first].id = id;
+        next.runs[first].size = size;
+        memmove(&next.runs[first + 1], &next.runs[first + count], sizeof(struct run_info) * (next.count - first - count));
+        next.count -= count - 1;
+
+        if (r && !manifest_save(RUNS_DIR_PATH, &next, sync)) {
+            char path[RUN_PATH_LENGTH];
+            run_path(RUNS_DIR_PATH, id, path);
+            unlink(path);
+            r = 0;
+        }
+
+        if (!r) {
+            syslog(LOG_ERR, "Couldnt merge %zu runs in '%s', compaction waits for the next checkpoint.", count, RUNS_DIR_PATH);
+            if (!compactor_stop)
+                pthread_cond_wait(&compact_cond, &runs_lock);
+            continue;
+        }
+
+        manifest = next;
+        pthread_mutex_unlock(&runs_lock);
+
+        /* queries that mapped the merged runs keep reading them until they are done */
+        for (size_t i = 0; i < count; i++) {
+            char path[RUN_PATH_LENGTH];
+            run_path(RUNS_DIR_PATH, runs[i].id, path);
+            unlink(path);
+        }
+
+        if (bottom)
+            export_runs();
+
+        pthread_mutex_lock(&runs_lock);
+    }
+    pthread_mutex_unlock(&runs_lock);
+
+    return NULL;
+}
+
+static void stop_compactor(void) {
+    if (!compactor_started)
+        return;
+
+    pthread_mutex_lock(&runs_lock);
+    compactor_stop = 1;
+    pthread_cond_signal(&compact_cond);
+    pthread_mutex_unlock(&runs_lock);
+
+    pthread_join(compactor, NULL);
+    compactor_started = 0;
+}
+
+static int compact_filter(const char *path, void *arg) {
+    int prune = *(int *)arg;
+
+    struct stat st;
+    if (prune && stat(path, &st) == -1)
+        return 0;
+
+    pthread_rwlock_rdlock(&blk_lock);
+    int blacklisted = path_in_blacklist(path);
+    pthread_rwlock_unlock(&blk_lock);
+
+    return !blacklisted;
+}
+
+static void export_runs(void) {
+    struct file_table table = { 0 };
+
+    size_t runs;
+    if (!run_set_query(RUNS_DIR_PATH, "", &table, &runs)) {
+        clear_table(&table);
+        return;
+    }
+
+    int r = savetable(&table, SAVE_TMP_PATH, 1, 0);
+    clear_table(&table);
+
+    if (!r || rename(SAVE_TMP_PATH, SAVE_PATH) == -1) {
+        syslog(LOG_WARNING, "Couldnt export the runs to '%s'.", SAVE_PATH);
+        remove(SAVE_TMP_PATH);
+    }
+}
+
+static void blacklist_handler(char *line, void *arg) {
+    struct blacklist_updater *updater = (struct blacklist_updater *)arg;
+
+    const char *pattern;
+    int kind = path_rule_kind(line, &pattern);
+    if (kind != PATH_RULE_PREFIX) {
+        const char *error = NULL;
+        if (!path_rules_add(updater->rules, kind, pattern, &error))
+            syslog(LOG_WARNING, "Blacklist rule '%s' ignored: %s.", line, error);
+        return;
+    }
+
+    if (line[0] != '/')
+        return;
+
+    if (!path_trie_insert(updater->trie, line, PATH_TRIE_PREFIX))
+        return;
+
+    char **tmp = (char **)realloc(*(updater->blk_entries), sizeof(char *) * (updater->count + 2));
+    if (!tmp) {
+        perror("realloc");
+        return;
+    }
+
+    tmp[updater->count] = strdup(line);
+    tmp[++(updater->count)] = NULL;
+    *(updater->blk_entries) = tmp;
+}
+
+static int update_blacklist(void) {
+    char **entries = (char **)calloc(1, sizeof(char *));
+    if (!entries) {
+        perror("calloc");
+        return 0;
+    }
+
+    struct path_trie trie;
+    path_trie_init(&trie);
+
+    struct path_rules rules;
+    path_rules_init(&rules);
+
+    /* paths that must be ignored regardless the blacklist file content */
+    path_trie_insert(&trie, SAVE_PATH, PATH_TRIE_EXACT);
+    path_trie_insert(&trie, BLACKLIST_PATH, PATH_TRIE_EXACT);
+    path_trie_insert(&trie, DROPS_PATH, PATH_TRIE_EXACT);
+    path_trie_insert(&trie, SAVE_TMP_PATH, PATH_TRIE_EXACT);
+    path_trie_insert(&trie, WAL_DIR_PATH, PATH_TRIE_PREFIX);
+    path_trie_insert(&trie, RUNS_DIR_PATH, PATH_TRIE_PREFIX);
+    path_trie_insert(&trie, "/proc", PATH_TRIE_PREFIX);
+    path_trie_insert(&trie, "/dev", PATH_TRIE_PREFIX);
+    path_trie_insert(&trie, "/sys", PATH_TRIE_PREFIX);
+    path_trie_insert(&trie, "/run", PATH_TRIE_PREFIX);
+
+    struct blacklist_updater blk_updater = {
+        .blk_entries = &entries,
+        .trie = &trie,
+        .rules = &rules,
+        .count = 0UL
+    };
+
+    int r = readfile(BLACKLIST_PATH, blacklist_handler, &blk_updater);
+
+    size_t dropped = path_rules_compile(&rules);
+    if (dropped)
+        syslog(LOG_WARNING, "%zu blacklist rules ignored, their automaton exceeds %d states.", dropped, PATH_DFA_MAX_STATES);
+
+    /* the workers only wait for the swap, not for the rules to be compiled */
+    pthread_rwlock_wrlock(&blk_lock);
+
+    clear_blacklist();
+    blk_entries = entries;
+    blk_trie = trie;
+    blk_rules = rules;
+
+    int marks = 0;
+    for (size_t i = 0; i < MAX_GROUPS; i++) {
+        if (!groups[i])
+            continue;
+
+        sync_ignore_marks(groups[i]);
+        marks += atomic_load(&groups[i]->ignore_marks);
+    }
+
+    for (size_t i = 0; workers && i < worker_count; i++)
+        workers[i].last_ignored[0] = '\0';
+
+    pthread_rwlock_unlock(&blk_lock);
+
+    syslog(LOG_INFO, "Blacklist synced, %zu entries in %zu trie nodes, %zu rules in %zu automatons of %zu states, "
+        "%d kernel ignore marks installed.",
+        blk_updater.count, trie.nodes, rules.count, rules.dfa_count, rules.states, marks);
+
+    return r;
+}
+
+static int add_ignore_mark(struct fan_group *g, const char *path, unsigned int type) {
+    if (atomic_load(&g->ignore_marks) >= MAX_IGNORE_MARKS)
+        return 0;
+
+    unsigned int flags = atomic_load(&ignore_flags);
+    unsigned int mask = (flags == FAN_MARK_IGNORE_SURV) ? IGNORE_MASK | FAN_EVENT_ON_CHILD : IGNORE_MASK;
+
+    if (fanotify_mark(g->fan_fd, FAN_MARK_ADD | flags | type, mask, AT_FDCWD, path) == -1) {
+        if (errno != EINVAL || flags != FAN_MARK_IGNORE_SURV)
+            return 0;
+
+        /* FAN_MARK_IGNORE needs linux 6.0, the legacy ignored mask does not take FAN_EVENT_ON_CHILD */
+        flags = FAN_MARK_IGNORED_MASK | FAN_MARK_IGNORED_SURV_MODIFY;
+        atomic_store(&ignore_flags, flags);
 
-    return EXIT_SUCCESS;
+        if (fanotify_mark(g->fan_fd, FAN_MARK_ADD | flags | type, IGNORE_MASK, AT_FDCWD, path) == -1)
+            return 0;
+    }
+
+    atomic_fetch_add(&g->ignore_marks, 1);
+    return 1;
 }
 
-static void loop(struct _file **file_table, int fan_fd) {
-    uint16_t content_count = 0; /* counter for the items the current temporary file has stored */
+static void sync_ignore_marks(struct fan_group *g) {
+    /* without FAN_MARK_MOUNT or FAN_MARK_FILESYSTEM, only inode marks are flushed, which are all ignore marks */
+    fanotify_mark(g->fan_fd, FAN_MARK_FLUSH, 0, AT_FDCWD, NULL);
 
-    /* poll if fanotify recieves an event */
-    struct pollfd fds = {
-        .fd = fan_fd,
-        .events = POLLIN
-    };
+    unsigned int flags = atomic_load(&ignore_flags);
+    unsigned int mask = (flags == FAN_MARK_IGNORE_SURV) ? IGNORE_MASK | FAN_EVENT_ON_CHILD : IGNORE_MASK;
 
-    time_t last_save = time(NULL);
+    for (size_t i = 0; g->ignored_mounts && g->ignored_mounts[i]; i++) {
+        fanotify_mark(g->fan_fd, FAN_MARK_REMOVE | flags | FAN_MARK_MOUNT, mask, AT_FDCWD, g->ignored_mounts[i]);
+        free(g->ignored_mounts[i]);
+    }
+    free(g->ignored_mounts);
+    g->ignored_mounts = NULL;
 
-    while(running) {
-        int ret = poll(&fds, 1, 1000);
-        if (ret == -1) {
-            perror("poll");
-            continue;
-        }
+    atomic_store(&g->ignore_marks, 0);
 
-        time_t now = time(NULL);
-        if (now - last_save >= INTERVAL_SEC) {
-            char current_path[PATH_LENGTH];
+    struct stat st, parent_st;
+    if (stat(WAL_DIR_PATH, &st) == 0 && st.st_dev == g->dev)
+        add_ignore_mark(g, WAL_DIR_PATH, 0);
 
-            snprintf(current_path, sizeof(current_path), TMP_FILE_PATH, file_count);
+    if (stat(RUNS_DIR_PATH, &st) == 0 && st.st_dev == g->dev)
+        add_ignore_mark(g, RUNS_DIR_PATH, 0);
 
-            savetable(file_table, current_path);
-            last_save = now;
-        }
+    size_t mount_count = 0;
+    for (size_t i = 0; blk_entries && blk_entries[i]; i++) {
+        const char *path = blk_entries[i];
 
-        if (ret < 0 || !(fds.revents & POLLIN))
+        /* directories of other filesystems are marked by their own group */
+        if (strcmp(path, "/") == 0 || stat(path, &st) == -1 || !S_ISDIR(st.st_mode) || st.st_dev != g->dev)
             continue;
 
-        struct fanotify_event_metadata buffer[200];
-        ssize_t len;
+        char parent[PATH_LENGTH];
+        snprintf(parent, sizeof(parent), "%s/..", path);
 
-        do {
-            len = read(fan_fd, buffer, sizeof(buffer));
-            if (len <= 0) break;
+        /* a mount point can be ignored as a whole, not only its direct children */
+        if (stat(parent, &parent_st) == 0 && parent_st.st_dev != st.st_dev) {
+            char **tmp = (char **)realloc(g->ignored_mounts, sizeof(char *) * (mount_count + 2));
+            if (!tmp)
+                continue;
 
-            if (len == -1 && errno != EAGAIN) {
-                syslog(LOG_ERR, "Error: Couldnt read event metadata from file descriptior '%d'. -> %s", fan_fd, strerror(errno));
-                break;
+            /* terminated before the mark is tried, the list is walked by the next sync even if it fails */
+            tmp[mount_count] = NULL;
+            g->ignored_mounts = tmp;
+
+            /* a mount that couldnt be remembered couldnt be unmarked either */
+            char *copy = strdup(path);
+            if (!copy)
+                continue;
+
+            if (!add_ignore_mark(g, path, FAN_MARK_MOUNT)) {
+                free(copy);
+                continue;
             }
 
-            struct fanotify_event_metadata *meta;
-            for (meta = buffer; FAN_EVENT_OK(meta, len); meta = FAN_EVENT_NEXT(meta, len)) {
-                if (!(meta->mask & FAN_OPEN) && !(meta->mask & FAN_MODIFY)) {
-                    close(meta->fd);
-                    continue;
-                }
+            tmp[mount_count++] = copy;
+            tmp[mount_count] = NULL;
+            continue;
+        }
 
-                char *filepath = (char *)malloc(sizeof(char) * PATH_LENGTH);
-                if (getfilepath(meta->fd, filepath, PATH_LENGTH) == -1) {
-                    close(meta->fd);
-                    continue;
-                }
+        add_ignore_mark(g, path, 0);
+    }
+}
 
-                if (path_in_blacklist(filepath)) {
-                    close(meta->fd);
-                    continue;
-                }
+static void learn_ignore_mark(struct worker *w, struct fan_group *g, const char *path) {
+    if (atomic_load_explicit(&g->ignore_marks, memory_order_relaxed) >= MAX_IGNORE_MARKS)
+        return;
 
-                int added = (meta->mask & FAN_OPEN) ? additem(file_table, filepath, 1U, 0U) : additem(file_table, filepath, 0U, 1U);
-                if (added && added != -1)
-                    content_count++;
+    char dirpath[PATH_LENGTH];
+    const char *slash = strrchr(path, '/');
+    if (!slash || slash == path)
+        return;
 
-                free(filepath);
-                if (content_count < MAX_TMP_SIZE) {
-                    close(meta->fd);
-                    continue;
-                }
+    size_t len = (size_t)(slash - path);
+    memcpy(dirpath, path, len);
+    dirpath[len] = '\0';
 
-                char current_path[PATH_LENGTH];
-                snprintf(current_path, sizeof(current_path), TMP_FILE_PATH, file_count);
+    /* events still queued before the mark was installed */
+    if (strcmp(dirpath, w->last_ignored) == 0)
+        return;
 
-                savetable(file_table, current_path);
-                clear_table(file_table);
+    /* the whole directory must be blacklisted, not only the file, which rules can not tell */
+    if (!path_trie_match(&blk_trie, dirpath))
+        return;
 
-                content_count = 0;
+    if (add_ignore_mark(g, dirpath, 0))
+        memcpy(w->last_ignored, dirpath, len + 1);
+}
 
-                if (file_count < MAX_TMP_FILES) {
-                    file_count++;
-                } else {
-                    mergetmp(SAVE_PATH);
-                }
+static void clear_blacklist(void) {
+    path_trie_clear(&blk_trie);
+    path_rules_clear(&blk_rules);
 
-                close(meta->fd);
-            }
-        } while (len > 0);
+    if (!blk_entries) return;
+
+    for (size_t i = 0; blk_entries[i]; i++) {
+        free(blk_entries[i]);
     }
+    free(blk_entries);
+
+    blk_entries = NULL;
 }
 
-static void clean_loop(struct _file **file_table, int fan_fd) {
-    mergetmp(SAVE_PATH);
-    clear_table(file_table);
-    clear_blacklist();
-    close(fan_fd);
+static int path_in_blacklist(const char *path) {
+    return path_trie_match(&blk_trie, path) || path_rules_match(&blk_rules, path);
 }
 
-static void loadtable_handler(char *line, void *arg) {
-    struct _file **table = (struct _file **)arg;
+static void terminate(const int sig) {
+    syslog(LOG_INFO, "Signal %s recieved, stopping process.", strsignal(sig));
+    running = 0;
+}
 
-    char **splitted_line = NULL;
-    size_t count = splitstr(line, ':', &splitted_line);
-    if (splitted_line == NULL       || 
-        splitted_line[0] == NULL    || 
-        splitted_line[1] == NULL    ||
-        splitted_line[2] == NULL)
-        goto clean_splitted;
+static void updateblk(const int sig) {
+    (void)sig;
+    blacklist_requested = 1;
+} 
 
-    if (count != 3) {
-        goto clean_splitted;
-    }
+void mergeall(const int sig) {
+    (void)sig;
+    merge_requested = 1;
+}
 
-    char filename[PATH_LENGTH];
-    char op_str[INT_BUFF_SIZE];
-    char mod_str[INT_BUFF_SIZE];
+static int getfilepath(const int fd, char *buff, size_t size) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
 
-    strncpy(filename, splitted_line[0], PATH_LENGTH - 1);
-    filename[PATH_LENGTH - 1] = '\0';
-    
-    strncpy(op_str, splitted_line[1], INT_BUFF_SIZE - 1);
-    op_str[INT_BUFF_SIZE - 1] = '\0';
+    ssize_t r = readlink(path, buff, size - 1);
+    if (r == -1)
+        return -1;
 
-    strncpy(mod_str, splitted_line[2], INT_BUFF_SIZE - 1);
-    mod_str[INT_BUFF_SIZE - 1] = '\0';
+    buff[r] = '\0';
+    return 0;
+}
 
-    char *endptr;
-    long tmp_op = strtol(op_str, &endptr, 10);
-    long tmp_mod = strtol(mod_str, &endptr, 10);
+static int getdirpath(struct path_cache *cache, const struct fan_group *g, const struct fanotify_event_info_fid *fid, char *buff, size_t size) {
+    struct file_handle *handle = (struct file_handle *)fid->handle;
 
-    if (endptr == op_str || endptr == mod_str) {
-        syslog(LOG_ERR, "Hmmm, are you modifying the files, arent you?. Non-numeric value encountered.\n");
-        goto clean_splitted;
-    }
+    /* fsid and handle are contiguous in the record, together they identify the directory */
+    const void *key = &fid->fsid;
+    size_t key_len = sizeof(fid->fsid) + sizeof(struct file_handle) + handle->handle_bytes;
 
-    if (tmp_op > UINT32_MAX)
-        tmp_op = UINT32_MAX;
-    
-    if (tmp_mod > UINT32_MAX)
-        tmp_mod = UINT32_MAX;
+    const char *cached = cache ? path_cache_find(cache, key, key_len) : NULL;
+    if (cached) {
+        size_t len = strlen(cached);
+        if (len >= size)
+            return -1;
 
-    uint32_t op_count = (uint32_t)tmp_op;
-    uint32_t mod_count = (uint32_t)tmp_mod;
+        memcpy(buff, cached, len + 1);
+        return 0;
+    }
 
-    additem(table, filename, op_count, mod_count);
+    int mount_fd = g->mount_fd;
+    if (mount_fd == -1) {
+        mount_fd = open(g->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (mount_fd == -1)
+            return -1;
+    }
 
-    clean_splitted:
-        if (!splitted_line) return;
+    int dir_fd = open_by_handle_at(mount_fd, handle, O_PATH);
+    if (mount_fd != g->mount_fd)
+        close(mount_fd);
 
-        for (size_t i = 0; splitted_line[i]; i++) {
-            free(splitted_line[i]);
-        }
+    if (dir_fd == -1)
+        return -1;
 
-        free(splitted_line);
-}
+    int r = getfilepath(dir_fd, buff, size);
+    close(dir_fd);
+    if (r == -1)
+        return -1;
 
-static int loadtable(const char* path, struct _file **table) {
-    return readfile(path, loadtable_handler, table);
+    if (cache)
+        path_cache_add(cache, key, key_len, buff);
+
+    return 0;
 }
 
-static size_t get_file_content(struct _file **table, char ***out) {
-    *out = (char **)malloc(sizeof(char *));
-    if (!*out) {
-        perror("malloc");
-        *out = NULL;
-        return 0;
-    }
+static int getfidpath(struct path_cache *cache, const struct fan_group *g, const struct fanotify_event_info_header *info, char *buff, size_t size) {
+    if (!info || info->len < sizeof(struct fanotify_event_info_fid) + sizeof(struct file_handle))
+        return -1;
 
-    size_t size = 0;
+    const struct fanotify_event_info_fid *fid = (const struct fanotify_event_info_fid *)info;
+    struct file_handle *handle = (struct file_handle *)fid->handle;
+    const char *name = (const char *)(handle->f_handle + handle->handle_bytes);
 
-    struct _file *item, *tmp;
-    HASH_ITER(hh, *table, item, tmp) {
-        char *filename = item->key;
+    /* events on the marked directory itself report "." as name */
+    if (strcmp(name, ".") == 0)
+        return 1;
 
-        struct stat st;
-        if (stat(filename, &st) == -1) {
-            HASH_DEL(*table, item);
-            free(item);
-            continue;
-        }
+    if (getdirpath(cache, g, fid, buff, size) == -1)
+        return -1;
 
-        if (path_in_blacklist(filename)) {
-            HASH_DEL(*table, item);
-            free(item);
-            continue;
-        }
+    size_t dir_len = strlen(buff);
+    int n = snprintf(buff + dir_len, size - dir_len, "%s%s", (dir_len == 1) ? "" : "/", name);
+    if (n < 0 || (size_t)n >= size - dir_len)
+        return -1;
 
-        uint32_t op_count = item->opening;
-        uint32_t mod_count = item->modifying;
+    return 0;
+}
 
-        char entry[PATH_LENGTH];
-        snprintf(entry, sizeof(entry), "%s:%u:%u\n", filename, op_count, mod_count);
+static const struct fanotify_event_info_header *record_info(const struct event_record *record, uint8_t type) {
+    size_t offset = 0;
 
-        char **tmp = (char **)realloc(*out, sizeof(char *) * (size + 2));
-        if (!tmp) {
-            perror("realloc");
-        
-            for (size_t i = 0; (*out)[i]; i++) {
-                free((*out)[i]);
-            }
-            free(*out);
+    while (offset + sizeof(struct fanotify_event_info_header) <= record->info_len) {
+        const struct fanotify_event_info_header *hdr = (const struct fanotify_event_info_header *)(record->info + offset);
+        if (hdr->len == 0 || offset + hdr->len > record->info_len)
+            break;
 
-            *out = NULL;
-            return 0;
-        }
+        if (hdr->info_type == type)
+            return hdr;
 
-        tmp[size++] = strdup(entry);
-        tmp[size] = NULL;
-        *out = tmp;
+        offset += hdr->len;
     }
 
-    return size;
+    return NULL;
 }
 
-static int savetable(struct _file **table, const char *path) {
-    if (*table == NULL) {
-        return 0;
-    }
+static int geteventpath(struct worker *w, struct fan_group *g, const struct event_record *record, char *buff, size_t size) {
+    /* without directory deletes and renames, cached paths could go stale */
+    if (g->mode == MODE_FID)
+        return getfidpath(g->dirents ? &w->dir_cache : NULL, g, (const struct fanotify_event_info_header *)record->info, buff, size);
 
-    char **content;
-    size_t count = get_file_content(table, &content);
-    if (!content) {
-        return 0;
-    }
+    return getfilepath(record->fd, buff, size);
+}
 
-    if (count == 0) {
-        free(content);
-        return 0;
-    }
+static void close_event(const struct event_record *record) {
+    if (record->fd >= 0)
+        close(record->fd);
+}
 
-    int r = savefile(path, content, 1);
+static void handle_dirent(struct worker *w, struct fan_group *g, const struct event_record *record) {
+    if (g->mode != MODE_FID || !(record->mask & FAN_ONDIR))
+        return;
 
-    for (size_t i = 0; content[i]; i++) {
-        free(content[i]);
-    }
-    free(content);
+    char dirpath[PATH_LENGTH];
+    if (getfidpath(&w->dir_cache, g, (const struct fanotify_event_info_header *)record->info, dirpath, sizeof(dirpath)) != 0)
+        return;
 
-    return r;
+    if (record->mask & FAN_MOVED_FROM) {
+        path_cache_invalidate(&w->dir_cache, dirpath);
+    } else {
+        path_cache_remove(&w->dir_cache, dirpath);
+    }
 }
 
-static int mergetmp(const char *save_path) {
-    struct _file *merged_table = NULL;
+static void prune_entries(struct worker *w, struct fan_group *g, const struct event_record *record) {
+    if (g->mode != MODE_FID)
+        return;
 
-    int r = 1;
+    /* with FAN_RENAME reported, FAN_MOVED_FROM only keeps the path cache valid */
+    if ((record->mask & FAN_MOVED_FROM) && !(record->mask & (FAN_DELETE | FAN_RENAME)) && g->renames)
+        return;
 
-    uint16_t count = 0;
-    for (uint16_t i = 1; i <= file_count; i++) {
-        char realpath[PATH_LENGTH];
-        snprintf(realpath, sizeof(realpath), TMP_FILE_PATH, i);
-    
-        r &= loadtable(realpath, &merged_table);
-        remove(realpath);
-
-        count++;
-        if (count >= MAX_COUNT) {
-            r &= savetable(&merged_table, save_path);
-            clear_table(&merged_table);
-            count = 0;
-        }
+    struct path_cache *cache = g->dirents ? &w->dir_cache : NULL;
+    int owner = (record->hash % worker_count) == (size_t)(w - workers);
+
+    char *from = w->path;
+    char to[PATH_LENGTH];
+    int renamed = 0;
+
+    if (record->mask & FAN_RENAME) {
+        if (getfidpath(cache, g, record_info(record, FAN_EVENT_INFO_TYPE_OLD_DFID_NAME), from, sizeof(w->path)) != 0)
+            return;
+
+        /* a file moved into a blacklisted directory is dropped like a deleted one */
+        renamed = getfidpath(cache, g, record_info(record, FAN_EVENT_INFO_TYPE_NEW_DFID_NAME), to, sizeof(to)) == 0 &&
+                    !path_in_blacklist(to);
+    } else if (getfidpath(cache, g, (const struct fanotify_event_info_header *)record->info, from, sizeof(w->path)) != 0) {
+        return;
     }
 
-    file_count = 1;
-    
-    if (count != 0) {
-        r &= savetable(&merged_table, save_path);
-        clear_table(&merged_table);
+    if (path_in_blacklist(from))
+        return;
+
+    if (renamed) {
+        movepath(&w->table, from, to);
+    } else {
+        delpath(&w->table, from);
     }
 
-    return r;
+    if (!owner)
+        return;
+
+    uint64_t seq = atomic_fetch_add_explicit(&record_seq, 1, memory_order_relaxed);
+    if (addrecord(&w->table, seq, from, renamed ? to : NULL))
+        w->content_count++;
+
+    if (w->content_count >= MAX_GROUP_SIZE)
+        atomic_store_explicit(&flush_wanted, 1, memory_order_relaxed);
 }
 
-static void blacklist_handler(char *line, void *arg) {
-    struct blacklist_updater *updater = (struct blacklist_updater *)arg;
+static void report_drops(uint64_t overflows, uint64_t dropped) {
+    time_t now = time(NULL);
+    time_t start = interval_start;
+    interval_start = now;
 
-    char **tmp = (char **)realloc(*(updater->blk_entries), sizeof(char *) * (updater->count + 2));
-    if (!tmp) {
-        perror("malloc");
-        clear_blacklist();
+    if (!overflows && !dropped)
         return;
-    }
 
-    tmp[updater->count] = strdup(line);
-    tmp[++(updater->count)] = NULL;
-    *(updater->blk_entries) = tmp;
+    syslog(LOG_WARNING, "Events were lost in the last interval: %llu queue overflows, %llu events dropped in user space.",
+            (unsigned long long)overflows,
+            (unsigned long long)dropped);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%lld:%lld:%llu:%llu\n",
+            (long long)start,
+            (long long)now,
+            (unsigned long long)overflows,
+            (unsigned long long)dropped);
+
+    appendline(DROPS_PATH, line, 0);
 }
 
-static int update_blacklist(void) {
-    clear_blacklist();
+static void report_stats(void) {
+    uint64_t hits = 0, misses = 0, evictions = 0, invalidations = 0;
+    uint64_t ring_full = 0, high_water = 0;
+    uint64_t events = 0, stalls = 0, stall_ns = 0;
+    uint64_t new_events = 0, new_reads = 0, read_size = 0, read_peak = 0;
+    uint64_t overflows = 0, new_overflows = 0;
+    size_t group_count = 0;
+    int marks = 0;
+
+    for (size_t i = 0; i < worker_count; i++) {
+        struct worker *w = &workers[i];
+
+        hits += stat_get(&w->dir_cache.hits);
+        misses += stat_get(&w->dir_cache.misses);
+        evictions += stat_get(&w->dir_cache.evictions);
+        invalidations += stat_get(&w->dir_cache.invalidations);
+
+        ring_full += atomic_load_explicit(&w->ring.full, memory_order_relaxed);
+        if (atomic_load_explicit(&w->ring.high_water, memory_order_relaxed) > high_water)
+            high_water = atomic_load_explicit(&w->ring.high_water, memory_order_relaxed);
+    }
 
-    blk_entries = (char **)calloc(1, sizeof(char *));
-    if (!blk_entries) {
-        perror("calloc");
-        return 0;
+    for (size_t i = 0; i < MAX_GROUPS; i++) {
+        struct fan_group *g = groups[i];
+        if (!g)
+            continue;
+
+        events += stat_get(&g->events);
+        stalls += stat_get(&g->stalls);
+        stall_ns += stat_get(&g->stall_ns);
+        overflows += stat_get(&g->overflows);
+
+        /* per interval figures, groups removed since the last report are left out */
+        uint64_t group_events = stat_get(&g->events);
+        uint64_t group_reads = stat_get(&g->reads);
+        uint64_t group_overflows = stat_get(&g->overflows);
+        new_events += group_events - g->reported_events;
+        new_reads += group_reads - g->reported_reads;
+        new_overflows += group_overflows - g->reported_overflows;
+        g->reported_events = group_events;
+        g->reported_reads = group_reads;
+        g->reported_overflows = group_overflows;
+
+        if (stat_get(&g->read_size) > read_size)
+            read_size = stat_get(&g->read_size);
+
+        if (stat_get(&g->read_peak) > read_peak)
+            read_peak = stat_get(&g->read_peak);
+
+        marks += atomic_load(&g->ignore_marks);
+        group_count++;
     }
 
-    struct blacklist_updater blk_updater = {
-        .blk_entries = &blk_entries,
-        .count = 0UL
-    };
+    uint64_t blacklisted = 0, modify_raw = 0, modify_coalesced = 0, dropped = 0;
+    uint64_t handoffs = 0, handoff_ns = 0, handoff_peak = 0;
+    for (size_t i = 0; i < worker_count; i++) {
+        blacklisted += stat_get(&workers[i].blacklisted);
+        dropped += stat_get(&workers[i].dropped);
+        modify_raw += stat_get(&workers[i].modify_filter.raw);
+        modify_coalesced += stat_get(&workers[i].modify_filter.coalesced);
+
+        handoffs += stat_get(&workers[i].handoffs);
+        handoff_ns += stat_get(&workers[i].handoff_ns);
+        if (stat_get(&workers[i].handoff_peak_ns) > handoff_peak)
+            handoff_peak = stat_get(&workers[i].handoff_peak_ns);
+    }
+
+    syslog(LOG_INFO, "Blacklist: %llu events dropped in user space, %d kernel ignore marks.",
+            (unsigned long long)blacklisted,
+            marks);
+
+    syslog(LOG_INFO, "Ingest: %zu filesystems, %llu events read, %llu stalls on full rings (%llu ms waiting, %llu failed reserves), ring high water %llu/%u bytes.",
+            group_count,
+            (unsigned long long)events,
+            (unsigned long long)stalls,
+            (unsigned long long)(stall_ns / 1000000ULL),
+            (unsigned long long)ring_full,
+            (unsigned long long)high_water,
+            RING_SIZE);
+
+    report_drops(new_overflows, dropped - reported_dropped);
+    reported_dropped = dropped;
+
+    syslog(LOG_INFO, "Drops: %llu queue overflows, %llu events lost in user space since start.",
+            (unsigned long long)overflows,
+            (unsigned long long)dropped);
+
+    if (modify_raw)
+        syslog(LOG_INFO, "Coalescing: %llu FAN_MODIFY events raw, %llu recorded, %llu collapsed within a %ld ms window.",
+                (unsigned long long)modify_raw,
+                (unsigned long long)(modify_raw - modify_coalesced),
+                (unsigned long long)modify_coalesced,
+                modify_window);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double elapsed = (double)(now.tv_sec - last_report.tv_sec) + (double)(now.tv_nsec - last_report.tv_nsec) / 1e9;
+    last_report = now;
+
+    if (new_reads && elapsed > 0)
+        syslog(LOG_INFO, "Reads: %.1f events per read, %.1f reads per second, largest read buffer %llu bytes (%llu peak).",
+                (double)new_events / (double)new_reads,
+                (double)new_reads / elapsed,
+                (unsigned long long)read_size,
+                (unsigned long long)read_peak);
+
+    /* time ingestion stopped for each table swapped, against the commits running beside it */
+    uint64_t flushes = stat_get(&flush_stats.flushes);
+    if (flushes && handoffs)
+        syslog(LOG_INFO, "Flush: %llu flushes (%llu put off), workers blocked %.1f us per handoff (%.1f us peak), main thread waited %.1f ms per flush, commits took %.1f ms (%.1f ms peak).",
+                (unsigned long long)flushes,
+                (unsigned long long)stat_get(&flush_stats.deferred),
+                (double)handoff_ns / (double)handoffs / 1e3,
+                (double)handoff_peak / 1e3,
+                (double)stat_get(&flush_stats.wait_ns) / (double)flushes / 1e6,
+                (double)stat_get(&flush_stats.commit_ns) / (double)flushes / 1e6,
+                (double)stat_get(&flush_stats.commit_peak_ns) / 1e6);
+
+    pthread_mutex_lock(&runs_lock);
+    size_t runs = manifest.count;
+    pthread_mutex_unlock(&runs_lock);
+
+    uint64_t flushed = stat_get(&compact_stats.flushed);
+    uint64_t written = stat_get(&compact_stats.written);
+
+    /* bytes written to the runs for each byte flushed from the write-ahead log */
+    if (flushed)
+        syslog(LOG_INFO, "Compaction: %zu runs, %llu merges of %llu runs, %llu bytes flushed, %llu bytes read and %llu written by merges, write amplification %.2f.",
+                runs,
+                (unsigned long long)stat_get(&compact_stats.compactions),
+                (unsigned long long)stat_get(&compact_stats.merged),
+                (unsigned long long)flushed,
+                (unsigned long long)stat_get(&compact_stats.read),
+                (unsigned long long)written,
+                (double)(flushed + written) / (double)flushed);
+
+    uint64_t lookups = hits + misses;
+    if (lookups == 0)
+        return;
 
-    return readfile(BLACKLIST_PATH, blacklist_handler, &blk_updater);
+    syslog(LOG_INFO, "Path cache: %llu hits, %llu misses (%.1f%% hit rate), %llu evictions, %llu invalidations.",
+            (unsigned long long)hits,
+            (unsigned long long)misses,
+            100.0 * (double)hits / (double)lookups,
+            (unsigned long long)evictions,
+            (unsigned long long)invalidations);
 }
 
-static void clear_blacklist(void) {
-    if (!blk_entries) return;
+static int init_fanotify(struct fan_group *g, unsigned int mark_type) {
+    if (g->mode == MODE_FID && !init_group(g, mark_type, LOG_WARNING)) {
+        /* the kernel is too old or the filesystem cant encode file handles */
+        syslog(LOG_WARNING, "Couldnt watch '%s' in FID mode, falling back to fd mode.", g->path);
 
-    for (size_t i = 0; blk_entries[i]; i++) {
-        free(blk_entries[i]);
+        if (g->fan_fd != -1)
+            close(g->fan_fd);
+
+        if (g->mount_fd != -1)
+            close(g->mount_fd);
+
+        g->fan_fd = -1;
+        g->mount_fd = -1;
+        g->dirents = 0;
+        g->mode = MODE_FD;
     }
-    free(blk_entries);
 
-    blk_entries = NULL;
+    if (g->mode == MODE_FD && !init_group(g, mark_type, LOG_ERR))
+        return 0;
+
+    if (!g->dirents) {
+        stat_fallback = 1;
+        syslog(LOG_WARNING, "Deletes arent reported on '%s', saved files are checked with stat.", g->path);
+    }
+
+    syslog(LOG_INFO, "fanotify initialized on '%s' in %s mode%s%s.", g->path, (g->mode == MODE_FID) ? "FID" : "fd",
+            (count_mask == SESSION_MASK) ? ", counting sessions" : "",
+            queue_flags ? ", unlimited queue" : "");
+
+    return 1;
 }
 
-static int path_in_blacklist(const char *path) {
-    /* paths that must be ignored regardless the blacklist file content */
-    if (strcmp(path, SAVE_PATH) == 0                    || 
-            strcmp(path, BLACKLIST_PATH) == 0           ||
-            strncmp(path, TMP_FILE_PATH, 20) == 0       ||
-            strncmp(path, "/proc/", 6) == 0             ||
-            strncmp(path, "/dev/", 6) == 0              ||
-            strncmp(path, "/sys/", 6) == 0              ||
-            strncmp(path, "/run/", 6) == 0)
-        return 1;
+static int init_group(struct fan_group *g, unsigned int mark_type, int level) {
+    unsigned int flags = FAN_CLOEXEC | FAN_NONBLOCK | FAN_CLASS_NOTIF | queue_flags;
+    if (g->mode == MODE_FID)
+        flags |= FAN_FID_FLAGS;
 
-    for (size_t i = 0; blk_entries[i]; i++) {
-        if (strncmp(blk_entries[i], path, strlen(blk_entries[i])) == 0) {
-            return 1;
+    g->fan_fd = fanotify_init(flags, O_RDONLY | O_LARGEFILE);
+    if (g->fan_fd == -1) {
+        syslog(level, "Error: Couldnt initialize fanotify. -> %s", strerror(errno));
+        return 0;
+    }
+
+    /* an open descriptor keeps a filesystem busy on unmount, only the root mount keeps one */
+    if (g->mode == MODE_FID && strcmp(g->path, "/") == 0) {
+        g->mount_fd = open(g->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (g->mount_fd == -1) {
+            syslog(level, "Error: Couldnt open mount point '%s'. -> %s", g->path, strerror(errno));
+            return 0;
         }
     }
 
-    return 0;
-}
+    if (fanotify_mark(g->fan_fd,
+                        FAN_MARK_ADD | mark_type,
+                        count_mask | FAN_EVENT_ON_CHILD,
+                        AT_FDCWD,
+                        g->path) == -1) {
+        syslog(level, "Error: Couldnt mark %s to fanotify in '%s' -> %s",
+                (mark_type == FAN_MARK_FILESYSTEM) ? "filesystem" : "mount point", g->path, strerror(errno));
+        return 0;
+    }
 
-static void terminate(const int sig) {
-    syslog(LOG_INFO, "Signal %s recieved, stopping process.", strsignal(sig));
-    running = 0;
-}
+    if (g->mode != MODE_FID)
+        return 1;
 
-static void updateblk(const int sig) {
-    syslog(LOG_INFO, "Signal %s recieved. Updating blacklist...", strsignal(sig));
-    update_blacklist();
-} 
+    /* directory deletes and renames keep the path cache valid, they need a filesystem mark */
+    g->renames = fanotify_mark(g->fan_fd,
+                        FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+                        DIRENT_MASK | FAN_RENAME,
+                        AT_FDCWD,
+                        g->path) == 0;
 
-void mergeall(const int sig) {
-    syslog(LOG_INFO, "Signal %s recieved, merging content...", strsignal(sig));
-    mergetmp(SAVE_PATH);
+    /* FAN_RENAME needs linux 5.17 */
+    g->dirents = g->renames || fanotify_mark(g->fan_fd,
+                        FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+                        DIRENT_MASK,
+                        AT_FDCWD,
+                        g->path) == 0;
+
+    if (!g->dirents && cache_size)
+        syslog(LOG_WARNING, "Couldnt mark filesystem in '%s', path cache disabled for it. -> %s", g->path, strerror(errno));
+
+    return 1;
 }
 
-static int getfilepath(const int fd, char *buff, size_t size) {
-    char path[64];
-    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+static int parse_options(int argc, char *argv[]) {
+    int opt;
 
-    ssize_t r = readlink(path, buff, size - 1);
-    if (r == -1)
-        return -1;
+    char *endptr;
+    long tmp;
+
+    struct option long_ops[] = {
+        {"fd-mode", no_argument, NULL, 'f'},
+        {"cache-size", required_argument, NULL, 'c'},
+        {"workers", required_argument, NULL, 'w'},
+        {"all-filesystems", no_argument, NULL, 'a'},
+        {"read-delay", required_argument, NULL, 'd'},
+        {"modify-window", required_argument, NULL, 'm'},
+        {"unlimited-queue", no_argument, NULL, 'u'},
+        {"sessions", no_argument, NULL, 's'},
+        {"fsync", required_argument, NULL, 'y'},
+        {"io-uring", no_argument, NULL, 'i'},
+        {0, 0, 0, 0}
+    };
 
-    buff[r] = '\0';
-    return 0;
-}
+    while ((opt = getopt_long(argc, argv, "fc:w:ad:m:usy:i", long_ops, NULL)) != -1) {
+        switch (opt) {
+            case 'f': mode = MODE_FD; break;
+            case 'a': all_filesystems = 1; break;
+            case 'u': queue_flags = FAN_UNLIMITED_QUEUE; break;
+            case 's': count_mask = SESSION_MASK; break;
+            case 'i': use_io_uring = 1; break;
+            case 'c':
+                tmp = strtol(optarg, &endptr, 10);
+                if (endptr == optarg || tmp < 0) {
+                    fprintf(stderr, "Error: Non-negative numeric value excepted when using flag '--cache-size'.\n");
+                    return 0;
+                }
 
-static int init_fanotify(const char *path) {
-    int fan_fd = fanotify_init(FAN_CLOEXEC | FAN_CLASS_NOTIF, O_RDONLY | O_LARGEFILE);
-    if (fan_fd == -1) {
-        syslog(LOG_ERR, "Error: Couldnt initialize fanotify. -> %s", strerror(errno));
-        return -1;
-    }
+                cache_size = (size_t)tmp;
+                break;
+            case 'w':
+                tmp = strtol(optarg, &endptr, 10);
+                if (endptr == optarg || tmp < 1 || tmp > MAX_WORKERS) {
+                    fprintf(stderr, "Error: Value between 1 and %d excepted when using flag '--workers'.\n", MAX_WORKERS);
+                    return 0;
+                }
 
-    if (fanotify_mark(fan_fd,
-                        FAN_MARK_ADD | FAN_MARK_MOUNT,
-                        FAN_OPEN | FAN_MODIFY | FAN_EVENT_ON_CHILD,
-                        AT_FDCWD,
-                        path) == -1) {
-        syslog(LOG_ERR, "Error: Couldnt mark mount point to fanotify in '%s' -> %s", path, strerror(errno));
-        close(fan_fd);
-        return -1;
+                worker_count = (size_t)tmp;
+                break;
+            case 'd':
+                tmp = strtol(optarg, &endptr, 10);
+                if (endptr == optarg || tmp < 0 || tmp > MAX_READ_DELAY) {
+                    fprintf(stderr, "Error: Value between 0 and %ld excepted when using flag '--read-delay'.\n", MAX_READ_DELAY);
+                    return 0;
+                }
+
+                read_delay = tmp;
+                break;
+            case 'm':
+                tmp = strtol(optarg, &endptr, 10);
+                if (endptr == optarg || tmp < 0 || tmp > MAX_MODIFY_WINDOW_MS) {
+                    fprintf(stderr, "Error: Value between 0 and %d excepted when using flag '--modify-window'.\n", MAX_MODIFY_WINDOW_MS);
+                    return 0;
+                }
+
+                modify_window = tmp;
+                break;
+            case 'y':
+                if (strcmp(optarg, "commit") == 0) {
+                    wal_sync = WAL_SYNC_COMMIT;
+                } else if (strcmp(optarg, "segment") == 0) {
+                    wal_sync = WAL_SYNC_SEGMENT;
+                } else if (strcmp(optarg, "none") == 0) {
+                    wal_sync = WAL_SYNC_NONE;
+                } else {
+                    fprintf(stderr, "Error: 'commit', 'segment' or 'none' excepted when using flag '--fsync'.\n");
+                    return 0;
+                }
+                break;
+            default:
+                fprintf(stderr, "Bad flag usage, '-%c' flag recieved.\n", opt);
+                return 0;
+        }
     }
 
-    return fan_fd;
+    return 1;
 }
 
 static void setup_signals(void) {
@@ -707,7 +3497,80 @@ static void setup_files(void) {
         creat(BLACKLIST_PATH, 0644);
     }
 
-    if (stat("/tmp/file-listener", &st) == -1) {
-        mkdir("/tmp/file-listener", 0744);
+    if (stat(WAL_DIR_PATH, &st) == -1) {
+        mkdir(WAL_DIR_PATH, 0744);
+    }
+
+    if (stat(RUNS_DIR_PATH, &st) == -1) {
+        mkdir(RUNS_DIR_PATH, 0744);
+    }
+}
+
+static int setup_runs(void) {
+    int r = manifest_load(RUNS_DIR_PATH, &manifest);
+    if (r == -1) {
+        syslog(LOG_ERR, "The manifest of '%s' is damaged.", RUNS_DIR_PATH);
+        return 0;
+    }
+
+    /* first start since the runs were introduced, the permanent file becomes the oldest run */
+    if (r == 0) {
+        struct run_delta delta = { .prune = 0 };
+        loadtable(SAVE_PATH, &delta.table);
+
+        r = add_run(&delta, read_checkpoint(SAVE_PATH));
+
+        clear_table(&delta.table);
+        snapshot_clear(&delta.builder);
+
+        if (!r)
+            return 0;
+
+        remove(SNAPSHOT_PATH);
+    }
+
+    /* runs written or merged by a write that didnt complete */
+    size_t removed = manifest_clean(RUNS_DIR_PATH, &manifest);
+    if (removed)
+        syslog(LOG_WARNING, "Removed %zu files left in '%s' by a write that didnt complete.", removed, RUNS_DIR_PATH);
+
+    checkpoint_segment = manifest.segment;
+
+    if (!spawn_thread(&compactor, compactor_loop, NULL)) {
+        syslog(LOG_ERR, "Error: Couldnt start the compactor thread.");
+        return 0;
+    }
+
+    compactor_started = 1;
+    return 1;
+}
+
+static int setup_wal(void) {
+    uint64_t first, last = 0;
+    if (!wal_range(WAL_DIR_PATH, &first, &last) || last < checkpoint_segment)
+        last = checkpoint_segment;
+
+    if (!wal_open(&wal, WAL_DIR_PATH, wal_sync, last + 1))
+        return 0;
+
+    if (use_io_uring) {
+        if (io_ring_init(&io_ring, IO_RING_ENTRIES)) {
+            wal.ring = &io_ring;
+            syslog(LOG_INFO, "Writing the write-ahead log through io_uring.");
+        } else {
+            syslog(LOG_WARNING, "Couldnt set up io_uring, the write-ahead log is written with blocking calls. -> %s", strerror(errno));
+        }
+    }
+
+    if (last > checkpoint_segment) {
+        syslog(LOG_WARNING, "Replaying the write-ahead log from segment %llu to %llu, the daemon didnt stop cleanly.",
+               (unsigned long long)(checkpoint_segment + 1), (unsigned long long)last);
     }
+
+    /* also removes the segments a crash left after they were written */
+    if (!checkpoint())
+        return 0;
+
+    wal_remove(WAL_DIR_PATH, checkpoint_segment, wal.ring);
+    return 1;
 }
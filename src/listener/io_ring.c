@@ -0,0 +1,190 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/listener/io_ring.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h> /* perror */
+#include <string.h> /* memset */
+#include <errno.h> /* errno, EINTR */
+#include <unistd.h> /* syscall, close */
+#include <sys/mman.h> /* mmap, munmap, MAP_FAILED */
+#include <sys/syscall.h> /* __NR_io_uring_setup, __NR_io_uring_enter */
+#include <stdatomic.h> /* atomic_load_explicit, atomic_store_explicit */
+#include "io_ring.h"
+
+/* the indexes are shared with the kernel, which reads and writes them concurrently */
+#define LOAD_ACQUIRE(p) atomic_load_explicit((_Atomic unsigned *)(p), memory_order_acquire)
+#define STORE_RELEASE(p, v) atomic_store_explicit((_Atomic unsigned *)(p), (v), memory_order_release)
+
+static void unmap_ring(struct io_ring *ring) {
+    if (ring->sqes && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_size);
+
+    if (ring->cq_map && ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_map_size);
+
+    if (ring->sq_map && ring->sq_map != MAP_FAILED)
+        munmap(ring->sq_map, ring->sq_map_size);
+}
+
+int io_ring_init(struct io_ring *ring, unsigned entries) {
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd == -1)
+        return 0;
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    /* both rings share a single mapping since linux 5.4 */
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_size > ring->sq_map_size)
+            ring->sq_map_size = ring->cq_map_size;
+        ring->cq_map_size = ring->sq_map_size;
+    }
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED)
+        goto failed;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_map = ring->sq_map;
+    } else {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED)
+            goto failed;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+        goto failed;
+
+    unsigned char *sq = (unsigned char *)ring->sq_map;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+
+    unsigned char *cq = (unsigned char *)ring->cq_map;
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    ring->entries = params.sq_entries;
+    ring->fd = fd;
+
+    return 1;
+
+    failed:
+        perror("mmap");
+        unmap_ring(ring);
+        close(fd);
+        memset(ring, 0, sizeof(*ring));
+        ring->fd = -1;
+        return 0;
+}
+
+void io_ring_free(struct io_ring *ring) {
+    if (ring->fd == -1)
+        return;
+
+    unmap_ring(ring);
+    close(ring->fd);
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+int io_ring_ready(const struct io_ring *ring) {
+    return ring && ring->fd != -1;
+}
+
+struct io_uring_sqe *io_ring_prepare(struct io_ring *ring, uint8_t opcode, int fd, uint64_t user_data) {
+    unsigned head = LOAD_ACQUIRE(ring->sq_head);
+    unsigned tail = *ring->sq_tail + ring->queued;
+
+    if (tail - head >= ring->entries)
+        return NULL;
+
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->user_data = user_data;
+
+    ring->sq_array[index] = index;
+    ring->queued++;
+
+    return sqe;
+}
+
+int io_ring_submit(struct io_ring *ring, unsigned wait) {
+    /* the requests must be visible to the kernel before the tail that publishes them */
+    if (ring->queued) {
+        STORE_RELEASE(ring->sq_tail, *ring->sq_tail + ring->queued);
+        ring->queued = 0;
+    }
+
+    for (;;) {
+        /* requests left behind by a submit that failed are handed over again */
+        unsigned pending = *ring->sq_tail - LOAD_ACQUIRE(ring->sq_head);
+
+        int submitted = (int)syscall(__NR_io_uring_enter, ring->fd, pending, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (submitted >= 0) {
+            ring->inflight += (unsigned)submitted;
+            return submitted;
+        }
+
+        if (errno != EINTR)
+            return -1;
+    }
+}
+
+int io_ring_reap(struct io_ring *ring, struct io_uring_cqe *cqe, int wait) {
+    for (;;) {
+        unsigned head = *ring->cq_head;
+
+        if (head != LOAD_ACQUIRE(ring->cq_tail)) {
+            *cqe = ring->cqes[head & *ring->cq_mask];
+            STORE_RELEASE(ring->cq_head, head + 1);
+
+            if (ring->inflight)
+                ring->inflight--;
+            return 1;
+        }
+
+        if (!wait)
+            return 0;
+
+        if (io_ring_submit(ring, 1) == -1)
+            return -1;
+    }
+}
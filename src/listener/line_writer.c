@@ -0,0 +1,111 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/listener/line_writer.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <errno.h> /* errno, EINTR */
+#include <fcntl.h> /* open, O_WRONLY, O_CREAT, O_TRUNC, O_APPEND, O_CLOEXEC */
+#include <stdio.h> /* perror */
+#include <stdlib.h> /* malloc, free */
+#include <unistd.h> /* write, close, ssize_t */
+#include "line_writer.h"
+
+/**
+ * @brief writes the buffer out and empties it
+ * 
+ * @param writer writer struct
+ * @return 1 if successful, 0 if failed
+ */
+static int flush_buffer(struct line_writer *writer);
+
+int line_writer_open(struct line_writer *writer, const char *path, int trunc, size_t size) {
+    writer->used = 0;
+    writer->failed = 0;
+    writer->size = size;
+
+    writer->buffer = (char *)malloc(size);
+    if (!writer->buffer) {
+        perror("malloc");
+        return 0;
+    }
+
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC | (trunc ? O_TRUNC : O_APPEND), 0644);
+    if (writer->fd == -1) {
+        perror("open");
+        free(writer->buffer);
+        writer->buffer = NULL;
+        return 0;
+    }
+
+    return 1;
+}
+
+char *line_writer_reserve(struct line_writer *writer, size_t len) {
+    if (writer->failed || len > writer->size)
+        return NULL;
+
+    if (writer->size - writer->used < len && !flush_buffer(writer))
+        return NULL;
+
+    return writer->buffer + writer->used;
+}
+
+void line_writer_commit(struct line_writer *writer, size_t len) {
+    writer->used += len;
+}
+
+int line_writer_close(struct line_writer *writer) {
+    int r = flush_buffer(writer);
+
+    if (close(writer->fd) == -1) {
+        perror("close");
+        r = 0;
+    }
+
+    free(writer->buffer);
+    writer->buffer = NULL;
+    writer->fd = -1;
+
+    return r;
+}
+
+static int flush_buffer(struct line_writer *writer) {
+    if (writer->failed)
+        return 0;
+
+    size_t done = 0;
+    while (done < writer->used) {
+        ssize_t n = write(writer->fd, writer->buffer + done, writer->used - done);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+
+            perror("write");
+            writer->failed = 1;
+            return 0;
+        }
+
+        done += (size_t)n;
+    }
+
+    writer->used = 0;
+    return 1;
+}
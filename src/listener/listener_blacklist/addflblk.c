@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <signal.h> /* kill, SIGUSR2 */
 #include "fileutils.h" /* readfile, savefile, appendline */
 #include "procutils.h" /* getpid_by_name */
+#include "path_rules.h" /* path_rule_check, PATH_RULE_PREFIX, PATH_RULE_GLOB, PATH_RULE_REGEX, PATH_RULE_GLOB_TAG, PATH_RULE_REGEX_TAG */
 
 #define BLACKLIST_PATH "/var/log/file-listener/file-listener.blacklist" /* file path for the blacklist file */
 
@@ -122,6 +123,8 @@ int main(int argc, char *argv[]) {
 
     struct option long_ops[] = {
         {"remove", no_argument, NULL, 'r'},
+        {"glob", no_argument, NULL, 'g'},
+        {"regex", no_argument, NULL, 'x'},
         {"verbose", no_argument, NULL, 'v'},
         {"help", no_argument, NULL, 'h'},
         {0, 0, 0, 0}
@@ -130,10 +133,13 @@ int main(int argc, char *argv[]) {
     int remove = 0;
     int verbose = 0;
     int help = 0;
+    int kind = PATH_RULE_PREFIX;
 
-    while((opt = getopt_long(argc, argv, "rvh", long_ops, NULL)) != -1) {
+    while((opt = getopt_long(argc, argv, "rgxvh", long_ops, NULL)) != -1) {
         switch (opt) {
             case 'r': remove = 1; break;
+            case 'g': kind = PATH_RULE_GLOB; break;
+            case 'x': kind = PATH_RULE_REGEX; break;
             case 'v': verbose = 1; break;
             case 'h': help = 1; break;
             default:
@@ -148,21 +154,39 @@ int main(int argc, char *argv[]) {
     }
 
     if (optind >= argc) {
-        fprintf(stderr, "Directory path expected.\n");
+        fprintf(stderr, (kind == PATH_RULE_PREFIX) ? "Directory path expected.\n" : "Pattern expected.\n");
         return EXIT_FAILURE;
     }
 
     char *dirpath = argv[optind];
 
-    struct stat st_buf;
-    if (lstat(dirpath, &st_buf) != 0) {
-        fprintf(stderr, "Couldnt read state of the file or directory '%s'. -> %s\n", dirpath, strerror(errno));
-        return EXIT_FAILURE;
-    }
+    /* rules are stored with the tag of their kind, they are compared to the blacklist lines as a whole */
+    char rule[PATH_LENGTH];
+    if (kind != PATH_RULE_PREFIX) {
+        const char *error = NULL;
+        if (!remove && !path_rule_check(kind, dirpath, &error)) {
+            fprintf(stderr, "Invalid pattern '%s'. -> %s\n", dirpath, error);
+            return EXIT_FAILURE;
+        }
 
-    if (!S_ISDIR(st_buf.st_mode)) {
-        fprintf(stderr, "Directory path expected. Please insert a directory path to continue.\n");
-        return EXIT_FAILURE;
+        const char *tag = (kind == PATH_RULE_GLOB) ? PATH_RULE_GLOB_TAG : PATH_RULE_REGEX_TAG;
+        if (snprintf(rule, sizeof(rule), "%s%s", tag, dirpath) >= (int)sizeof(rule)) {
+            fprintf(stderr, "Pattern '%s' is too long.\n", dirpath);
+            return EXIT_FAILURE;
+        }
+
+        dirpath = rule;
+    } else {
+        struct stat st_buf;
+        if (lstat(dirpath, &st_buf) != 0) {
+            fprintf(stderr, "Couldnt read state of the file or directory '%s'. -> %s\n", dirpath, strerror(errno));
+            return EXIT_FAILURE;
+        }
+
+        if (!S_ISDIR(st_buf.st_mode)) {
+            fprintf(stderr, "Directory path expected. Please insert a directory path to continue.\n");
+            return EXIT_FAILURE;
+        }
     }
 
     char **list = NULL;
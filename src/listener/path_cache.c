@@ -0,0 +1,227 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/listener/path_cache.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h> /* perror */
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcpy, memset, strlen, strncmp */
+#include "path_cache.h"
+
+/* returns the size class fitting size bytes, -1 if none does */
+static int size_class(size_t size) {
+    size_t class_size = PATH_CACHE_MIN_ENTRY;
+    for (int i = 0; i < PATH_CACHE_CLASSES; i++, class_size <<= 1) {
+        if (size <= class_size)
+            return i;
+    }
+
+    return -1;
+}
+
+/* takes a dropped entry of the size class fitting size bytes, or allocates a new one */
+static struct path_cache_entry *alloc_entry(struct path_cache *cache, size_t size) {
+    int class = size_class(size);
+    if (class != -1 && cache->spare[class]) {
+        struct path_cache_entry *entry = cache->spare[class];
+        cache->spare[class] = entry->next_spare;
+        cache->spare_count[class]--;
+        return entry;
+    }
+
+    size_t alloc_size = (class == -1) ? size : (size_t)PATH_CACHE_MIN_ENTRY << class;
+    struct path_cache_entry *entry = (struct path_cache_entry *)malloc(alloc_size);
+    if (!entry) {
+        perror("malloc");
+        return NULL;
+    }
+
+    entry->size_class = class;
+    return entry;
+}
+
+/* appends an entry to the lru list, as the most recently used */
+static void lru_link(struct path_cache *cache, struct path_cache_entry *entry) {
+    entry->lru_prev = cache->lru_last;
+    entry->lru_next = NULL;
+
+    if (cache->lru_last) {
+        cache->lru_last->lru_next = entry;
+    } else {
+        cache->lru_first = entry;
+    }
+    cache->lru_last = entry;
+}
+
+/* removes an entry from the lru list */
+static void lru_unlink(struct path_cache *cache, struct path_cache_entry *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_first = entry->lru_next;
+    }
+
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_last = entry->lru_prev;
+    }
+}
+
+/* removes an entry from both hashes and keeps it for reuse, or frees it */
+static void drop_entry(struct path_cache *cache, struct path_cache_entry *entry) {
+    lru_unlink(cache, entry);
+    HASH_DELETE(hh, cache->by_key, entry);
+    HASH_DELETE(hh_path, cache->by_path, entry);
+
+    int class = entry->size_class;
+    if (class == -1 || cache->spare_count[class] >= PATH_CACHE_MAX_SPARE) {
+        free(entry);
+        return;
+    }
+
+    entry->next_spare = cache->spare[class];
+    cache->spare[class] = entry;
+    cache->spare_count[class]++;
+}
+
+void path_cache_init(struct path_cache *cache, size_t max_entries) {
+    memset(cache, 0, sizeof(*cache));
+    cache->max_entries = max_entries;
+}
+
+const char *path_cache_find(struct path_cache *cache, const void *key, size_t key_len) {
+    if (cache->max_entries == 0) {
+        return NULL;
+    }
+
+    struct path_cache_entry *entry = NULL;
+    HASH_FIND(hh, cache->by_key, key, key_len, entry);
+    if (!entry) {
+        stat_add(&cache->misses, 1);
+        return NULL;
+    }
+
+    /* relinking leaves the hashes alone, removing the only entry of a hash would free its buckets */
+    if (entry != cache->lru_last) {
+        lru_unlink(cache, entry);
+        lru_link(cache, entry);
+    }
+
+    stat_add(&cache->hits, 1);
+    return entry->path;
+}
+
+int path_cache_add(struct path_cache *cache, const void *key, size_t key_len, const char *path) {
+    if (cache->max_entries == 0) {
+        return 0;
+    }
+
+    struct path_cache_entry *entry = NULL;
+    HASH_FIND(hh, cache->by_key, key, key_len, entry);
+    if (entry) {
+        return 0;
+    }
+
+    /* a path can only be cached once, a stale handle may still point to it */
+    size_t path_len = strlen(path);
+    HASH_FIND(hh_path, cache->by_path, path, path_len, entry);
+    if (entry) {
+        drop_entry(cache, entry);
+    }
+
+    if (HASH_CNT(hh, cache->by_key) >= cache->max_entries) {
+        drop_entry(cache, cache->lru_first);
+        stat_add(&cache->evictions, 1);
+    }
+
+    entry = alloc_entry(cache, sizeof(struct path_cache_entry) + key_len + path_len + 1);
+    if (!entry) {
+        return -1;
+    }
+
+    unsigned char *data = (unsigned char *)(entry + 1);
+    memcpy(data, key, key_len);
+    memcpy(data + key_len, path, path_len + 1);
+
+    entry->key = data;
+    entry->key_len = key_len;
+    entry->path = (char *)(data + key_len);
+
+    HASH_ADD_KEYPTR(hh, cache->by_key, entry->key, entry->key_len, entry);
+    HASH_ADD_KEYPTR(hh_path, cache->by_path, entry->path, path_len, entry);
+    lru_link(cache, entry);
+
+    return 1;
+}
+
+int path_cache_remove(struct path_cache *cache, const char *path) {
+    struct path_cache_entry *entry = NULL;
+    HASH_FIND(hh_path, cache->by_path, path, strlen(path), entry);
+    if (!entry) {
+        return 0;
+    }
+
+    drop_entry(cache, entry);
+    stat_add(&cache->invalidations, 1);
+    return 1;
+}
+
+size_t path_cache_invalidate(struct path_cache *cache, const char *path) {
+    size_t path_len = strlen(path);
+    size_t count = 0;
+
+    struct path_cache_entry *entry, *tmp;
+    HASH_ITER(hh, cache->by_key, entry, tmp) {
+        if (strncmp(entry->path, path, path_len) != 0)
+            continue;
+
+        if (entry->path[path_len] != '\0' && entry->path[path_len] != '/')
+            continue;
+
+        drop_entry(cache, entry);
+        count++;
+    }
+
+    stat_add(&cache->invalidations, count);
+    return count;
+}
+
+void path_cache_clear(struct path_cache *cache) {
+    struct path_cache_entry *entry, *tmp;
+
+    HASH_ITER(hh, cache->by_key, entry, tmp) {
+        drop_entry(cache, entry);
+    }
+    cache->by_key = NULL;
+    cache->by_path = NULL;
+    cache->lru_first = NULL;
+    cache->lru_last = NULL;
+
+    for (int i = 0; i < PATH_CACHE_CLASSES; i++) {
+        while (cache->spare[i]) {
+            entry = cache->spare[i];
+            cache->spare[i] = entry->next_spare;
+            free(entry);
+        }
+        cache->spare_count[i] = 0;
+    }
+}
@@ -0,0 +1,917 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/listener/path_rules.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h> /* perror */
+#include <stdlib.h> /* malloc, realloc, calloc, free */
+#include <string.h> /* memcpy, memset, strlen, strncmp, strdup */
+#include "uthash.h" /* HASH_FIND, HASH_ADD_KEYPTR, HASH_ITER, HASH_DEL */
+#include "path_rules.h"
+
+#define MAX_GROUP_DEPTH 64 /* max nested groups of a regular expression */
+
+#define STATE_ACCEPT 1 /* flag of a dfa state holding NFA_ACCEPT */
+#define STATE_STICKY 2 /* flag of an accepting dfa state looping on itself for every byte */
+
+/* kinds of nfa states */
+enum nfa_type {
+    NFA_EPS, /* jumps to out without reading */
+    NFA_SPLIT, /* jumps to out and out1 without reading */
+    NFA_SET, /* reads one byte of set and moves to out */
+    NFA_ACCEPT /* a rule matched */
+};
+
+/* state of a thompson nfa */
+struct nfa_state {
+    uint8_t type; /* nfa_type of the state */
+    int out; /* next state, -1 if not linked yet */
+    int out1; /* second next state of a split */
+    uint32_t set; /* index of the byte set of a NFA_SET state */
+    uint8_t tail; /* NFA_SET state reading any byte, from which every suffix reaches NFA_ACCEPT */
+};
+
+/* nfa of a set of rules, states are referenced by index as the array grows */
+struct nfa {
+    struct nfa_state *states; /* every state */
+    size_t count; /* count of states */
+    size_t cap; /* allocated states */
+    uint8_t (*sets)[32]; /* byte sets, one bit per byte */
+    size_t set_count; /* count of sets */
+    size_t set_cap; /* allocated sets */
+    int tail; /* lowest tail state, every set holding a tail state is replaced by { NFA_ACCEPT, tail } */
+    const char *error; /* first error found, NULL if none */
+};
+
+/* piece of nfa with one entry and one NFA_EPS exit, not linked yet */
+struct frag {
+    int start; /* entry state */
+    int end; /* exit state */
+};
+
+/* recursive descent parser of a regular expression */
+struct regex_parser {
+    struct nfa *nfa; /* nfa the states are added to */
+    const char *p; /* next byte to parse */
+    const char *end; /* end of the pattern, before a '$' anchor */
+    int depth; /* current group depth */
+};
+
+/* set of nfa states reached by the dfa, hashed by its sorted states */
+struct dfa_key {
+    uint32_t id; /* dfa state */
+    size_t len; /* count of nfa states */
+    UT_hash_handle hh; /* hashable by states */
+    int states[]; /* sorted nfa states, only NFA_SET and NFA_ACCEPT ones */
+};
+
+static struct frag parse_alt(struct regex_parser *rp);
+
+static int in_set(const uint8_t *set, unsigned char c) {
+    return (set[c >> 3] >> (c & 7)) & 1;
+}
+
+static void set_byte(uint8_t *set, unsigned char c) {
+    set[c >> 3] |= (uint8_t)(1 << (c & 7));
+}
+
+static int add_state(struct nfa *nfa, uint8_t type, int out, int out1, uint32_t set) {
+    if (nfa->error)
+        return -1;
+
+    if (nfa->count == nfa->cap) {
+        size_t cap = nfa->cap ? nfa->cap * 2 : 64;
+        struct nfa_state *tmp = (struct nfa_state *)realloc(nfa->states, sizeof(*tmp) * cap);
+        if (!tmp) {
+            perror("realloc");
+            nfa->error = "out of memory";
+            return -1;
+        }
+
+        nfa->states = tmp;
+        nfa->cap = cap;
+    }
+
+    nfa->states[nfa->count] = (struct nfa_state){ .type = type, .out = out, .out1 = out1, .set = set, .tail = 0 };
+    return (int)nfa->count++;
+}
+
+static struct frag frag_set(struct nfa *nfa, const uint8_t *set) {
+    struct frag f = { -1, -1 };
+    if (nfa->error)
+        return f;
+
+    if (nfa->set_count == nfa->set_cap) {
+        size_t cap = nfa->set_cap ? nfa->set_cap * 2 : 64;
+        uint8_t (*tmp)[32] = realloc(nfa->sets, sizeof(*tmp) * cap);
+        if (!tmp) {
+            perror("realloc");
+            nfa->error = "out of memory";
+            return f;
+        }
+
+        nfa->sets = tmp;
+        nfa->set_cap = cap;
+    }
+
+    memcpy(nfa->sets[nfa->set_count], set, 32);
+
+    f.end = add_state(nfa, NFA_EPS, -1, -1, 0);
+    f.start = add_state(nfa, NFA_SET, f.end, -1, (uint32_t)nfa->set_count++);
+    return f;
+}
+
+static struct frag frag_byte(struct nfa *nfa, unsigned char c) {
+    uint8_t set[32] = { 0 };
+    set_byte(set, c);
+    return frag_set(nfa, set);
+}
+
+static struct frag frag_any(struct nfa *nfa) {
+    uint8_t set[32];
+    memset(set, 0xff, sizeof(set));
+    return frag_set(nfa, set);
+}
+
+static struct frag frag_empty(struct nfa *nfa) {
+    int e = add_state(nfa, NFA_EPS, -1, -1, 0);
+    return (struct frag){ e, e };
+}
+
+static struct frag frag_concat(struct nfa *nfa, struct frag a, struct frag b) {
+    if (nfa->error)
+        return a;
+
+    nfa->states[a.end].out = b.start;
+    return (struct frag){ a.start, b.end };
+}
+
+static struct frag frag_alt(struct nfa *nfa, struct frag a, struct frag b) {
+    int e = add_state(nfa, NFA_EPS, -1, -1, 0);
+    int s = add_state(nfa, NFA_SPLIT, a.start, b.start, 0);
+    if (nfa->error)
+        return a;
+
+    nfa->states[a.end].out = e;
+    nfa->states[b.end].out = e;
+    return (struct frag){ s, e };
+}
+
+/* op is '*', '+' or '?' */
+static struct frag frag_repeat(struct nfa *nfa, struct frag a, char op) {
+    int e = add_state(nfa, NFA_EPS, -1, -1, 0);
+    int s = add_state(nfa, NFA_SPLIT, a.start, e, 0);
+    if (nfa->error)
+        return a;
+
+    nfa->states[a.end].out = (op == '?') ? e : s;
+    return (struct frag){ (op == '+') ? a.start : s, e };
+}
+
+/* parses a bracket expression, p points after the '[' and is left after the ']' */
+static int parse_class(struct nfa *nfa, const char **p, const char *end, int glob, uint8_t *set) {
+    const char *c = *p;
+    int negate = 0;
+    if (c < end && (*c == '^' || (glob && *c == '!'))) {
+        negate = 1;
+        c++;
+    }
+
+    memset(set, 0, 32);
+    int first = 1;
+    while (c < end && (*c != ']' || first)) {
+        if (c[0] == '[' && c + 1 < end && (c[1] == ':' || c[1] == '=' || c[1] == '.')) {
+            nfa->error = "named character classes are not supported";
+            return 0;
+        }
+
+        unsigned char lo = (unsigned char)*c++;
+        if (lo == '\\' && c < end)
+            lo = (unsigned char)*c++;
+
+        unsigned char hi = lo;
+        if (c + 1 < end && c[0] == '-' && c[1] != ']') {
+            c++;
+            hi = (unsigned char)*c++;
+            if (hi == '\\' && c < end)
+                hi = (unsigned char)*c++;
+
+            if (hi < lo) {
+                nfa->error = "invalid range in character class";
+                return 0;
+            }
+        }
+
+        for (unsigned int b = lo; b <= hi; b++)
+            set_byte(set, (unsigned char)b);
+
+        first = 0;
+    }
+
+    if (c >= end) {
+        nfa->error = "unterminated character class";
+        return 0;
+    }
+
+    if (negate) {
+        for (size_t i = 0; i < 32; i++)
+            set[i] = (uint8_t)~set[i];
+    }
+
+    *p = c + 1;
+    return 1;
+}
+
+/* a leading '*' is left to build_nfa, which shares one loop between every floating rule */
+static struct frag parse_glob(struct nfa *nfa, const char *pattern, int *floating) {
+    const char *p = pattern;
+    const char *end = pattern + strlen(pattern);
+
+    *floating = (*p == '*');
+    while (p < end && *p == '*')
+        p++;
+
+    struct frag f = frag_empty(nfa);
+    while (p < end && !nfa->error) {
+        struct frag atom;
+        uint8_t set[32];
+
+        switch (*p) {
+            case '*':
+                while (p < end && *p == '*')
+                    p++;
+                atom = frag_repeat(nfa, frag_any(nfa), '*');
+                break;
+            case '?':
+                p++;
+                atom = frag_any(nfa);
+                break;
+            case '[':
+                p++;
+                if (!parse_class(nfa, &p, end, 1, set))
+                    return f;
+                atom = frag_set(nfa, set);
+                break;
+            case '\\':
+                if (++p >= end) {
+                    nfa->error = "trailing backslash";
+                    return f;
+                }
+                atom = frag_byte(nfa, (unsigned char)*p++);
+                break;
+            default:
+                atom = frag_byte(nfa, (unsigned char)*p++);
+        }
+
+        f = frag_concat(nfa, f, atom);
+    }
+
+    return f;
+}
+
+static struct frag parse_atom(struct regex_parser *rp) {
+    struct nfa *nfa = rp->nfa;
+    struct frag f = { -1, -1 };
+    uint8_t set[32];
+
+    switch (*rp->p) {
+        case '(':
+            if (++rp->depth > MAX_GROUP_DEPTH) {
+                nfa->error = "too many nested groups";
+                return f;
+            }
+
+            rp->p++;
+            f = parse_alt(rp);
+            if (rp->p >= rp->end || *rp->p != ')') {
+                if (!nfa->error)
+                    nfa->error = "unbalanced parenthesis";
+                return f;
+            }
+
+            rp->p++;
+            rp->depth--;
+            return f;
+        case '*':
+        case '+':
+        case '?':
+            nfa->error = "repetition without an operand";
+            return f;
+        case '{':
+            nfa->error = "bounded repetition is not supported";
+            return f;
+        case '^':
+        case '$':
+            nfa->error = "anchors are only supported at the ends of the pattern";
+            return f;
+        case '.':
+            rp->p++;
+            return frag_any(nfa);
+        case '[':
+            rp->p++;
+            if (!parse_class(nfa, &rp->p, rp->end, 0, set))
+                return f;
+            return frag_set(nfa, set);
+        case '\\':
+            if (++rp->p >= rp->end) {
+                nfa->error = "trailing backslash";
+                return f;
+            }
+            return frag_byte(nfa, (unsigned char)*rp->p++);
+        default:
+            return frag_byte(nfa, (unsigned char)*rp->p++);
+    }
+}
+
+static struct frag parse_repeat(struct regex_parser *rp) {
+    struct frag f = parse_atom(rp);
+
+    while (!rp->nfa->error && rp->p < rp->end && (*rp->p == '*' || *rp->p == '+' || *rp->p == '?'))
+        f = frag_repeat(rp->nfa, f, *rp->p++);
+
+    return f;
+}
+
+static struct frag parse_concat(struct regex_parser *rp) {
+    struct frag f = frag_empty(rp->nfa);
+
+    while (!rp->nfa->error && rp->p < rp->end && *rp->p != '|' && *rp->p != ')')
+        f = frag_concat(rp->nfa, f, parse_repeat(rp));
+
+    return f;
+}
+
+static struct frag parse_alt(struct regex_parser *rp) {
+    struct frag f = parse_concat(rp);
+
+    while (!rp->nfa->error && rp->p < rp->end && *rp->p == '|') {
+        rp->p++;
+        f = frag_alt(rp->nfa, f, parse_concat(rp));
+    }
+
+    return f;
+}
+
+/* an unanchored start is left to build_nfa, which shares one loop between every floating rule */
+static struct frag parse_regex(struct nfa *nfa, const char *pattern, int *floating) {
+    size_t len = strlen(pattern);
+    struct regex_parser rp = { .nfa = nfa, .p = pattern, .end = pattern + len, .depth = 0 };
+
+    int anchored_start = (*rp.p == '^');
+    if (anchored_start)
+        rp.p++;
+
+    /* a '$' preceded by an odd count of backslashes is escaped */
+    int anchored_end = 0;
+    if (rp.end > rp.p && rp.end[-1] == '$') {
+        size_t slashes = 0;
+        while (rp.end - 1 - slashes > rp.p && rp.end[-2 - (long)slashes] == '\\')
+            slashes++;
+
+        anchored_end = (slashes % 2 == 0);
+        if (anchored_end)
+            rp.end--;
+    }
+
+    struct frag f = parse_alt(&rp);
+    if (!nfa->error && rp.p < rp.end)
+        nfa->error = "unbalanced parenthesis";
+
+    *floating = !anchored_start;
+
+    if (!anchored_end)
+        f = frag_concat(nfa, f, frag_repeat(nfa, frag_any(nfa), '*'));
+
+    return f;
+}
+
+static struct frag parse_rule(struct nfa *nfa, int kind, const char *pattern, int *floating) {
+    if (*pattern == '\0') {
+        nfa->error = "empty pattern";
+        return (struct frag){ -1, -1 };
+    }
+
+    if (kind == PATH_RULE_GLOB)
+        return parse_glob(nfa, pattern, floating);
+
+    if (kind == PATH_RULE_REGEX)
+        return parse_regex(nfa, pattern, floating);
+
+    nfa->error = "unknown rule kind";
+    return (struct frag){ -1, -1 };
+}
+
+static void free_nfa(struct nfa *nfa) {
+    free(nfa->states);
+    free(nfa->sets);
+    memset(nfa, 0, sizeof(*nfa));
+}
+
+/* builds one nfa matching any of the rules, returns its start state or -1 */
+static int build_nfa(struct nfa *nfa, const struct path_rule *rules, size_t count) {
+    memset(nfa, 0, sizeof(*nfa));
+
+    int accept = add_state(nfa, NFA_ACCEPT, -1, -1, 0);
+    int start = -1, floating_start = -1;
+    for (size_t i = 0; i < count && !nfa->error; i++) {
+        int floating = 0;
+        struct frag f = parse_rule(nfa, rules[i].kind, rules[i].pattern, &floating);
+        if (nfa->error)
+            break;
+
+        nfa->states[f.end].out = accept;
+        if (floating)
+            floating_start = (floating_start == -1) ? f.start : add_state(nfa, NFA_SPLIT, floating_start, f.start, 0);
+        else
+            start = (start == -1) ? f.start : add_state(nfa, NFA_SPLIT, start, f.start, 0);
+    }
+
+    /* rules matching anywhere in the path share the loop skipping the bytes before them */
+    if (floating_start != -1) {
+        struct frag skip = frag_repeat(nfa, frag_any(nfa), '*');
+        if (!nfa->error)
+            nfa->states[skip.end].out = floating_start;
+
+        start = (start == -1) ? skip.start : add_state(nfa, NFA_SPLIT, start, skip.start, 0);
+    }
+
+    return nfa->error ? -1 : start;
+}
+
+/* flags the NFA_SET states that read any byte and loop back to themselves next to NFA_ACCEPT */
+static int mark_tails(struct nfa *nfa) {
+    int *stack = (int *)malloc(sizeof(int) * (nfa->count * 2 + 1));
+    uint32_t *mark = (uint32_t *)calloc(nfa->count, sizeof(uint32_t));
+    if (!stack || !mark) {
+        perror("malloc");
+        free(stack);
+        free(mark);
+        return 0;
+    }
+
+    nfa->tail = -1;
+    uint32_t gen = 0;
+    for (size_t t = 0; t < nfa->count; t++) {
+        const struct nfa_state *st = &nfa->states[t];
+        if (st->type != NFA_SET)
+            continue;
+
+        int any = 1;
+        for (size_t i = 0; i < 32 && any; i++)
+            any = (nfa->sets[st->set][i] == 0xff);
+        if (!any)
+            continue;
+
+        int loops = 0, accepts = 0;
+        size_t top = 0;
+        stack[top++] = st->out;
+        gen++;
+        while (top) {
+            int s = stack[--top];
+            if (s < 0 || mark[s] == gen)
+                continue;
+            mark[s] = gen;
+
+            const struct nfa_state *next = &nfa->states[s];
+            if ((size_t)s == t)
+                loops = 1;
+            if (next->type == NFA_ACCEPT)
+                accepts = 1;
+
+            if (next->type == NFA_SPLIT)
+                stack[top++] = next->out1;
+            if (next->type == NFA_SPLIT || next->type == NFA_EPS)
+                stack[top++] = next->out;
+        }
+
+        if (loops && accepts) {
+            nfa->states[t].tail = 1;
+            if (nfa->tail == -1)
+                nfa->tail = (int)t;
+        }
+    }
+
+    free(stack);
+    free(mark);
+    return 1;
+}
+
+/* splits the 256 bytes into the coarsest classes that every set of the nfa agrees with */
+static uint16_t byte_classes(const struct nfa *nfa, uint8_t *byte_class) {
+    memset(byte_class, 0, 256);
+    uint16_t count = 1;
+
+    for (size_t i = 0; i < nfa->set_count && count < 256; i++) {
+        int16_t split[512];
+        memset(split, -1, sizeof(split));
+
+        uint8_t refined[256];
+        count = 0;
+        for (unsigned int b = 0; b < 256; b++) {
+            int slot = byte_class[b] * 2 + in_set(nfa->sets[i], (unsigned char)b);
+            if (split[slot] == -1)
+                split[slot] = (int16_t)count++;
+            refined[b] = (uint8_t)split[slot];
+        }
+
+        memcpy(byte_class, refined, 256);
+    }
+
+    return count;
+}
+
+/* lsd radix sort of non negative state indices, one pass per byte of the largest one */
+static void sort_states(int *states, size_t n, int *tmp) {
+    int max = 0;
+    for (size_t i = 0; i < n; i++)
+        max = (states[i] > max) ? states[i] : max;
+
+    for (int shift = 0; shift < 32 && (max >> shift) > 0; shift += 8) {
+        size_t count[257] = { 0 };
+        for (size_t i = 0; i < n; i++)
+            count[((states[i] >> shift) & 0xff) + 1]++;
+
+        for (size_t b = 1; b < 257; b++)
+            count[b] += count[b - 1];
+
+        for (size_t i = 0; i < n; i++)
+            tmp[count[(states[i] >> shift) & 0xff]++] = states[i];
+
+        memcpy(states, tmp, sizeof(int) * n);
+    }
+}
+
+/*
+ * follows every epsilon move from seeds, returns the sorted NFA_SET and NFA_ACCEPT states reached
+ *
+ * a set holding NFA_ACCEPT and a tail state matches whatever follows, so the other states
+ * are dropped and every such set collapses into the same dfa state
+ */
+static size_t closure(const struct nfa *nfa, int *stack, uint32_t *mark, uint32_t gen,
+        const int *seeds, size_t seed_count, int *out, int *tmp) {
+    size_t top = 0, n = 0;
+    int accept = 0, tail = 0;
+    for (size_t i = 0; i < seed_count; i++)
+        stack[top++] = seeds[i];
+
+    while (top) {
+        int s = stack[--top];
+        if (s < 0 || mark[s] == gen)
+            continue;
+        mark[s] = gen;
+
+        const struct nfa_state *st = &nfa->states[s];
+        switch (st->type) {
+            case NFA_SPLIT:
+                stack[top++] = st->out1;
+                /* fall through */
+            case NFA_EPS:
+                stack[top++] = st->out;
+                break;
+            default:
+                accept |= (st->type == NFA_ACCEPT);
+                tail |= st->tail;
+                out[n++] = s;
+        }
+    }
+
+    /* build_nfa adds NFA_ACCEPT first, so it is state 0 */
+    if (accept && tail) {
+        out[0] = 0;
+        out[1] = nfa->tail;
+        return 2;
+    }
+
+    sort_states(out, n, tmp);
+    return n;
+}
+
+static void free_dfa(struct path_dfa *dfa) {
+    free(dfa->next);
+    memset(dfa, 0, sizeof(*dfa));
+}
+
+/* subset construction, returns 0 if the dfa needs more than PATH_DFA_MAX_STATES or on failure */
+static int build_dfa(struct path_dfa *dfa, const struct path_rule *rules, size_t count) {
+    memset(dfa, 0, sizeof(*dfa));
+
+    struct nfa nfa;
+    int start = build_nfa(&nfa, rules, count);
+    if (start == -1) {
+        free_nfa(&nfa);
+        return 0;
+    }
+
+    if (!mark_tails(&nfa)) {
+        free_nfa(&nfa);
+        return 0;
+    }
+
+    dfa->classes = byte_classes(&nfa, dfa->byte_class);
+
+    unsigned char rep[256];
+    for (int b = 255; b >= 0; b--)
+        rep[dfa->byte_class[b]] = (unsigned char)b;
+
+    int *stack = (int *)malloc(sizeof(int) * (nfa.count * 3 + 1));
+    int *seeds = (int *)malloc(sizeof(int) * (nfa.count + 1));
+    int *found = (int *)malloc(sizeof(int) * (nfa.count + 1));
+    uint32_t *mark = (uint32_t *)calloc(nfa.count, sizeof(uint32_t));
+    struct dfa_key **by_id = (struct dfa_key **)malloc(sizeof(*by_id) * PATH_DFA_MAX_STATES);
+    struct dfa_key *table = NULL;
+    uint8_t *flags = NULL;
+    uint32_t gen = 0;
+    uint32_t cap = 0;
+    int ok = 0;
+
+    if (!stack || !seeds || !found || !mark || !by_id) {
+        perror("malloc");
+        goto clean;
+    }
+
+    /* state 0 is the dead state, the empty set */
+    for (int pass = 0; pass < 2; pass++) {
+        size_t n = pass ? closure(&nfa, stack, mark, ++gen, &start, 1, found, stack) : 0;
+
+        struct dfa_key *key = (struct dfa_key *)malloc(sizeof(*key) + sizeof(int) * n);
+        if (!key) {
+            perror("malloc");
+            goto clean;
+        }
+
+        key->id = dfa->states;
+        key->len = n;
+        memcpy(key->states, found, sizeof(int) * n);
+        HASH_ADD_KEYPTR(hh, table, key->states, sizeof(int) * n, key);
+        by_id[dfa->states++] = key;
+    }
+
+    for (uint32_t id = 0; id < dfa->states; id++) {
+        if (id >= cap) {
+            uint32_t new_cap = cap ? cap * 2 : 64;
+            uint32_t *next = (uint32_t *)realloc(dfa->next, sizeof(uint32_t) * new_cap * dfa->classes);
+            if (next)
+                dfa->next = next;
+            uint8_t *new_flags = (uint8_t *)realloc(flags, new_cap);
+            if (new_flags)
+                flags = new_flags;
+
+            if (!next || !new_flags) {
+                perror("realloc");
+                goto clean;
+            }
+            cap = new_cap;
+        }
+
+        const struct dfa_key *current = by_id[id];
+        flags[id] = 0;
+        for (size_t i = 0; i < current->len; i++) {
+            if (nfa.states[current->states[i]].type == NFA_ACCEPT)
+                flags[id] |= STATE_ACCEPT;
+        }
+
+        for (uint16_t c = 0; c < dfa->classes; c++) {
+            size_t seed_count = 0;
+            for (size_t i = 0; i < current->len; i++) {
+                const struct nfa_state *st = &nfa.states[current->states[i]];
+                if (st->type == NFA_SET && in_set(nfa.sets[st->set], rep[c]))
+                    seeds[seed_count++] = st->out;
+            }
+
+            size_t n = closure(&nfa, stack, mark, ++gen, seeds, seed_count, found, stack);
+
+            struct dfa_key *key = NULL;
+            HASH_FIND(hh, table, found, sizeof(int) * n, key);
+            if (!key) {
+                if (dfa->states >= PATH_DFA_MAX_STATES)
+                    goto clean;
+
+                key = (struct dfa_key *)malloc(sizeof(*key) + sizeof(int) * n);
+                if (!key) {
+                    perror("malloc");
+                    goto clean;
+                }
+
+                key->id = dfa->states;
+                key->len = n;
+                memcpy(key->states, found, sizeof(int) * n);
+                HASH_ADD_KEYPTR(hh, table, key->states, sizeof(int) * n, key);
+                by_id[dfa->states++] = key;
+            }
+
+            dfa->next[(size_t)id * dfa->classes + c] = key->id;
+        }
+    }
+
+    /* an accepting state looping on itself for every byte matches whatever follows */
+    for (uint32_t id = 1; id < dfa->states; id++) {
+        if (!(flags[id] & STATE_ACCEPT))
+            continue;
+
+        uint16_t c = 0;
+        while (c < dfa->classes && dfa->next[(size_t)id * dfa->classes + c] == id)
+            c++;
+
+        if (c == dfa->classes)
+            flags[id] |= STATE_STICKY;
+    }
+
+    /* replaces every target state by its flagged row */
+    for (size_t i = 0; i < (size_t)dfa->states * dfa->classes; i++) {
+        uint32_t target = dfa->next[i];
+        dfa->next[i] = target * dfa->classes
+            | ((flags[target] & STATE_ACCEPT) ? PATH_DFA_ACCEPT : 0)
+            | ((flags[target] & STATE_STICKY) ? PATH_DFA_STICKY : 0);
+    }
+
+    dfa->start = dfa->classes
+        | ((flags[1] & STATE_ACCEPT) ? PATH_DFA_ACCEPT : 0)
+        | ((flags[1] & STATE_STICKY) ? PATH_DFA_STICKY : 0);
+
+    ok = 1;
+
+clean:
+    {
+        struct dfa_key *key, *tmp;
+        HASH_ITER(hh, table, key, tmp) {
+            HASH_DEL(table, key);
+            free(key);
+        }
+    }
+
+    free(stack);
+    free(seeds);
+    free(found);
+    free(mark);
+    free(by_id);
+    free(flags);
+    free_nfa(&nfa);
+
+    if (!ok)
+        free_dfa(dfa);
+
+    return ok;
+}
+
+/* compiles rules [lo, hi) into as few automatons as possible, returns the count of rules dropped */
+static size_t compile_range(struct path_rules *rules, size_t lo, size_t hi) {
+    struct path_dfa dfa;
+    if (build_dfa(&dfa, rules->rules + lo, hi - lo)) {
+        struct path_dfa *tmp = (struct path_dfa *)realloc(rules->dfas, sizeof(*tmp) * (rules->dfa_count + 1));
+        if (!tmp) {
+            perror("realloc");
+            free_dfa(&dfa);
+            return hi - lo;
+        }
+
+        rules->dfas = tmp;
+        rules->dfas[rules->dfa_count++] = dfa;
+        rules->states += dfa.states;
+        return 0;
+    }
+
+    if (hi - lo == 1)
+        return 1;
+
+    size_t mid = lo + (hi - lo) / 2;
+    return compile_range(rules, lo, mid) + compile_range(rules, mid, hi);
+}
+
+static int dfa_match(const struct path_dfa *dfa, const char *path) {
+    /* bytes of the path may alias the automaton, so its fields are loaded once */
+    const uint32_t *next = dfa->next;
+    const uint8_t *byte_class = dfa->byte_class;
+
+    uint32_t t = dfa->start;
+    for (const unsigned char *p = (const unsigned char *)path; ; p++) {
+        if (t & PATH_DFA_STICKY)
+            return 1;
+
+        if (*p == '\0')
+            break;
+
+        t = next[(t & PATH_DFA_ROW_MASK) + byte_class[*p]];
+        if (t == 0)
+            return 0;
+    }
+
+    return (t & PATH_DFA_ACCEPT) != 0;
+}
+
+int path_rule_kind(const char *line, const char **pattern) {
+    if (strncmp(line, PATH_RULE_GLOB_TAG, sizeof(PATH_RULE_GLOB_TAG) - 1) == 0) {
+        *pattern = line + sizeof(PATH_RULE_GLOB_TAG) - 1;
+        return PATH_RULE_GLOB;
+    }
+
+    if (strncmp(line, PATH_RULE_REGEX_TAG, sizeof(PATH_RULE_REGEX_TAG) - 1) == 0) {
+        *pattern = line + sizeof(PATH_RULE_REGEX_TAG) - 1;
+        return PATH_RULE_REGEX;
+    }
+
+    *pattern = line;
+    return PATH_RULE_PREFIX;
+}
+
+int path_rule_check(int kind, const char *pattern, const char **error) {
+    struct path_rule rule = { .kind = kind, .pattern = (char *)pattern };
+
+    struct nfa nfa;
+    build_nfa(&nfa, &rule, 1);
+
+    const char *e = nfa.error;
+    free_nfa(&nfa);
+
+    if (error)
+        *error = e;
+
+    return e == NULL;
+}
+
+void path_rules_init(struct path_rules *rules) {
+    memset(rules, 0, sizeof(*rules));
+}
+
+int path_rules_add(struct path_rules *rules, int kind, const char *pattern, const char **error) {
+    if (!path_rule_check(kind, pattern, error))
+        return 0;
+
+    if (rules->count == rules->cap) {
+        size_t cap = rules->cap ? rules->cap * 2 : 16;
+        struct path_rule *tmp = (struct path_rule *)realloc(rules->rules, sizeof(*tmp) * cap);
+        if (!tmp) {
+            perror("realloc");
+            if (error)
+                *error = "out of memory";
+            return 0;
+        }
+
+        rules->rules = tmp;
+        rules->cap = cap;
+    }
+
+    char *copy = strdup(pattern);
+    if (!copy) {
+        perror("strdup");
+        if (error)
+            *error = "out of memory";
+        return 0;
+    }
+
+    rules->rules[rules->count++] = (struct path_rule){ .kind = kind, .pattern = copy };
+    return 1;
+}
+
+size_t path_rules_compile(struct path_rules *rules) {
+    for (size_t i = 0; i < rules->dfa_count; i++)
+        free_dfa(&rules->dfas[i]);
+    free(rules->dfas);
+
+    rules->dfas = NULL;
+    rules->dfa_count = 0;
+    rules->states = 0;
+
+    if (rules->count == 0)
+        return 0;
+
+    return compile_range(rules, 0, rules->count);
+}
+
+int path_rules_match(const struct path_rules *rules, const char *path) {
+    for (size_t i = 0; i < rules->dfa_count; i++) {
+        if (dfa_match(&rules->dfas[i], path))
+            return 1;
+    }
+
+    return 0;
+}
+
+void path_rules_clear(struct path_rules *rules) {
+    for (size_t i = 0; i < rules->count; i++)
+        free(rules->rules[i].pattern);
+    free(rules->rules);
+
+    for (size_t i = 0; i < rules->dfa_count; i++)
+        free_dfa(&rules->dfas[i]);
+    free(rules->dfas);
+
+    path_rules_init(rules);
+}
@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/listener/path_trie.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h> /* perror */
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcpy, memset, strchr, strlen */
+#include "path_trie.h"
+
+/* returns the next component of a path and its length, NULL at the end of the path */
+static const char *next_component(const char *path, size_t *len) {
+    while (*path == '/')
+        path++;
+
+    if (*path == '\0')
+        return NULL;
+
+    const char *end = strchr(path, '/');
+    *len = end ? (size_t)(end - path) : strlen(path);
+    return path;
+}
+
+/* frees a node and every node below it */
+static void free_node(struct path_trie_node *node) {
+    struct path_trie_node *child, *tmp;
+    HASH_ITER(hh, node->children, child, tmp) {
+        HASH_DEL(node->children, child);
+        free_node(child);
+    }
+
+    free(node);
+}
+
+void path_trie_init(struct path_trie *trie) {
+    memset(trie, 0, sizeof(*trie));
+}
+
+int path_trie_insert(struct path_trie *trie, const char *path, int match) {
+    if (path[0] != '/')
+        return 0;
+
+    struct path_trie_node **children = &trie->children;
+    int *node_match = &trie->match;
+
+    size_t len;
+    const char *name = path;
+    while ((name = next_component(name, &len))) {
+        struct path_trie_node *node = NULL;
+        HASH_FIND(hh, *children, name, len, node);
+
+        if (!node) {
+            node = (struct path_trie_node *)malloc(sizeof(*node) + len);
+            if (!node) {
+                perror("malloc");
+                return 0;
+            }
+
+            memset(node, 0, sizeof(*node));
+            memcpy(node->name, name, len);
+            node->name_len = len;
+            HASH_ADD_KEYPTR(hh, *children, node->name, node->name_len, node);
+            trie->nodes++;
+        }
+
+        children = &node->children;
+        node_match = &node->match;
+        name += len;
+    }
+
+    if (*node_match < match)
+        *node_match = match;
+
+    trie->count++;
+    return 1;
+}
+
+int path_trie_match(const struct path_trie *trie, const char *path) {
+    if (trie->match == PATH_TRIE_PREFIX)
+        return 1;
+
+    const struct path_trie_node *node = NULL;
+    struct path_trie_node *children = trie->children;
+
+    size_t len;
+    const char *name = path;
+    while ((name = next_component(name, &len))) {
+        HASH_FIND(hh, children, name, len, node);
+        if (!node)
+            return 0;
+
+        if (node->match == PATH_TRIE_PREFIX)
+            return 1;
+
+        children = node->children;
+        name += len;
+    }
+
+    return node && node->match == PATH_TRIE_EXACT;
+}
+
+void path_trie_clear(struct path_trie *trie) {
+    struct path_trie_node *child, *tmp;
+    HASH_ITER(hh, trie->children, child, tmp) {
+        HASH_DEL(trie->children, child);
+        free_node(child);
+    }
+
+    path_trie_init(trie);
+}
@@ -0,0 +1,725 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/listener/wal.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <dirent.h> /* opendir, readdir, closedir, DIR, dirent */
+#include <errno.h> /* errno, EINTR */
+#include <fcntl.h> /* open, O_WRONLY, O_CREAT, O_EXCL, O_APPEND, O_RDONLY, O_DIRECTORY, O_CLOEXEC, AT_FDCWD */
+#include <stdio.h> /* perror, snprintf */
+#include <stdlib.h> /* malloc, realloc, free, qsort */
+#include <string.h> /* memcpy, memcmp, memchr, memset, strcmp, strlen, strncpy */
+#include <sys/stat.h> /* fstat, stat */
+#include <unistd.h> /* read, write, close, fsync, fdatasync, ftruncate, unlink */
+#include "wal.h"
+
+#define CRC32C_POLY 0x82F63B78U /* castagnoli polynomial, reflected */
+#define SEGMENT_NAME_LENGTH 20 /* 16 hex digits of the id and the .wal suffix */
+#define MIN_BUFF_SIZE 65536 /* first allocation of the group buffer */
+#define REMOVE_BATCH 8 /* unlinks submitted together by wal_remove */
+
+/**
+ * user_data of the requests submitted to the ring
+ */
+enum wal_op {
+    OP_WRITE = 1, /** > write of a group */
+    OP_SYNC, /** > fdatasync linked after the write of a group */
+    OP_UNLINK /** > unlink of a segment, user_data holds its index in the batch */
+};
+
+static uint32_t crc_table[256];
+
+static void init_crc_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0U - (crc & 1)));
+        crc_table[i] = crc;
+    }
+}
+
+uint32_t wal_crc32c(const void *data, size_t len) {
+    /* entry 0 is always 0, entry 1 is not */
+    if (!crc_table[1])
+        init_crc_table();
+
+    const unsigned char *p = (const unsigned char *)data;
+    uint32_t crc = 0xFFFFFFFFU;
+
+    for (size_t i = 0; i < len; i++)
+        crc = (crc >> 8) ^ crc_table[(crc ^ p[i]) & 0xFF];
+
+    return crc ^ 0xFFFFFFFFU;
+}
+
+/* segments are named by their id in hex, so they sort like their ids */
+static int parse_segment(const char *name, uint64_t *id) {
+    if (strlen(name) != SEGMENT_NAME_LENGTH || strcmp(name + 16, ".wal") != 0)
+        return 0;
+
+    uint64_t value = 0;
+    for (int i = 0; i < 16; i++) {
+        char c = name[i];
+        unsigned digit;
+        if (c >= '0' && c <= '9') {
+            digit = (unsigned)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            digit = (unsigned)(c - 'a' + 10);
+        } else {
+            return 0;
+        }
+
+        value = (value << 4) | digit;
+    }
+
+    *id = value;
+    return 1;
+}
+
+static int compare_ids(const void *a, const void *b) {
+    uint64_t id_a = *(const uint64_t *)a;
+    uint64_t id_b = *(const uint64_t *)b;
+
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+/* sorted ids of the segments of a directory within a range, malloc'ed */
+static size_t list_segments(const char *dir, uint64_t first, uint64_t last, uint64_t **out) {
+    *out = NULL;
+
+    DIR *d = opendir(dir);
+    if (!d)
+        return 0;
+
+    uint64_t *ids = NULL;
+    size_t count = 0, cap = 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        uint64_t id;
+        if (!parse_segment(entry->d_name, &id) || id < first || id > last)
+            continue;
+
+        if (count == cap) {
+            size_t new_cap = cap ? cap * 2 : 16;
+            uint64_t *tmp = (uint64_t *)realloc(ids, sizeof(uint64_t) * new_cap);
+            if (!tmp) {
+                perror("realloc");
+                break;
+            }
+
+            ids = tmp;
+            cap = new_cap;
+        }
+
+        ids[count++] = id;
+    }
+    closedir(d);
+
+    qsort(ids, count, sizeof(uint64_t), compare_ids);
+
+    *out = ids;
+    return count;
+}
+
+/* makes the creation or removal of segments durable */
+static void sync_dir(const char *dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+        return;
+
+    fsync(fd);
+    close(fd);
+}
+
+static int write_all(int fd, const unsigned char *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, data + done, len - done);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+
+        done += (size_t)n;
+    }
+
+    return 1;
+}
+
+static int open_segment(struct wal *wal, uint64_t id) {
+    char path[WAL_DIR_LENGTH + 32];
+    snprintf(path, sizeof(path), WAL_SEGMENT_FORMAT, wal->dir, (unsigned long long)id);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        perror("open");
+        return 0;
+    }
+
+    unsigned char header[WAL_HEADER_SIZE];
+    memcpy(header, WAL_MAGIC, WAL_MAGIC_SIZE);
+    memcpy(header + WAL_MAGIC_SIZE, &id, sizeof(id));
+
+    if (!write_all(fd, header, sizeof(header)) || (wal->sync != WAL_SYNC_NONE && fdatasync(fd) == -1)) {
+        perror("write");
+        close(fd);
+        unlink(path);
+        return 0;
+    }
+
+    if (wal->sync != WAL_SYNC_NONE)
+        sync_dir(wal->dir);
+
+    wal->fd = fd;
+    wal->segment = id;
+    wal->size = WAL_HEADER_SIZE;
+
+    return 1;
+}
+
+int wal_open(struct wal *wal, const char *dir, enum wal_sync sync, uint64_t segment) {
+    memset(wal, 0, sizeof(*wal));
+
+    strncpy(wal->dir, dir, WAL_DIR_LENGTH - 1);
+    wal->fd = -1;
+    wal->sync = sync;
+
+    /* a failed open is retried by the next commit with the same id */
+    wal->segment = segment - 1;
+
+    return open_segment(wal, segment);
+}
+
+static unsigned char *reserve_record(struct wal *wal, size_t payload) {
+    if (wal->failed)
+        return NULL;
+
+    if (payload > WAL_MAX_PAYLOAD) {
+        wal->failed = 1;
+        return NULL;
+    }
+
+    size_t needed = wal->len + WAL_RECORD_HEADER + payload;
+    if (needed > wal->cap) {
+        size_t new_cap = wal->cap ? wal->cap : MIN_BUFF_SIZE;
+        while (new_cap < needed)
+            new_cap *= 2;
+
+        unsigned char *tmp = (unsigned char *)realloc(wal->buff, new_cap);
+        if (!tmp) {
+            perror("realloc");
+            wal->failed = 1;
+            return NULL;
+        }
+
+        wal->buff = tmp;
+        wal->cap = new_cap;
+    }
+
+    return wal->buff + wal->len + WAL_RECORD_HEADER;
+}
+
+/* the length and crc are filled once the payload is written */
+static int finish_record(struct wal *wal, size_t payload) {
+    unsigned char *record = wal->buff + wal->len;
+
+    uint32_t len = (uint32_t)payload;
+    uint32_t crc = wal_crc32c(record + WAL_RECORD_HEADER, payload);
+
+    memcpy(record, &len, sizeof(len));
+    memcpy(record + sizeof(len), &crc, sizeof(crc));
+
+    wal->len += WAL_RECORD_HEADER + payload;
+    wal->pending++;
+
+    return 1;
+}
+
+void wal_time(struct wal *wal, uint64_t time) {
+    wal->time = time;
+    wal->stamped = 0;
+}
+
+static int stamp_group(struct wal *wal) {
+    /* type, seconds and a terminator, every payload ends in one */
+    size_t payload = 1 + sizeof(uint64_t) + 1;
+
+    unsigned char *p = reserve_record(wal, payload);
+    if (!p)
+        return 0;
+
+    p[0] = WAL_TIME;
+    memcpy(p + 1, &wal->time, sizeof(wal->time));
+    p[payload - 1] = '\0';
+
+    wal->stamped = 1;
+    return finish_record(wal, payload);
+}
+
+int wal_count(struct wal *wal, const char *path, size_t len, uint32_t opened, uint32_t modified) {
+    /* type, both counters and the path with its terminator */
+    size_t payload = 1 + 2 * sizeof(uint32_t) + len + 1;
+
+    if (wal->time && !wal->stamped && !stamp_group(wal))
+        return 0;
+
+    unsigned char *p = reserve_record(wal, payload);
+    if (!p)
+        return 0;
+
+    p[0] = WAL_COUNT;
+    memcpy(p + 1, &opened, sizeof(opened));
+    memcpy(p + 1 + sizeof(opened), &modified, sizeof(modified));
+    memcpy(p + 1 + 2 * sizeof(uint32_t), path, len);
+    p[payload - 1] = '\0';
+
+    return finish_record(wal, payload);
+}
+
+int wal_delete(struct wal *wal, const char *path) {
+    size_t len = strlen(path);
+    size_t payload = 1 + len + 1;
+
+    unsigned char *p = reserve_record(wal, payload);
+    if (!p)
+        return 0;
+
+    p[0] = WAL_DELETE;
+    memcpy(p + 1, path, len + 1);
+
+    return finish_record(wal, payload);
+}
+
+int wal_move(struct wal *wal, const char *from, const char *to) {
+    size_t from_len = strlen(from);
+    size_t to_len = strlen(to);
+    size_t payload = 1 + from_len + 1 + to_len + 1;
+
+    unsigned char *p = reserve_record(wal, payload);
+    if (!p)
+        return 0;
+
+    p[0] = WAL_MOVE;
+    memcpy(p + 1, from, from_len + 1);
+    memcpy(p + 1 + from_len + 1, to, to_len + 1);
+
+    return finish_record(wal, payload);
+}
+
+static void drop_group(struct wal *wal) {
+    wal->len = 0;
+    wal->pending = 0;
+    wal->failed = 0;
+    wal->stamped = 0;
+}
+
+/* waits for the group written through the ring, a failed group is cut off the segment */
+static int wait_group(struct wal *wal) {
+    if (wal->inflight_len == 0)
+        return 1;
+
+    int failed = 0;
+    while (wal->inflight_ops) {
+        struct io_uring_cqe cqe;
+        if (io_ring_reap(wal->ring, &cqe, 1) != 1) {
+            failed = 1;
+            break;
+        }
+
+        wal->inflight_ops--;
+
+        if (cqe.user_data == OP_WRITE && cqe.res != (int)wal->inflight_len) {
+            errno = (cqe.res < 0) ? -cqe.res : EIO;
+            failed = 1;
+        } else if (cqe.user_data == OP_SYNC && cqe.res < 0) {
+            errno = -cqe.res;
+            failed = 1;
+        }
+    }
+
+    if (failed) {
+        perror("write");
+
+        if (ftruncate(wal->fd, (off_t)wal->inflight_start) == -1)
+            perror("ftruncate");
+
+        wal->size = wal->inflight_start;
+    }
+
+    wal->inflight_len = 0;
+    wal->inflight_ops = 0;
+
+    return !failed;
+}
+
+/* submits the write of the current group and its sync, the group buffer is swapped for the idle one */
+static int submit_group(struct wal *wal) {
+    struct io_uring_sqe *sqe = io_ring_prepare(wal->ring, IORING_OP_WRITE, wal->fd, OP_WRITE);
+    if (!sqe)
+        return 0;
+
+    sqe->addr = (uint64_t)(uintptr_t)wal->buff;
+    sqe->len = (uint32_t)wal->len;
+    sqe->off = wal->size;
+    unsigned ops = 1;
+
+    if (wal->sync == WAL_SYNC_COMMIT) {
+        /* the sync only runs once the write completed in full */
+        sqe->flags |= IOSQE_IO_LINK;
+
+        sqe = io_ring_prepare(wal->ring, IORING_OP_FSYNC, wal->fd, OP_SYNC);
+        if (!sqe)
+            return 0;
+
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        ops++;
+    }
+
+    /* requests the kernel didnt take are handed over again while waiting for them */
+    if (io_ring_submit(wal->ring, 0) == -1)
+        perror("io_uring_enter");
+
+    wal->inflight_start = wal->size;
+    wal->inflight_len = wal->len;
+    wal->inflight_ops = ops;
+    wal->size += wal->len;
+
+    unsigned char *buff = wal->buff;
+    size_t cap = wal->cap;
+    wal->buff = wal->inflight;
+    wal->cap = wal->inflight_cap;
+    wal->inflight = buff;
+    wal->inflight_cap = cap;
+
+    return 1;
+}
+
+int wal_commit(struct wal *wal) {
+    int r = wait_group(wal);
+
+    if (wal->failed) {
+        drop_group(wal);
+        return 0;
+    }
+
+    if (wal->len == 0)
+        return r;
+
+    if (wal->fd == -1 && !open_segment(wal, wal->segment + 1)) {
+        drop_group(wal);
+        return 0;
+    }
+
+    /* the ring holds at most one group, the submission queue always has room for it */
+    if (io_ring_ready(wal->ring) && submit_group(wal)) {
+        drop_group(wal);
+
+        if (wal->size < WAL_SEGMENT_SIZE)
+            return r;
+
+        /* the group is reaped before sealing the segment, so its result is returned like a blocking write */
+        int written = wait_group(wal);
+        return wal_rotate(wal) && written && r;
+    }
+
+    int written = write_all(wal->fd, wal->buff, wal->len);
+    if (written && wal->sync == WAL_SYNC_COMMIT && fdatasync(wal->fd) == -1)
+        written = 0;
+
+    if (!written) {
+        perror("write");
+
+        /* a partial group would hide the groups written after it from the replay */
+        if (ftruncate(wal->fd, (off_t)wal->size) == -1)
+            perror("ftruncate");
+
+        drop_group(wal);
+        return 0;
+    }
+
+    wal->size += wal->len;
+    drop_group(wal);
+
+    if (wal->size >= WAL_SEGMENT_SIZE)
+        return wal_rotate(wal) && r;
+
+    return r;
+}
+
+int wal_rotate(struct wal *wal) {
+    if (!wait_group(wal))
+        fprintf(stderr, "Group lost while sealing segment %llu.\n", (unsigned long long)wal->segment);
+
+    if (wal->fd != -1) {
+        if (wal->sync != WAL_SYNC_NONE && fdatasync(wal->fd) == -1)
+            perror("fdatasync");
+
+        close(wal->fd);
+        wal->fd = -1;
+    }
+
+    return open_segment(wal, wal->segment + 1);
+}
+
+void wal_close(struct wal *wal) {
+    if (!wait_group(wal))
+        fprintf(stderr, "Group lost while closing segment %llu.\n", (unsigned long long)wal->segment);
+
+    if (wal->fd != -1) {
+        if (wal->sync != WAL_SYNC_NONE)
+            fdatasync(wal->fd);
+
+        close(wal->fd);
+        wal->fd = -1;
+
+        /* an empty segment would only be replayed for nothing on the next start */
+        if (wal->size == WAL_HEADER_SIZE) {
+            char path[WAL_DIR_LENGTH + 32];
+            snprintf(path, sizeof(path), WAL_SEGMENT_FORMAT, wal->dir, (unsigned long long)wal->segment);
+            unlink(path);
+        }
+    }
+
+    free(wal->buff);
+    free(wal->inflight);
+    wal->buff = wal->inflight = NULL;
+    wal->len = wal->cap = wal->inflight_cap = wal->pending = 0;
+}
+
+size_t wal_range(const char *dir, uint64_t *first, uint64_t *last) {
+    uint64_t *ids;
+    size_t count = list_segments(dir, 0, UINT64_MAX, &ids);
+
+    if (count) {
+        *first = ids[0];
+        *last = ids[count - 1];
+    }
+
+    free(ids);
+    return count;
+}
+
+/* decodes a payload, every string must end in its terminator */
+static int parse_record(const unsigned char *p, size_t len, struct wal_entry *entry) {
+    const char *end = (const char *)p + len;
+
+    memset(entry, 0, sizeof(*entry));
+    entry->type = (enum wal_type)p[0];
+
+    if (p[len - 1] != '\0')
+        return 0;
+
+    switch (entry->type) {
+        case WAL_COUNT:
+            if (len < 1 + 2 * sizeof(uint32_t) + 1)
+                return 0;
+
+            memcpy(&entry->opened, p + 1, sizeof(uint32_t));
+            memcpy(&entry->modified, p + 1 + sizeof(uint32_t), sizeof(uint32_t));
+            entry->path = (const char *)p + 1 + 2 * sizeof(uint32_t);
+            return 1;
+        case WAL_DELETE:
+            entry->path = (const char *)p + 1;
+            return 1;
+        case WAL_TIME:
+            if (len != 1 + sizeof(uint64_t) + 1)
+                return 0;
+
+            memcpy(&entry->time, p + 1, sizeof(uint64_t));
+            return 1;
+        case WAL_MOVE: {
+            entry->path = (const char *)p + 1;
+
+            const char *sep = (const char *)memchr(entry->path, '\0', (size_t)(end - entry->path));
+            if (sep + 1 >= end)
+                return 0;
+
+            entry->to = sep + 1;
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+static unsigned char *read_segment(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < WAL_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+
+    unsigned char *data = (unsigned char *)malloc((size_t)st.st_size);
+    if (!data) {
+        perror("malloc");
+        close(fd);
+        return NULL;
+    }
+
+    size_t done = 0;
+    while (done < (size_t)st.st_size) {
+        ssize_t n = read(fd, data + done, (size_t)st.st_size - done);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+
+        done += (size_t)n;
+    }
+    close(fd);
+
+    *size = done;
+    return data;
+}
+
+size_t wal_replay(const char *dir, uint64_t first, uint64_t last, wal_handler *handler, void *arg, size_t *torn) {
+    *torn = 0;
+
+    uint64_t *ids;
+    size_t count = list_segments(dir, first, last, &ids);
+
+    size_t replayed = 0;
+    for (size_t i = 0; i < count; i++) {
+        char path[WAL_DIR_LENGTH + 32];
+        snprintf(path, sizeof(path), WAL_SEGMENT_FORMAT, dir, (unsigned long long)ids[i]);
+
+        size_t size = 0;
+        unsigned char *data = read_segment(path, &size);
+        if (!data || size < WAL_HEADER_SIZE || memcmp(data, WAL_MAGIC, WAL_MAGIC_SIZE) != 0) {
+            (*torn)++;
+            free(data);
+            continue;
+        }
+
+        size_t off = WAL_HEADER_SIZE;
+        while (off < size) {
+            uint32_t len, crc;
+            if (size - off < WAL_RECORD_HEADER)
+                break;
+
+            memcpy(&len, data + off, sizeof(len));
+            memcpy(&crc, data + off + sizeof(len), sizeof(crc));
+
+            if (len == 0 || len > WAL_MAX_PAYLOAD || len > size - off - WAL_RECORD_HEADER)
+                break;
+
+            const unsigned char *payload = data + off + WAL_RECORD_HEADER;
+            if (wal_crc32c(payload, len) != crc)
+                break;
+
+            struct wal_entry entry;
+            if (parse_record(payload, len, &entry)) {
+                handler(&entry, arg);
+                replayed++;
+            }
+
+            off += WAL_RECORD_HEADER + len;
+        }
+
+        if (off < size)
+            (*torn)++;
+
+        free(data);
+    }
+
+    free(ids);
+    return replayed;
+}
+
+/* unlinks a batch of segments through the ring, the ones the ring couldnt unlink are removed with unlink */
+static size_t remove_batch(struct io_ring *ring, char (*paths)[WAL_DIR_LENGTH + 32], size_t count) {
+    int done[REMOVE_BATCH] = { 0 };
+    size_t removed = 0, submitted = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        struct io_uring_sqe *sqe = io_ring_prepare(ring, IORING_OP_UNLINKAT, AT_FDCWD, OP_UNLINK + i);
+        if (!sqe)
+            break;
+
+        sqe->addr = (uint64_t)(uintptr_t)paths[i];
+        submitted++;
+    }
+
+    if (submitted && io_ring_submit(ring, (unsigned)submitted) != -1) {
+        for (size_t i = 0; i < submitted; i++) {
+            struct io_uring_cqe cqe;
+            if (io_ring_reap(ring, &cqe, 1) != 1)
+                break;
+
+            size_t index = (size_t)(cqe.user_data - OP_UNLINK);
+            if (index >= count)
+                continue;
+
+            /* older kernels reject the opcode, the segment is unlinked below */
+            if (cqe.res == 0) {
+                removed++;
+                done[index] = 1;
+            } else if (cqe.res == -ENOENT) {
+                done[index] = 1;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!done[i] && unlink(paths[i]) == 0)
+            removed++;
+    }
+
+    return removed;
+}
+
+size_t wal_remove(const char *dir, uint64_t last, struct io_ring *ring) {
+    uint64_t *ids;
+    size_t count = list_segments(dir, 0, last, &ids);
+
+    size_t removed = 0;
+    if (io_ring_ready(ring)) {
+        char paths[REMOVE_BATCH][WAL_DIR_LENGTH + 32];
+
+        for (size_t i = 0; i < count; i += REMOVE_BATCH) {
+            size_t batch = (count - i < REMOVE_BATCH) ? count - i : REMOVE_BATCH;
+            for (size_t k = 0; k < batch; k++)
+                snprintf(paths[k], sizeof(paths[k]), WAL_SEGMENT_FORMAT, dir, (unsigned long long)ids[i + k]);
+
+            removed += remove_batch(ring, paths, batch);
+        }
+    }
+
+    for (size_t i = 0; !io_ring_ready(ring) && i < count; i++) {
+        char path[WAL_DIR_LENGTH + 32];
+        snprintf(path, sizeof(path), WAL_SEGMENT_FORMAT, dir, (unsigned long long)ids[i]);
+
+        if (unlink(path) == 0)
+            removed++;
+    }
+
+    if (removed)
+        sync_dir(dir);
+
+    free(ids);
+    return removed;
+}
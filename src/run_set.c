@@ -0,0 +1,584 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/run_set.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#define _GNU_SOURCE
+#include <dirent.h> /* opendir, readdir, closedir, DIR, dirent */
+#include <errno.h> /* errno, ENOENT */
+#include <fcntl.h> /* open, O_RDONLY, O_DIRECTORY, O_CLOEXEC */
+#include <stdio.h> /* fopen, fgets, fprintf, fflush, fclose, fileno, rename, remove, snprintf, sscanf, perror, FILE */
+#include <stdlib.h> /* malloc, calloc, realloc, free */
+#include <string.h> /* memcpy, memset, strcmp, strlen, strncmp, strdup */
+#include <sys/stat.h> /* stat */
+#include <time.h> /* time */
+#include <unistd.h> /* close, fsync, unlink */
+#include "run_set.h"
+#include "activity.h" /* activity, activity_merge, activity_expired */
+#include "snapshot.h" /* snapshot, snapshot_builder, snapshot_add, snapshot_add_op, snapshot_publish, snapshot_clear, snapshot_open, snapshot_close, snapshot_walk, snapshot_ops */
+
+#define QUERY_RETRIES 8 /* times a query reloads the manifest when a run was merged away while opening it */
+#define QUERY_PREFIXES 64 /* paths a query reads separately before reading every path of the older runs */
+
+/**
+ * @brief state of a merge of runs
+ */
+struct merge_state {
+    struct file_table *table; /** > table the runs are merged into */
+    struct snapshot_builder *builder; /** > new run */
+    int keep_ops; /** > set if the operations of the runs are kept for older runs */
+    run_filter *filter; /** > decides which paths are kept */
+    void *arg; /** > argument passed to filter */
+    uint32_t now; /** > minute since the epoch of the merge, older activities are dropped */
+    int failed; /** > set if a path couldnt be merged */
+};
+
+/**
+ * @brief path a query has to read, with every path under it
+ */
+struct prefix {
+    char *path; /** > malloc'ed path, without trailing slash, "" for every path */
+    size_t below; /** > read from the runs with a lower index */
+    size_t covered_below; /** > skipped in the runs with a lower index, a broader path is read there */
+};
+
+/**
+ * @brief paths a query has to read
+ */
+struct prefix_set {
+    struct prefix *items; /** > malloc'ed paths */
+    size_t count; /** > count of paths */
+    size_t cap; /** > paths allocated */
+    int failed; /** > set if a path couldnt be added */
+};
+
+/**
+ * @brief operations of a run, collected to be read backwards
+ */
+struct op_list {
+    const char **from; /** > paths deleted or renamed */
+    const char **to; /** > new paths, NULL for deletes */
+    size_t count; /** > count of operations */
+    size_t cap; /** > operations allocated */
+    int failed; /** > set if an operation couldnt be stored */
+};
+
+/**
+ * @brief state of a query while reading a run
+ */
+struct query_state {
+    struct file_table *out; /** > table the files are added to */
+    const char *prefix; /** > path being read */
+    int failed; /** > set if a file couldnt be added */
+};
+
+static void sync_dir(const char *dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+        return;
+
+    fsync(fd);
+    close(fd);
+}
+
+void run_path(const char *dir, uint64_t id, char *buff) {
+    snprintf(buff, RUN_PATH_LENGTH, RUN_FORMAT, dir, (unsigned long long)id);
+}
+
+int manifest_load(const char *dir, struct manifest *m) {
+    memset(m, 0, sizeof(*m));
+    m->next_id = 1;
+
+    char path[RUN_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s", dir, MANIFEST_NAME);
+
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return (errno == ENOENT) ? 0 : -1;
+
+    int r = 1;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long a, b;
+
+        if (sscanf(line, "segment %llu", &a) == 1) {
+            m->segment = a;
+        } else if (sscanf(line, "next %llu", &a) == 1) {
+            m->next_id = a;
+        } else if (sscanf(line, "run %llx %llu", &a, &b) == 2 && m->count < MAX_RUNS) {
+            m->runs[m->count].id = a;
+            m->runs[m->count].size = b;
+            m->count++;
+        } else {
+            r = -1;
+            break;
+        }
+    }
+
+    fclose(f);
+    return r;
+}
+
+int manifest_save(const char *dir, const struct manifest *m, int sync) {
+    char path[RUN_PATH_LENGTH], tmp_path[RUN_PATH_LENGTH + 4];
+    snprintf(path, sizeof(path), "%s/%s", dir, MANIFEST_NAME);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) {
+        perror("fopen");
+        return 0;
+    }
+
+    fprintf(f, "segment %llu\n", (unsigned long long)m->segment);
+    fprintf(f, "next %llu\n", (unsigned long long)m->next_id);
+    for (size_t i = 0; i < m->count; i++)
+        fprintf(f, "run %016llx %llu\n", (unsigned long long)m->runs[i].id, (unsigned long long)m->runs[i].size);
+
+    int ok = fflush(f) == 0;
+    if (ok && sync && fsync(fileno(f)) == -1)
+        ok = 0;
+
+    if (fclose(f) != 0)
+        ok = 0;
+
+    if (!ok || rename(tmp_path, path) == -1) {
+        perror("manifest");
+        remove(tmp_path);
+        return 0;
+    }
+
+    if (sync)
+        sync_dir(dir);
+
+    return 1;
+}
+
+static int live_run(const struct manifest *m, const char *name) {
+    unsigned long long id;
+    char suffix[8];
+
+    if (strlen(name) != 20 || sscanf(name, "%16llx%7s", &id, suffix) != 2 || strcmp(suffix, ".run") != 0)
+        return 0;
+
+    for (size_t i = 0; i < m->count; i++) {
+        if (m->runs[i].id == id)
+            return 1;
+    }
+
+    return 0;
+}
+
+size_t manifest_clean(const char *dir, const struct manifest *m) {
+    DIR *d = opendir(dir);
+    if (!d)
+        return 0;
+
+    size_t removed = 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        const char *name = entry->d_name;
+        if (name[0] == '.' || strcmp(name, MANIFEST_NAME) == 0 || live_run(m, name))
+            continue;
+
+        char path[RUN_PATH_LENGTH];
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+        if (unlink(path) == 0)
+            removed++;
+    }
+    closedir(d);
+
+    return removed;
+}
+
+unsigned run_class(uint64_t size) {
+    unsigned cls = 0;
+
+    for (uint64_t limit = RUN_CLASS_SIZE; size > limit && limit < UINT64_MAX / RUN_CLASS_FACTOR; limit *= RUN_CLASS_FACTOR)
+        cls++;
+
+    return cls;
+}
+
+/* index of the oldest run of the adjacent runs sharing the class of the run before end */
+static size_t class_start(const struct manifest *m, size_t end) {
+    unsigned cls = run_class(m->runs[end - 1].size);
+
+    size_t start = end - 1;
+    while (start > 0 && run_class(m->runs[start - 1].size) == cls)
+        start--;
+
+    return start;
+}
+
+size_t compaction_pick(const struct manifest *m, size_t *first) {
+    /* full tiers first, newest first, they are the cheapest to merge */
+    for (size_t end = m->count; end > 0;) {
+        size_t start = class_start(m, end);
+        if (end - start >= COMPACT_FANIN) {
+            *first = start;
+            return end - start;
+        }
+
+        end = start;
+    }
+
+    /*
+     * a checkpoint after a busy interval can write a run of a higher class than the runs before it,
+     * those runs would never fill their tier, they are folded into the bigger run after them
+     */
+    for (size_t end = m->count; end > 0;) {
+        size_t start = class_start(m, end);
+        if (end < m->count && run_class(m->runs[end].size) > run_class(m->runs[start].size)) {
+            *first = start;
+            return end - start + 1;
+        }
+
+        end = start;
+    }
+
+    return 0;
+}
+
+static void merge_op(const char *from, const char *to, void *arg) {
+    struct merge_state *state = (struct merge_state *)arg;
+
+    if (to) {
+        movepath(state->table, from, to);
+    } else {
+        delpath(state->table, from);
+    }
+
+    if (state->keep_ops && !snapshot_add_op(state->builder, from, to))
+        state->failed = 1;
+}
+
+/* adds a file read from a run to a table, with its activity */
+static int add_entry(struct file_table *table, const char *path, const struct snapshot_counter *counter,
+                     const struct activity *activity) {
+    if (additem(table, path, counter->opened, counter->modified) == -1)
+        return 0;
+
+    if (!activity)
+        return 1;
+
+    struct activity *dst = addactivity(table, path);
+    if (!dst)
+        return 0;
+
+    activity_merge(dst, activity);
+    return 1;
+}
+
+static void merge_entry(const char *path, size_t len, const struct snapshot_counter *counter,
+                        const struct activity *activity, void *arg) {
+    struct merge_state *state = (struct merge_state *)arg;
+    (void)len;
+
+    if (!add_entry(state->table, path, counter, activity))
+        state->failed = 1;
+}
+
+static void merge_collector(struct file_table *table, struct _file *item, const char *path, size_t len, void *arg) {
+    struct merge_state *state = (struct merge_state *)arg;
+
+    if (state->filter && !state->filter(path, state->arg))
+        return;
+
+    const struct activity *activity = getactivity(table, item);
+    if (activity && activity_expired(activity, state->now))
+        activity = NULL;
+
+    if (!snapshot_add(state->builder, path, len, item->opening, item->modifying, activity))
+        state->failed = 1;
+}
+
+int run_merge(const char *dir, const struct run_info *runs, size_t count, int bottom, uint64_t id,
+              run_filter *filter, void *arg, int sync, uint64_t *size, struct compaction_stats *stats) {
+    struct file_table table = { 0 };
+    struct snapshot_builder builder = { 0 };
+
+    struct merge_state state = {
+        .table = &table,
+        .builder = &builder,
+        .keep_ops = !bottom,
+        .filter = filter,
+        .arg = arg,
+        .now = (uint32_t)(time(NULL) / 60)
+    };
+
+    uint64_t segment = 0, read = 0;
+    for (size_t i = 0; i < count && !state.failed; i++) {
+        char path[RUN_PATH_LENGTH];
+        run_path(dir, runs[i].id, path);
+
+        struct snapshot snap;
+        if (!snapshot_open(&snap, path)) {
+            state.failed = 1;
+            break;
+        }
+
+        /* deletes and renames apply to the older runs, before the counters of their own run are added */
+        snapshot_ops(&snap, merge_op, &state);
+        snapshot_walk(&snap, "", merge_entry, &state);
+
+        segment = snap.header->segment;
+        read += snap.size;
+
+        snapshot_close(&snap);
+    }
+
+    if (!state.failed)
+        walktable(&table, NULL, merge_collector, &state);
+
+    char path[RUN_PATH_LENGTH], tmp_path[RUN_PATH_LENGTH + 4];
+    run_path(dir, id, path);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    int r = !state.failed && snapshot_publish(&builder, path, tmp_path, segment, sync);
+
+    clear_table(&table);
+    snapshot_clear(&builder);
+
+    if (!r)
+        return 0;
+
+    struct stat st;
+    *size = (stat(path, &st) == 0) ? (uint64_t)st.st_size : 0;
+
+    stat_add(&stats->compactions, 1);
+    stat_add(&stats->merged, count);
+    stat_add(&stats->read, read);
+    stat_add(&stats->written, *size);
+
+    return 1;
+}
+
+/* path is prefix itself or a path under it */
+static int under(const char *path, const char *prefix) {
+    size_t len = strlen(prefix);
+
+    return strncmp(path, prefix, len) == 0 && (path[len] == '\0' || path[len] == '/' || len == 0);
+}
+
+/* adds head followed by tail for the runs below a run, unless a path already in the set covers it */
+static void prefix_add(struct prefix_set *set, const char *head, const char *tail, size_t below) {
+    size_t head_len = strlen(head), tail_len = strlen(tail);
+
+    char *item = (char *)malloc(head_len + tail_len + 1);
+    if (!item) {
+        set->failed = 1;
+        return;
+    }
+
+    memcpy(item, head, head_len);
+    memcpy(item + head_len, tail, tail_len + 1);
+
+    /* renames can double the set on every run, past a point reading the whole runs is cheaper */
+    if (set->count >= QUERY_PREFIXES)
+        item[0] = '\0';
+
+    /* the paths already in the set are read from every run the new one is */
+    for (size_t i = 0; i < set->count; i++) {
+        if (under(item, set->items[i].path)) {
+            free(item);
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < set->count; i++) {
+        if (under(set->items[i].path, item) && set->items[i].covered_below < below)
+            set->items[i].covered_below = below;
+    }
+
+    if (set->count == set->cap) {
+        size_t new_cap = set->cap ? set->cap * 2 : 8;
+        struct prefix *tmp = (struct prefix *)realloc(set->items, sizeof(struct prefix) * new_cap);
+        if (!tmp) {
+            free(item);
+            set->failed = 1;
+            return;
+        }
+
+        set->items = tmp;
+        set->cap = new_cap;
+    }
+
+    set->items[set->count].path = item;
+    set->items[set->count].below = below;
+    set->items[set->count].covered_below = 0;
+    set->count++;
+}
+
+static void collect_op(const char *from, const char *to, void *arg) {
+    struct op_list *list = (struct op_list *)arg;
+
+    if (list->failed)
+        return;
+
+    if (list->count == list->cap) {
+        size_t new_cap = list->cap ? list->cap * 2 : 16;
+        const char **from_tmp = (const char **)realloc(list->from, sizeof(char *) * new_cap);
+        if (from_tmp)
+            list->from = from_tmp;
+
+        const char **to_tmp = from_tmp ? (const char **)realloc(list->to, sizeof(char *) * new_cap) : NULL;
+        if (to_tmp)
+            list->to = to_tmp;
+
+        if (!from_tmp || !to_tmp) {
+            list->failed = 1;
+            return;
+        }
+
+        list->cap = new_cap;
+    }
+
+    list->from[list->count] = from;
+    list->to[list->count] = to;
+    list->count++;
+}
+
+static void apply_op(const char *from, const char *to, void *arg) {
+    struct file_table *out = (struct file_table *)arg;
+
+    if (to) {
+        movepath(out, from, to);
+    } else {
+        delpath(out, from);
+    }
+}
+
+static void query_entry(const char *path, size_t len, const struct snapshot_counter *counter,
+                        const struct activity *activity, void *arg) {
+    struct query_state *state = (struct query_state *)arg;
+    (void)len;
+
+    /* the walk also returns the siblings sharing the prefix, like 'dir.old' for 'dir' */
+    if (!under(path, state->prefix))
+        return;
+
+    if (!add_entry(state->out, path, counter, activity))
+        state->failed = 1;
+}
+
+/* maps every run of the manifest, reloading it if a run was merged away in between */
+static size_t open_runs(const char *dir, struct snapshot *snaps) {
+    for (int attempt = 0; attempt < QUERY_RETRIES; attempt++) {
+        struct manifest m;
+        int r = manifest_load(dir, &m);
+        if (r <= 0)
+            return 0;
+
+        size_t opened = 0;
+        while (opened < m.count) {
+            char path[RUN_PATH_LENGTH];
+            run_path(dir, m.runs[opened].id, path);
+
+            if (!snapshot_open(&snaps[opened], path))
+                break;
+
+            opened++;
+        }
+
+        if (opened == m.count)
+            return opened;
+
+        for (size_t i = 0; i < opened; i++)
+            snapshot_close(&snaps[i]);
+    }
+
+    return 0;
+}
+
+int run_set_query(const char *dir, const char *path, struct file_table *out, size_t *runs) {
+    struct snapshot *snaps = (struct snapshot *)calloc(MAX_RUNS, sizeof(struct snapshot));
+    if (!snaps) {
+        perror("calloc");
+        return 0;
+    }
+
+    size_t count = open_runs(dir, snaps);
+    *runs = count;
+
+    struct prefix_set set = { 0 };
+    prefix_add(&set, path, "", count);
+
+    /*
+     * newest run first: the paths renamed into the ones needed by a run
+     * must be read from the runs older than it as well
+     */
+    for (size_t i = count; i-- > 0 && !set.failed;) {
+        struct op_list ops = { 0 };
+        snapshot_ops(&snaps[i], collect_op, &ops);
+        if (ops.failed)
+            set.failed = 1;
+
+        for (size_t k = ops.count; k-- > 0 && !set.failed;) {
+            const char *from = ops.from[k], *to = ops.to[k];
+            if (!to)
+                continue;
+
+            size_t current = set.count;
+            for (size_t j = 0; j < current; j++) {
+                const char *item = set.items[j].path;
+
+                if (under(item, to)) {
+                    prefix_add(&set, from, item + strlen(to), i);
+                } else if (under(to, item)) {
+                    prefix_add(&set, from, "", i);
+                }
+            }
+        }
+
+        free(ops.from);
+        free(ops.to);
+    }
+
+    /* oldest run first, each run applies its operations to the files of the older ones */
+    struct query_state state = { .out = out };
+    for (size_t i = 0; i < count && !set.failed && !state.failed; i++) {
+        snapshot_ops(&snaps[i], apply_op, out);
+
+        for (size_t j = 0; j < set.count; j++) {
+            const struct prefix *item = &set.items[j];
+            if (i >= item->below || i < item->covered_below)
+                continue;
+
+            state.prefix = item->path;
+            snapshot_walk(&snaps[i], item->path, query_entry, &state);
+        }
+    }
+
+    int r = !set.failed && !state.failed;
+
+    for (size_t i = 0; i < set.count; i++)
+        free(set.items[i].path);
+    free(set.items);
+
+    for (size_t i = 0; i < count; i++)
+        snapshot_close(&snaps[i]);
+    free(snaps);
+
+    return r;
+}
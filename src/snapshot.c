@@ -0,0 +1,475 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/src/snapshot.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#define _GNU_SOURCE
+#include <fcntl.h> /* open, O_RDONLY, O_CLOEXEC */
+#include <stddef.h> /* offsetof */
+#include <stdio.h> /* fopen, fwrite, fflush, fclose, fileno, setvbuf, rename, remove, perror, FILE */
+#include <stdint.h> /* SIZE_MAX */
+#include <stdlib.h> /* malloc, calloc, realloc, free, qsort_r */
+#include <string.h> /* memcpy, memcmp, memset, strcmp, strlen, strncmp */
+#include <sys/mman.h> /* mmap, munmap, madvise, MAP_FAILED, MADV_RANDOM */
+#include <sys/stat.h> /* fstat, stat */
+#include <unistd.h> /* close, fsync */
+#include "snapshot.h"
+
+#define WRITE_BUFF_SIZE (1U << 20) /* stdio buffer of the file being written */
+
+static int reserve_strings(struct snapshot_builder *builder, size_t size) {
+    if (builder->used + size <= builder->cap)
+        return 1;
+
+    size_t new_cap = builder->cap ? builder->cap : 65536;
+    while (new_cap < builder->used + size)
+        new_cap *= 2;
+
+    char *tmp = (char *)realloc(builder->strings, new_cap);
+    if (!tmp) {
+        perror("realloc");
+        return 0;
+    }
+
+    builder->strings = tmp;
+    builder->cap = new_cap;
+    return 1;
+}
+
+/* copies a path into the strings of a builder, its offset is stored in offset */
+static int add_string(struct snapshot_builder *builder, const char *path, size_t len, size_t *offset) {
+    if (!reserve_strings(builder, len + 1))
+        return 0;
+
+    *offset = builder->used;
+    memcpy(builder->strings + builder->used, path, len);
+    builder->strings[builder->used + len] = '\0';
+    builder->used += len + 1;
+
+    return 1;
+}
+
+/* copies an activity into a builder, its index is stored in index */
+static int add_activity(struct snapshot_builder *builder, const struct activity *activity, size_t *index) {
+    if (builder->activity_count == builder->activity_cap) {
+        size_t new_cap = builder->activity_cap ? builder->activity_cap * 2 : 256;
+        struct activity *tmp = (struct activity *)realloc(builder->activities, sizeof(struct activity) * new_cap);
+        if (!tmp) {
+            perror("realloc");
+            return 0;
+        }
+
+        builder->activities = tmp;
+        builder->activity_cap = new_cap;
+    }
+
+    *index = builder->activity_count;
+    builder->activities[builder->activity_count++] = *activity;
+
+    return 1;
+}
+
+int snapshot_add(struct snapshot_builder *builder, const char *path, size_t len, uint32_t opened, uint32_t modified,
+                 const struct activity *activity) {
+    if (builder->failed)
+        return 0;
+
+    if (builder->count == builder->entries_cap) {
+        size_t new_cap = builder->entries_cap ? builder->entries_cap * 2 : 1024;
+        struct snapshot_entry *tmp = (struct snapshot_entry *)realloc(builder->entries, sizeof(struct snapshot_entry) * new_cap);
+        if (!tmp) {
+            perror("realloc");
+            builder->failed = 1;
+            return 0;
+        }
+
+        builder->entries = tmp;
+        builder->entries_cap = new_cap;
+    }
+
+    size_t offset, index = SIZE_MAX;
+    if (!add_string(builder, path, len, &offset) || (activity && !add_activity(builder, activity, &index))) {
+        builder->failed = 1;
+        return 0;
+    }
+
+    struct snapshot_entry *entry = &builder->entries[builder->count++];
+    entry->path = offset;
+    entry->counter.opened = opened;
+    entry->counter.modified = modified;
+    entry->activity = index;
+
+    return 1;
+}
+
+int snapshot_add_op(struct snapshot_builder *builder, const char *from, const char *to) {
+    if (builder->failed)
+        return 0;
+
+    if (builder->ops_count == builder->ops_cap) {
+        size_t new_cap = builder->ops_cap ? builder->ops_cap * 2 : 64;
+        struct snapshot_op *tmp = (struct snapshot_op *)realloc(builder->ops, sizeof(struct snapshot_op) * new_cap);
+        if (!tmp) {
+            perror("realloc");
+            builder->failed = 1;
+            return 0;
+        }
+
+        builder->ops = tmp;
+        builder->ops_cap = new_cap;
+    }
+
+    struct snapshot_op *op = &builder->ops[builder->ops_count];
+    memset(op, 0, sizeof(*op));
+    op->type = to ? SNAPSHOT_MOVE : SNAPSHOT_DELETE;
+
+    size_t from_offset, to_offset = 0;
+    if (!add_string(builder, from, strlen(from), &from_offset) ||
+        (to && !add_string(builder, to, strlen(to), &to_offset))) {
+        builder->failed = 1;
+        return 0;
+    }
+
+    op->from = from_offset;
+    op->to = to_offset;
+    builder->ops_count++;
+
+    return 1;
+}
+
+static int compare_entries(const void *a, const void *b, void *arg) {
+    const char *strings = (const char *)arg;
+
+    return strcmp(strings + ((const struct snapshot_entry *)a)->path,
+                  strings + ((const struct snapshot_entry *)b)->path);
+}
+
+int snapshot_publish(struct snapshot_builder *builder, const char *path, const char *tmp_path, uint64_t segment, int sync) {
+    if (builder->failed)
+        return 0;
+
+    qsort_r(builder->entries, builder->count, sizeof(struct snapshot_entry), compare_entries, builder->strings);
+
+    uint64_t blocks = (builder->count + SNAPSHOT_BLOCK_ENTRIES - 1) / SNAPSHOT_BLOCK_ENTRIES;
+
+    struct snapshot_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+    header.version = SNAPSHOT_VERSION;
+    header.block_entries = SNAPSHOT_BLOCK_ENTRIES;
+    header.count = builder->count;
+    header.segment = segment;
+    header.counters_offset = sizeof(header);
+    header.index_offset = header.counters_offset + builder->count * sizeof(struct snapshot_counter);
+    header.ops_offset = header.index_offset + blocks * sizeof(uint64_t);
+    header.ops_count = builder->ops_count;
+    header.activity_offset = header.ops_offset + builder->ops_count * sizeof(struct snapshot_op);
+    header.activity_count = builder->activity_count;
+    header.strings_offset = header.activity_offset + builder->activity_count * sizeof(struct snapshot_activity);
+
+    uint64_t *index = (uint64_t *)malloc(sizeof(uint64_t) * (blocks ? blocks : 1));
+    struct snapshot_op *ops = (struct snapshot_op *)calloc(builder->ops_count ? builder->ops_count : 1, sizeof(struct snapshot_op));
+    if (!index || !ops) {
+        perror("malloc");
+        free(index);
+        free(ops);
+        return 0;
+    }
+
+    uint64_t offset = 0;
+    for (size_t i = 0; i < builder->count; i++) {
+        if (i % SNAPSHOT_BLOCK_ENTRIES == 0)
+            index[i / SNAPSHOT_BLOCK_ENTRIES] = offset;
+
+        offset += strlen(builder->strings + builder->entries[i].path) + 1;
+    }
+
+    /* the paths of the operations follow the sorted paths, in the order of the operations */
+    for (size_t i = 0; i < builder->ops_count; i++) {
+        const struct snapshot_op *op = &builder->ops[i];
+
+        ops[i].type = op->type;
+        ops[i].from = offset;
+        offset += strlen(builder->strings + op->from) + 1;
+
+        if (op->type == SNAPSHOT_MOVE) {
+            ops[i].to = offset;
+            offset += strlen(builder->strings + op->to) + 1;
+        }
+    }
+    header.strings_size = offset;
+
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) {
+        perror("fopen");
+        free(index);
+        free(ops);
+        return 0;
+    }
+    setvbuf(f, NULL, _IOFBF, WRITE_BUFF_SIZE);
+
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+    for (size_t i = 0; ok && i < builder->count; i++)
+        ok = fwrite(&builder->entries[i].counter, sizeof(struct snapshot_counter), 1, f) == 1;
+
+    if (ok && blocks)
+        ok = fwrite(index, sizeof(uint64_t), blocks, f) == blocks;
+
+    if (ok && builder->ops_count)
+        ok = fwrite(ops, sizeof(struct snapshot_op), builder->ops_count, f) == builder->ops_count;
+
+    /* the entries are sorted by now, their activities are written in the same order */
+    for (size_t i = 0; ok && i < builder->count; i++) {
+        if (builder->entries[i].activity == SIZE_MAX)
+            continue;
+
+        struct snapshot_activity record;
+        memset(&record, 0, sizeof(record));
+        record.entry = i;
+        record.activity = builder->activities[builder->entries[i].activity];
+
+        ok = fwrite(&record, sizeof(record), 1, f) == 1;
+    }
+
+    for (size_t i = 0; ok && i < builder->count; i++) {
+        const char *p = builder->strings + builder->entries[i].path;
+        ok = fwrite(p, strlen(p) + 1, 1, f) == 1;
+    }
+
+    for (size_t i = 0; ok && i < builder->ops_count; i++) {
+        const struct snapshot_op *op = &builder->ops[i];
+        const char *from = builder->strings + op->from;
+
+        ok = fwrite(from, strlen(from) + 1, 1, f) == 1;
+        if (ok && op->type == SNAPSHOT_MOVE) {
+            const char *to = builder->strings + op->to;
+            ok = fwrite(to, strlen(to) + 1, 1, f) == 1;
+        }
+    }
+
+    free(index);
+    free(ops);
+
+    if (ok && fflush(f) != 0)
+        ok = 0;
+
+    if (ok && sync && fsync(fileno(f)) == -1)
+        ok = 0;
+
+    if (fclose(f) != 0)
+        ok = 0;
+
+    if (!ok || rename(tmp_path, path) == -1) {
+        perror("snapshot");
+        remove(tmp_path);
+        return 0;
+    }
+
+    return 1;
+}
+
+void snapshot_clear(struct snapshot_builder *builder) {
+    free(builder->strings);
+    free(builder->entries);
+    free(builder->ops);
+    free(builder->activities);
+    memset(builder, 0, sizeof(*builder));
+}
+
+/* every section must lie inside the file, and the last path must be terminated */
+static int valid_header(const struct snapshot_header *header, size_t size, uint64_t *blocks) {
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) != 0 ||
+        header->version < SNAPSHOT_MIN_VERSION ||
+        header->version > SNAPSHOT_VERSION ||
+        header->block_entries == 0)
+        return 0;
+
+    /* version 2 headers end before the activity fields, the counters start there */
+    if (header->version >= SNAPSHOT_ACTIVITY_VERSION &&
+        (size < sizeof(struct snapshot_header) ||
+         header->activity_offset % sizeof(uint64_t) != 0 ||
+         header->activity_offset > size ||
+         header->activity_count > size / sizeof(struct snapshot_activity) ||
+         header->activity_count * sizeof(struct snapshot_activity) > size - header->activity_offset))
+        return 0;
+
+    uint64_t count = header->count;
+    *blocks = (count + header->block_entries - 1) / header->block_entries;
+
+    if (count > size / sizeof(struct snapshot_counter) ||
+        header->counters_offset % sizeof(uint32_t) != 0 ||
+        header->counters_offset > size ||
+        count * sizeof(struct snapshot_counter) > size - header->counters_offset)
+        return 0;
+
+    if (header->index_offset % sizeof(uint64_t) != 0 ||
+        header->index_offset > size ||
+        *blocks * sizeof(uint64_t) > size - header->index_offset)
+        return 0;
+
+    if (header->ops_offset % sizeof(uint64_t) != 0 ||
+        header->ops_offset > size ||
+        header->ops_count > size / sizeof(struct snapshot_op) ||
+        header->ops_count * sizeof(struct snapshot_op) > size - header->ops_offset)
+        return 0;
+
+    if (header->strings_offset > size || header->strings_size > size - header->strings_offset)
+        return 0;
+
+    return (count == 0 && header->ops_count == 0) || header->strings_size != 0;
+}
+
+int snapshot_open(struct snapshot *snap, const char *path) {
+    memset(snap, 0, sizeof(*snap));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < offsetof(struct snapshot_header, activity_offset)) {
+        close(fd);
+        return 0;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return 0;
+
+    /* lookups jump around the file, reading ahead would fault in pages never used */
+    madvise(map, (size_t)st.st_size, MADV_RANDOM);
+
+    snap->map = (const unsigned char *)map;
+    snap->size = (size_t)st.st_size;
+    snap->header = (const struct snapshot_header *)map;
+
+    if (!valid_header(snap->header, snap->size, &snap->blocks)) {
+        snapshot_close(snap);
+        return 0;
+    }
+
+    snap->counters = (const struct snapshot_counter *)(snap->map + snap->header->counters_offset);
+    snap->index = (const uint64_t *)(snap->map + snap->header->index_offset);
+    snap->strings = (const char *)(snap->map + snap->header->strings_offset);
+    snap->ops = (const struct snapshot_op *)(snap->map + snap->header->ops_offset);
+
+    if (snap->header->version >= SNAPSHOT_ACTIVITY_VERSION) {
+        snap->activities = (const struct snapshot_activity *)(snap->map + snap->header->activity_offset);
+        snap->activity_count = snap->header->activity_count;
+    }
+
+    if (snap->header->strings_size && snap->strings[snap->header->strings_size - 1] != '\0') {
+        snapshot_close(snap);
+        return 0;
+    }
+
+    return 1;
+}
+
+void snapshot_close(struct snapshot *snap) {
+    if (snap->map)
+        munmap((void *)snap->map, snap->size);
+
+    memset(snap, 0, sizeof(*snap));
+}
+
+size_t snapshot_walk(const struct snapshot *snap, const char *prefix, snapshot_handler *handler, void *arg) {
+    uint64_t count = snap->header->count;
+    uint64_t strings_size = snap->header->strings_size;
+    size_t prefix_len = strlen(prefix);
+
+    /* first block whose first path is not lower than the prefix, the first match can be in the block before */
+    uint64_t lo = 0, hi = snap->blocks;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (snap->index[mid] >= strings_size)
+            return 0;
+
+        if (strcmp(snap->strings + snap->index[mid], prefix) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    uint64_t block = lo ? lo - 1 : 0;
+    if (block >= snap->blocks)
+        return 0;
+
+    uint64_t n = block * snap->header->block_entries;
+    uint64_t offset = snap->index[block];
+
+    /* first activity of the block, the next ones are reached while scanning */
+    uint64_t a_lo = 0, a_hi = snap->activity_count;
+    while (a_lo < a_hi) {
+        uint64_t mid = a_lo + (a_hi - a_lo) / 2;
+        if (snap->activities[mid].entry < n) {
+            a_lo = mid + 1;
+        } else {
+            a_hi = mid;
+        }
+    }
+
+    size_t found = 0;
+    while (n < count && offset < strings_size) {
+        const char *path = snap->strings + offset;
+        size_t len = strlen(path);
+
+        int cmp = strncmp(path, prefix, prefix_len);
+        if (cmp > 0)
+            break;
+
+        while (a_lo < snap->activity_count && snap->activities[a_lo].entry < n)
+            a_lo++;
+
+        if (cmp == 0) {
+            const struct activity *activity = NULL;
+            if (a_lo < snap->activity_count && snap->activities[a_lo].entry == n)
+                activity = &snap->activities[a_lo].activity;
+
+            handler(path, len, &snap->counters[n], activity, arg);
+            found++;
+        }
+
+        offset += len + 1;
+        n++;
+    }
+
+    return found;
+}
+
+size_t snapshot_ops(const struct snapshot *snap, snapshot_op_handler *handler, void *arg) {
+    uint64_t strings_size = snap->header->strings_size;
+
+    for (uint64_t i = 0; i < snap->header->ops_count; i++) {
+        const struct snapshot_op *op = &snap->ops[i];
+        if (op->from >= strings_size || (op->type == SNAPSHOT_MOVE && op->to >= strings_size))
+            return i;
+
+        const char *to = (op->type == SNAPSHOT_MOVE) ? snap->strings + op->to : NULL;
+        handler(snap->strings + op->from, to, arg);
+    }
+
+    return snap->header->ops_count;
+}
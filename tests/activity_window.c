@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/tests/activity_window.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * checks the windowed sums of activity_window against events placed around the edges of the windows
+ *  
+ * every window must count each event inside it, and may only count events before it
+ * that share the bucket holding its oldest minute
+ *  
+ * exits with EXIT_FAILURE if any sum is wrong
+ */
+
+#include <stdio.h> /* printf, fprintf */
+#include <stdlib.h> /* EXIT_SUCCESS, EXIT_FAILURE */
+#include <stdint.h> /* uint32_t, uint64_t */
+#include <string.h> /* memset */
+#include "activity.h" /* activity, activity_add, activity_merge, activity_expired, activity_window, ACTIVITY_MAX_WINDOW */
+
+#define HOUR 60U /* minutes of an hour */
+#define DAY 1440U /* minutes of a day */
+#define BASE (29000000U / DAY * DAY) /* midnight of a day in 2025, in minutes since the epoch */
+
+static int failures = 0; /* checks that failed */
+
+/* compares the modifications summed for a window with the expected ones */
+static void check(const char *name, const struct activity *a, uint32_t now, uint32_t window, uint64_t expected) {
+    uint64_t opened, modified;
+    activity_window(a, now, window, &opened, &modified);
+
+    if (modified != expected || opened != modified) {
+        fprintf(stderr, "%s: window of %u minutes summed %llu, %llu expected.\n",
+                name, window, (unsigned long long)modified, (unsigned long long)expected);
+        failures++;
+    }
+}
+
+/* adds count events ago minutes before now */
+static void add(struct activity *a, uint32_t now, uint32_t ago, uint32_t count) {
+    activity_add(a, now - ago, count, count);
+}
+
+int main(void) {
+    struct activity a;
+    uint32_t now = BASE + 10 * HOUR + 5; /* 10:05, not on any bucket boundary */
+
+    /* minute ring, exact at both ends */
+    memset(&a, 0, sizeof(a));
+    add(&a, now, 0, 1);
+    add(&a, now, 59, 2);
+    add(&a, now, 60, 4);
+    check("minutes", &a, now, 1, 1);
+    check("minutes", &a, now, 59, 1);
+    check("minutes", &a, now, 60, 3);
+    check("minutes", &a, now, 61, 7);
+
+    /* hour ring, a window past 09:00 at 10:05 must reach back to its oldest minute */
+    memset(&a, 0, sizeof(a));
+    add(&a, now, 100, 7);
+    add(&a, now, 1, 1);
+    check("two hours", &a, now, 120, 8);
+    check("90 minutes", &a, now, 90, 8);
+    check("65 minutes", &a, now, 65, 1);
+    check("100 minutes", &a, now, 101, 8);
+
+    /* the bucket of the oldest minute is counted whole, the one before it is not */
+    memset(&a, 0, sizeof(a));
+    add(&a, now, 5 + 2 * HOUR, 1); /* 08:00 */
+    add(&a, now, 6 + 2 * HOUR, 2); /* 07:59 */
+    check("rounded", &a, now, 90, 1);
+    check("rounded", &a, now, 125, 1);
+    check("rounded", &a, now, 127, 3);
+
+    /* a whole day back from 10:05 needs the hour ring to hold 25 buckets */
+    memset(&a, 0, sizeof(a));
+    add(&a, now, DAY - 1, 5);
+    add(&a, now, DAY + HOUR, 6);
+    add(&a, now, 30, 1);
+    check("day", &a, now, DAY, 6);
+    check("day", &a, now, DAY + 2 * HOUR, 12);
+
+    /* the longest window covers a whole week back, past the day its oldest minute falls in */
+    memset(&a, 0, sizeof(a));
+    add(&a, now, ACTIVITY_MAX_WINDOW - 1, 3);
+    add(&a, now, ACTIVITY_MAX_WINDOW + DAY, 9);
+    add(&a, now, 0, 1);
+    check("week", &a, now, ACTIVITY_MAX_WINDOW, 4);
+    check("week", &a, now, 2 * ACTIVITY_MAX_WINDOW, 4);
+
+    /* the rings move with now even without new events */
+    memset(&a, 0, sizeof(a));
+    add(&a, now, 0, 1);
+    check("idle", &a, now + HOUR, HOUR, 0);
+    check("idle", &a, now + HOUR, HOUR + 1, 1);
+    check("idle", &a, now + 3 * DAY, 2 * DAY, 0);
+    check("idle", &a, now + 3 * DAY, 3 * DAY, 1);
+
+    /* late events and merges land in the buckets of their own minute */
+    struct activity b;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    add(&a, now, 10, 2);
+    add(&b, now, 0, 3);
+    add(&b, now, 200, 4);
+    activity_merge(&b, &a);
+    check("merged", &b, now, 11, 5);
+    check("merged", &b, now, 201, 9);
+
+    /* an activity is only dropped once its newest event left the longest window */
+    memset(&a, 0, sizeof(a));
+    add(&a, now, 0, 1);
+    if (activity_expired(&a, now + ACTIVITY_MAX_WINDOW - 1) || !activity_expired(&a, now + ACTIVITY_MAX_WINDOW + DAY)) {
+        fprintf(stderr, "expired: activity dropped at the wrong time.\n");
+        failures++;
+    }
+
+    if (failures)
+        return EXIT_FAILURE;
+
+    printf("Every window summed as expected.\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,234 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/tests/alloc_events.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * counts the heap allocations of the event hot path of file-listener
+ *  
+ * the listener is built into this program so its static functions can be called,
+ * FID records are built for the files of a scratch directory tree and run through
+ * handle_event(), path cache and file table included, once to warm them up and then
+ * EVENT_COUNT more times while malloc, calloc and realloc are counted
+ *  
+ * every case of test_cases is run, from a single hot directory to many interleaved ones
+ *  
+ * open_by_handle_at() needs CAP_DAC_READ_SEARCH, run it as root
+ * exits with EXIT_FAILURE if any allocation happened in steady state
+ */
+
+#define main file_listener_main
+#include "../src/listener/file_listener.c"
+#undef main
+
+#define EVENT_COUNT 1000000UL /* events counted after the warm up */
+#define TEST_GROUP 1U /* id of the fake fanotify group */
+
+/* shape of the scratch tree of a case */
+struct test_case {
+    size_t dirs; /* directories of the scratch tree */
+    size_t files; /* file names reported inside each directory */
+};
+
+static const struct test_case test_cases[] = {
+    { 1, 1 }, /* a single file, every lookup hits the same entries */
+    { 1, 4096 }, /* a single hot directory, the path cache holds one entry */
+    { 64, 64 } /* interleaved directories */
+};
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static atomic_int counting; /* set while the allocations are counted */
+static atomic_ulong allocations; /* allocations seen while counting */
+
+void *malloc(size_t size) {
+    if (atomic_load_explicit(&counting, memory_order_relaxed))
+        atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    if (atomic_load_explicit(&counting, memory_order_relaxed))
+        atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (atomic_load_explicit(&counting, memory_order_relaxed))
+        atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+
+    return __libc_realloc(ptr, size);
+}
+
+/* builds the record of an event on name inside the directory dir, NULL if failed */
+static struct event_record *make_record(const char *dir, const char *name, uint32_t mask) {
+    unsigned char storage[sizeof(struct file_handle) + MAX_HANDLE_SZ];
+    struct file_handle *handle = (struct file_handle *)storage;
+    handle->handle_bytes = MAX_HANDLE_SZ;
+
+    int mount_id;
+    if (name_to_handle_at(AT_FDCWD, dir, handle, &mount_id, 0) == -1) {
+        perror("name_to_handle_at");
+        return NULL;
+    }
+
+    /* info header, fsid, handle and name, padded like the kernel pads them */
+    size_t name_len = strlen(name) + 1;
+    size_t info_len = sizeof(struct fanotify_event_info_fid) + sizeof(struct file_handle) + handle->handle_bytes + name_len;
+    info_len = (info_len + 7) & ~(size_t)7;
+
+    struct event_record *record = (struct event_record *)calloc(1, sizeof(struct event_record) + info_len);
+    if (!record) {
+        perror("calloc");
+        return NULL;
+    }
+
+    record->mask = mask;
+    record->fd = -1;
+    record->group = TEST_GROUP;
+    record->info_len = (uint32_t)info_len;
+
+    struct fanotify_event_info_fid *fid = (struct fanotify_event_info_fid *)record->info;
+    fid->hdr.info_type = FAN_EVENT_INFO_TYPE_DFID_NAME;
+    fid->hdr.len = (uint16_t)info_len;
+
+    unsigned char *p = (unsigned char *)fid->handle;
+    memcpy(p, handle, sizeof(struct file_handle) + handle->handle_bytes);
+    memcpy(p + sizeof(struct file_handle) + handle->handle_bytes, name, name_len);
+
+    return record;
+}
+
+/* runs a case, the allocations counted are stored in found, returns 0 if the case couldnt be set up */
+static int run_case(const struct test_case *tc, unsigned long *found) {
+    char root[] = "/tmp/alloc_events.XXXXXX";
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        return 0;
+    }
+
+    static struct fan_group group;
+    memset(&group, 0, sizeof(group));
+    group.id = TEST_GROUP;
+    group.mode = MODE_FID;
+    group.dirents = 1;
+    group.mount_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    groups[TEST_GROUP % MAX_GROUPS] = &group;
+
+    struct worker *w = (struct worker *)calloc(1, sizeof(struct worker));
+    size_t count = tc->dirs * tc->files;
+    struct event_record **records = (struct event_record **)calloc(count, sizeof(struct event_record *));
+    if (!w || !records || group.mount_fd == -1) {
+        perror("setup");
+        return 0;
+    }
+
+    workers = w;
+    worker_count = 1;
+    path_cache_init(&w->dir_cache, cache_size);
+
+    int ok = 1;
+    for (size_t d = 0; ok && d < tc->dirs; d++) {
+        char dir[PATH_LENGTH];
+        snprintf(dir, sizeof(dir), "%s/dir%zu", root, d);
+        if (mkdir(dir, 0700) == -1) {
+            perror("mkdir");
+            ok = 0;
+            break;
+        }
+
+        for (size_t f = 0; f < tc->files; f++) {
+            char name[32];
+            snprintf(name, sizeof(name), "file%zu", f);
+
+            /* openings and modifications alternate, both counters are updated */
+            records[d * tc->files + f] = make_record(dir, name, (f % 2) ? FAN_MODIFY : FAN_OPEN);
+            if (!records[d * tc->files + f]) {
+                ok = 0;
+                break;
+            }
+        }
+    }
+
+    /* every path is added and every directory cached once */
+    for (size_t i = 0; ok && i < count; i++)
+        handle_event(w, records[i]);
+
+    if (ok && w->table.count != count) {
+        fprintf(stderr, "Warm up tracked %zu files out of %zu, are you root?\n", (size_t)w->table.count, count);
+        ok = 0;
+    }
+
+    if (ok) {
+        atomic_store(&allocations, 0);
+        atomic_store(&counting, 1);
+
+        /* strided so consecutive events hit other directories, like an interleaved workload */
+        for (unsigned long i = 0; i < EVENT_COUNT; i++)
+            handle_event(w, records[(i * 97) % count]);
+
+        atomic_store(&counting, 0);
+        *found = atomic_load(&allocations);
+    }
+
+    for (size_t i = 0; i < count; i++)
+        free(records[i]);
+    free(records);
+
+    for (size_t d = 0; d < tc->dirs; d++) {
+        char dir[PATH_LENGTH];
+        snprintf(dir, sizeof(dir), "%s/dir%zu", root, d);
+        rmdir(dir);
+    }
+    rmdir(root);
+
+    clear_table(&w->table);
+    path_cache_clear(&w->dir_cache);
+    close(group.mount_fd);
+    groups[TEST_GROUP % MAX_GROUPS] = NULL;
+    workers = NULL;
+    worker_count = 0;
+    free(w);
+
+    return ok;
+}
+
+int main(void) {
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(test_cases) / sizeof(test_cases[0]); i++) {
+        const struct test_case *tc = &test_cases[i];
+
+        unsigned long found = 0;
+        if (!run_case(tc, &found))
+            return EXIT_FAILURE;
+
+        printf("%lu allocations per %lu events, %zu files in %zu directories.\n", found, EVENT_COUNT, tc->dirs * tc->files, tc->dirs);
+        if (found)
+            failed = 1;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+/*
+Copyright (c) 2025, Sam  https://github.com/SamKerubin/fview/blob/main/tests/compaction_pick.c
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * drives compaction_pick with checkpoint runs of mixed sizes
+ *  
+ * every checkpoint appends a run, then the runs picked are spliced into a single one
+ * the way the compactor does it, until nothing is picked; the manifest must be left
+ * with its classes ordered from the biggest to the smallest run and fewer than
+ * COMPACT_FANIN runs in each class, so it never grows past a few runs per class
+ *  
+ * exits with EXIT_FAILURE if a manifest is left unordered or fills up
+ */
+
+#include <stdio.h> /* printf, fprintf */
+#include <stdlib.h> /* EXIT_SUCCESS, EXIT_FAILURE */
+#include <stdint.h> /* uint64_t */
+#include <string.h> /* memset, memmove */
+#include "run_set.h" /* manifest, run_info, run_class, compaction_pick, MAX_RUNS, COMPACT_FANIN */
+
+#define CHECKPOINTS 100000 /* runs appended by each case */
+#define SMALL_RUN (100ULL << 10) /* run written after a quiet interval */
+#define BIG_RUN (3ULL << 20) /* run written after a busy interval, a class above the small ones */
+
+/* sizes of the runs of a case */
+struct test_case {
+    const char *name; /* printed with the result */
+    unsigned big_percent; /* checkpoints writing a big run */
+    unsigned shrink_percent; /* bytes dropped by each merge, deletes and renames cancelling counters */
+};
+
+static const struct test_case test_cases[] = {
+    { "small runs only", 0, 0 },
+    { "10% big runs", 10, 0 },
+    { "50% big runs", 50, 0 },
+    { "10% big runs, merges shrinking", 10, 30 }
+};
+
+static uint64_t seed = 88172645463325252ULL; /* state of the generator, fixed so runs repeat */
+
+/* xorshift, the runs only need to be mixed, not random */
+static uint64_t next_random(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+/* the picked runs are replaced by the merged one, like the compactor splices it */
+static void splice(struct manifest *m, size_t first, size_t count, unsigned shrink_percent) {
+    uint64_t size = 0;
+    for (size_t i = first; i < first + count; i++)
+        size += m->runs[i].size;
+
+    size -= size / 100 * (next_random() % (shrink_percent + 1));
+
+    m->runs[first].id = m->next_id++;
+    m->runs[first].size = size ? size : 1;
+    memmove(&m->runs[first + 1], &m->runs[first + count], sizeof(struct run_info) * (m->count - first - count));
+    m->count -= count - 1;
+}
+
+/* classes never grow towards the newest run, and no class holds a full tier */
+static int settled(const struct manifest *m) {
+    size_t same = 1;
+    for (size_t i = 1; i < m->count; i++) {
+        unsigned older = run_class(m->runs[i - 1].size), newer = run_class(m->runs[i].size);
+        if (newer > older)
+            return 0;
+
+        same = (newer == older) ? same + 1 : 1;
+        if (same >= COMPACT_FANIN)
+            return 0;
+    }
+
+    return 1;
+}
+
+static int run_case(const struct test_case *tc) {
+    struct manifest m;
+    memset(&m, 0, sizeof(m));
+    m.next_id = 1;
+
+    size_t peak = 0, merges = 0;
+    for (unsigned c = 0; c < CHECKPOINTS; c++) {
+        if (m.count == MAX_RUNS) {
+            fprintf(stderr, "%s: manifest full after %u checkpoints.\n", tc->name, c);
+            return 0;
+        }
+
+        m.runs[m.count].id = m.next_id++;
+        m.runs[m.count].size = (next_random() % 100 < tc->big_percent) ? BIG_RUN : SMALL_RUN;
+        m.count++;
+
+        size_t first, count;
+        while ((count = compaction_pick(&m, &first)) != 0) {
+            splice(&m, first, count, tc->shrink_percent);
+            merges++;
+        }
+
+        if (!settled(&m)) {
+            fprintf(stderr, "%s: runs left unmerged after %u checkpoints:", tc->name, c + 1);
+            for (size_t i = 0; i < m.count; i++)
+                fprintf(stderr, " %u", run_class(m.runs[i].size));
+            fprintf(stderr, "\n");
+            return 0;
+        }
+
+        if (m.count > peak)
+            peak = m.count;
+    }
+
+    printf("%s: %zu merges, at most %zu runs, %zu left.\n", tc->name, merges, peak, m.count);
+    return 1;
+}
+
+int main(void) {
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(test_cases) / sizeof(test_cases[0]); i++) {
+        if (!run_case(&test_cases[i]))
+            failed = 1;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}